@@ -1,171 +1,607 @@
 #include "common.h"
+#include "bench.h"
+#include "checkpoint.h"
+#include "engines.h"
+#include "profile.h"
+#include "rng.h"
+#include "termination.h"
+#include "tsp.h"
+#include "trajectory.h"
+#include "worker_pool.h"
 
-constexpr size_t n_city = 4;
-constexpr size_t n_ant = 3;
+#include <sstream>
 
-using CostMat = uint8_t[n_city][n_city];
-// Define maximum value (255 for uint8_t) to be infinity.
-constexpr auto CostInf = std::numeric_limits<uint8_t>::max();
+// Dense symmetric matrix with a value for every edge.
+struct EdgeMat {
+    size_t n = 0;
+    std::vector<float> v;
 
-// Assume it is undirected.
-CostMat cost_mat = {
-    {CostInf, 3, 1, 2},
-    {3, CostInf, 5, 4},
-    {1, 5, CostInf, 2},
-    {2, 4, 2, CostInf},
+    EdgeMat() = default;
+    EdgeMat(const size_t n, const float init) : n(n), v(n * n, init) {}
+
+    float *operator[](const size_t i) { return v.data() + i * n; }
+    const float *operator[](const size_t i) const { return v.data() + i * n; }
+};
+
+using PhMat = EdgeMat;
+// phm^alpha * heu^beta of every edge, the weight an ant gives to it.
+using ChoiceMat = EdgeMat;
+
+enum class AcoRule { ant_system, max_min, max_min_eager };
+
+constexpr std::array<std::pair<std::string_view, AcoRule>, 3> aco_rule_names{{
+    {"ant_system", AcoRule::ant_system}, {"max_min", AcoRule::max_min}, {"max_min_eager", AcoRule::max_min_eager},
+}};
+
+struct AcoParams {
+    // Ants.
+    size_t m;
+    size_t n_cand;
+    double alpha;
+    double beta;
+    double rho;
+    AcoRule rule;
+    bool local_search;
+    size_t n_epoch;
+    uint64_t seed;
+    // Workers building tours; 0 for one per hardware thread.
+    size_t n_thread = 0;
 };
 
-using Path = std::array<size_t, n_city>;
+// Exponents of the choice weights known at compile time, so that the usual alpha = 1, beta = 2
+// costs no pow over the n^2 edges the ant system refreshes every iteration.
+template<double alpha, double beta>
+struct FixedExponents {
+    explicit FixedExponents(const AcoParams &) {}
+
+    [[nodiscard]] static float ph(const float ph) {
+        return alpha == 1.0 ? ph : std::pow(ph, static_cast<float>(alpha));
+    }
+
+    [[nodiscard]] static float heu(const float cost) {
+        return beta == 2.0 ? 1.0f / (cost * cost) : std::pow(cost, -static_cast<float>(beta));
+    }
+};
+
+// Exponents of the choice weights given at run time.
+struct RuntimeExponents {
+    float alpha;
+    float beta;
+
+    explicit RuntimeExponents(const AcoParams &params)
+        : alpha(static_cast<float>(params.alpha)), beta(static_cast<float>(params.beta)) {}
+
+    [[nodiscard]] float ph(const float ph) const { return std::pow(ph, alpha); }
+    [[nodiscard]] float heu(const float cost) const { return std::pow(cost, -beta); }
+};
+
+template<typename Exponents>
+float choice_of(const Exponents &exp, const float ph, const float cost) {
+    return exp.ph(ph) * exp.heu(cost);
+}
 
 // Assume that from every city every other city is reachable.
-inline Path tsp_greedy(const size_t start = 0) {
-    std::array<bool, n_city> visited {};
-    visited[start] = true;
-    size_t i_first_avail = 0;
-    if (start == 0) ++i_first_avail;
-    Path path {};
-    path[0] = start;
-    auto cost_local = cost_mat[start];
-    for (size_t i = 1; i < n_city; ++i) {
-        size_t i_min = 0;
-        for (size_t j = i_first_avail; j < n_city; ++j) {
-            if (cost_local[j] < cost_local[i_min]) {
-                i_min = j;
-            }
-        }
-        path[i] = i_min;
-        visited[i_min] = true;
-        cost_local = cost_mat[i_min];
-        if (i_min == i_first_avail) {
-            while (visited[i_first_avail]) ++i_first_avail;
+template<typename Exponents>
+void update_choice(const Exponents &exp, ChoiceMat &choice, const PhMat &phm, const TspInstance &inst) {
+    std::vector<float> dist(inst.n);
+    for (size_t i = 0; i < inst.n; ++i) {
+        inst.dist_row(i, dist);
+        const auto ph = phm[i];
+        const auto row = choice[i];
+        for (size_t j = 0; j < inst.n; ++j) {
+            // Coincident cities still get a finite weight.
+            row[j] = choice_of(exp, ph[j], std::max(dist[j], 0.5f));
         }
+        row[i] = 0.0f;
     }
-    return path;
 }
 
-inline double cost_of(const Path & path) {
-    auto cost = static_cast<double>(cost_mat[path[n_city - 1]][path[0]]);
-    for (int i = 1; i < n_city - 1; ++i) {
-        cost += static_cast<double>(cost_mat[path[i - 1]][path[i]]);
+// Weights read straight from the dense choice-info matrix.
+struct ChoiceWeights {
+    const ChoiceMat &choice;
+
+    [[nodiscard]] float candidate(const uint32_t cur, size_t, const uint32_t j) const { return choice[cur][j]; }
+    [[nodiscard]] float any(const uint32_t cur, const uint32_t j) const { return choice[cur][j]; }
+};
+
+// Walk one tour. Each step draws from the not yet visited candidates of the current city by their
+// choice weight, and only if none is left takes the unvisited city of highest weight overall.
+template<typename Weights>
+void tsp_aco(counter_rng &rng, const Weights &weights, const size_t n, const CandidateLists &cand,
+             std::vector<uint8_t> &visited, std::vector<float> &weight, Path &path) {
+    std::ranges::fill(visited, 0);
+    path.clear();
+    auto cur = rng.below(static_cast<uint32_t>(n));
+    visited[cur] = true;
+    path.push_back(cur);
+    while (path.size() < n) {
+        const auto near = cand.of(cur);
+        float sum = 0.0f;
+        for (size_t c = 0; c < near.size(); ++c) {
+            weight[c] = visited[near[c]] ? 0.0f : weights.candidate(cur, c, near[c]);
+            sum += weight[c];
+        }
+        auto next = std::numeric_limits<uint32_t>::max();
+        if (sum > 0.0f) {
+            auto value = static_cast<float>(rng.uniform()) * sum;
+            for (size_t c = 0; c < near.size(); ++c) {
+                if (weight[c] == 0.0f) continue;
+                next = near[c];
+                if (value < weight[c]) break;
+                value -= weight[c];
+            }
+        } else {
+            auto best = -1.0f;
+            for (uint32_t j = 0; j < n; ++j) {
+                if (visited[j]) continue;
+                if (const auto w = weights.any(cur, j); w > best) {
+                    best = w;
+                    next = j;
+                }
+            }
+        }
+        visited[next] = true;
+        path.push_back(next);
+        cur = next;
     }
-    return cost;
 }
 
-using PhMat = std::array<std::array<double, n_city>, n_city>;
+inline void vapourise(PhMat &phm, const double rho) {
+    const auto factor = static_cast<float>(1.0 - rho);
+    for (auto &val: phm.v) val *= factor;
+}
+
+// One ant's contribution to an edge, recorded by a worker and applied after construction.
+struct Deposit {
+    uint32_t from;
+    uint32_t to;
+    float amount;
+};
+
+inline void accumulate(std::vector<Deposit> &deposits, const Path &path, const double cost) {
+    const auto comp = static_cast<float>(1.0 / cost);
+    for (size_t i = 1; i < path.size(); ++i) {
+        deposits.push_back({path[i - 1], path[i], comp});
+    }
+    deposits.push_back({path.back(), path.front(), comp});
+}
 
-inline PhMat init_ph_mat() {
-    const auto path = tsp_greedy();
-    const auto cost = cost_of(path);
-    const auto ph_init = n_ant / cost;
-    PhMat phm {};
-    for (int i = 0; i < n_city; ++i) {
-        std::ranges::fill(phm[i], ph_init);
+// Assume the pheromone map is undirected.
+inline void accumulate(PhMat &phm, std::span<const Deposit> deposits) {
+    for (const auto &d: deposits) {
+        phm[d.from][d.to] += d.amount;
+        phm[d.to][d.from] += d.amount;
     }
-    return phm;
 }
 
-struct AcoItem {
-    size_t index;
-    double weight;
+// MAX-MIN pheromone, every edge kept within [tau_min, tau_max].
+//
+// The lazy variant stores values relative to a global scale: evaporation only shrinks the scale,
+// and the true value of an edge is max(tau_min, scale * stored). As tau_min never decreases, that
+// clamp on read equals clamping every edge after every evaporation. Deposits convert back into
+// stored units, so an iteration only touches the edges it deposits on. The eager variant keeps
+// true values and passes over the whole matrix every iteration; it is the reference for the
+// lazy one.
+template<bool lazy>
+struct MaxMinPhMat {
+    PhMat stored;
+    double scale = 1.0;
+    float tau_min = 0.0f;
+    float tau_max = 0.0f;
+
+    [[nodiscard]] float tau(const size_t i, const size_t j) const {
+        if constexpr (lazy) return std::max(tau_min, static_cast<float>(scale * stored[i][j]));
+        else return stored[i][j];
+    }
+
+    void vapourise(const double rho) {
+        if constexpr (lazy) {
+            scale *= 1.0 - rho;
+            // Fold the scale back in long before stored values could overflow.
+            if (scale < 1e-30) {
+                for (auto &val: stored.v) val = static_cast<float>(val * scale);
+                scale = 1.0;
+            }
+        } else {
+            const auto factor = static_cast<float>(1.0 - rho);
+            for (auto &val: stored.v) val = std::max(tau_min, val * factor);
+        }
+    }
+
+    void deposit(const size_t i, const size_t j, const float amount) {
+        const auto val = std::min(tau_max, tau(i, j) + amount);
+        stored[i][j] = stored[j][i] = lazy ? static_cast<float>(val / scale) : val;
+    }
+
+    // Limits for a best tour of the given cost, with a 5% chance of constructing it at convergence.
+    void set_limits(const double rho, const size_t n, const double best_cost) {
+        const auto p_dec = std::pow(0.05, 1.0 / static_cast<double>(n));
+        const auto avg = std::max(static_cast<double>(n) / 2.0 - 1.0, 1.0);
+        const auto max = 1.0 / (rho * best_cost);
+        tau_max = static_cast<float>(max);
+        tau_min = static_cast<float>(std::min(max, max * (1.0 - p_dec) / (avg * p_dec)));
+    }
 };
 
-constexpr auto weight_inf = std::numeric_limits<double>::max();
+// Weights computed on demand from the lazy pheromone, with the candidates' heuristic factors
+// precomputed, so that no dense choice-info matrix has to be refreshed.
+template<typename Exponents>
+struct LazyWeights {
+    const Exponents &exp;
+    const MaxMinPhMat<true> &phm;
+    const TspInstance &inst;
+    const std::vector<float> &cand_heu;
+    size_t k;
 
-// Assume that from every city every other city is reachable.
-template<double alpha, double beta>
-Path tsp_aco(std::mt19937 & re, const PhMat & phm) {
-    std::array<bool, n_city> visited {};
-    Path path {};
-    std::uniform_int_distribution<size_t> d_begin(1, n_city - 1);
-    const size_t start = d_begin(re);
-    visited[start] = true;
-    path[0] = start;
-    auto cur = start;
-    std::array<AcoItem, n_city> items {};
-    for (size_t i_path = 1; i_path < n_city; ++i_path) {
-        double sum = 0.0;
-        for (int i = 0; i < n_city; ++i) {
-            items[i].index = i;
-            if (cur == i || visited[i]) {
-                items[i].weight = weight_inf;
-                continue;
+    [[nodiscard]] float candidate(const uint32_t cur, const size_t c, const uint32_t j) const {
+        return exp.ph(phm.tau(cur, j)) * cand_heu[cur * k + c];
+    }
+
+    [[nodiscard]] float any(const uint32_t cur, const uint32_t j) const {
+        return choice_of(exp, phm.tau(cur, j), std::max(inst.dist(cur, j), 0.5f));
+    }
+};
+
+// Ant colony over candidate lists: m ants build tours from the choice weights, then pheromone
+// evaporates and is deposited. Under the ant system every ant deposits on its tour; under MAX-MIN
+// only the iteration-best ant does, with pheromone bounded as in MaxMinPhMat.
+//
+// With a worker pool the ants are split into contiguous blocks, one per worker, and each worker
+// records its deposits in its own buffer. Every ant draws from its own stream, split by
+// (seed, epoch, ant), and the buffers are applied in ant order, so a run gives the same result
+// for any number of workers. With local search on, every tour is improved by 2-opt and Or-opt
+// before it is costed and deposited.
+template<typename Exponents, AcoRule rule>
+struct AntColony {
+    using Pheromone = std::conditional_t<rule == AcoRule::ant_system, PhMat, MaxMinPhMat<rule == AcoRule::max_min>>;
+
+    const TspInstance &inst;
+    CandidateLists cand;
+    Pheromone phm;
+    // Not used by the lazy MAX-MIN rule.
+    ChoiceMat choice;
+    std::vector<Path> colony;
+    std::vector<double> cost;
+    Path best;
+    double best_cost = std::numeric_limits<double>::max();
+    bool local_search;
+
+    AntColony(const TspInstance &inst, const AcoParams &params, worker_pool *pool = nullptr)
+        : inst(inst), cand(nearest_neighbours(inst, params.n_cand)), colony(params.m), cost(params.m),
+          local_search(params.local_search), exp(params), rho(params.rho), seed(params.seed), pool(pool),
+          scratch(pool ? pool->size() : 1) {
+        const phase_timer timer(phase::init);
+        const auto m = params.m;
+        const auto greedy_cost = cost_of(inst, tsp_greedy(inst, cand));
+        if constexpr (rule == AcoRule::ant_system) {
+            phm = PhMat(inst.n, static_cast<float>(static_cast<double>(m) / greedy_cost));
+        } else {
+            phm.set_limits(rho, inst.n, greedy_cost);
+            phm.stored = PhMat(inst.n, phm.tau_max);
+        }
+        if constexpr (rule == AcoRule::max_min) {
+            cand_heu.resize(inst.n * cand.k);
+            for (size_t i = 0; i < inst.n; ++i) {
+                for (size_t c = 0; c < cand.k; ++c) {
+                    cand_heu[i * cand.k + c] = exp.heu(std::max(inst.dist(i, cand.of(i)[c]), 0.5f));
+                }
             }
-            const auto fact_ph = std::pow(phm[cur][i], alpha);
-            const auto fact_heu = 1.0 / std::pow(cost_mat[cur][i], beta);
-            items[i].weight = fact_ph * fact_heu;
-            sum += items[i].weight;
-        }
-        std::uniform_real_distribution d_roulette(0.0, sum);
-        double value = d_roulette(re);
-        auto choice = std::numeric_limits<size_t>::max();
-        for (int i = 0; i < n_city; ++i) {
-            if (items[i].weight == weight_inf) continue;
-            if (value < items[i].weight) {
-                choice = i;
-                break;
+        } else {
+            choice = ChoiceMat(inst.n, 0.0f);
+        }
+        for (auto &s: scratch) {
+            s.visited.resize(inst.n);
+            s.weight.resize(cand.k);
+            s.ls.emplace(inst, cand);
+        }
+    }
+
+    void step() {
+        phase_timer timer(phase::update);
+        if constexpr (rule == AcoRule::ant_system) update_choice(exp, choice, phm, inst);
+        if constexpr (rule == AcoRule::max_min_eager) update_choice(exp, choice, phm.stored, inst);
+        const auto build = [&](const size_t w) {
+            const phase_timer build_timer(phase::construct);
+            auto &s = scratch[w];
+            s.deposits.clear();
+            const auto m = colony.size();
+            const auto lo = m * w / scratch.size(), hi = m * (w + 1) / scratch.size();
+            profile_count(profile_counter::tours, hi - lo);
+            profile_count(profile_counter::evaluations, hi - lo);
+            for (size_t k = lo; k < hi; ++k) {
+                auto rng = counter_rng(seed).split(epoch).split(k);
+                if constexpr (rule == AcoRule::max_min) {
+                    const LazyWeights<Exponents> weights{exp, phm, inst, cand_heu, cand.k};
+                    tsp_aco(rng, weights, inst.n, cand, s.visited, s.weight, colony[k]);
+                } else {
+                    tsp_aco(rng, ChoiceWeights{choice}, inst.n, cand, s.visited, s.weight, colony[k]);
+                }
+                if (local_search) {
+                    const phase_timer ls_timer(phase::local_search);
+                    s.ls->improve(colony[k]);
+                }
+                cost[k] = cost_of(inst, colony[k]);
+                if constexpr (rule == AcoRule::ant_system) accumulate(s.deposits, colony[k], cost[k]);
             }
-            value -= items[i].weight;
+        };
+        if (pool) pool->run(build);
+        else build(0);
+        timer.switch_to(phase::update);
+        size_t iteration_best = 0;
+        for (size_t k = 0; k < colony.size(); ++k) {
+            if (cost[k] < cost[iteration_best]) iteration_best = k;
         }
-        if (choice == std::numeric_limits<size_t>::max()) {
-            std::cerr << "Error performing roulette selection." << std::endl;
-            exit(1);
+        if (cost[iteration_best] < best_cost) {
+            best = colony[iteration_best];
+            best_cost = cost[iteration_best];
         }
-        path[i_path] = choice;
-        visited[choice] = true;
-        cur = choice;
+        timer.switch_to(phase::evaporate);
+        if constexpr (rule == AcoRule::ant_system) {
+            vapourise(phm, rho);
+            timer.switch_to(phase::deposit);
+            for (const auto &s: scratch) {
+                accumulate(phm, s.deposits);
+            }
+        } else {
+            phm.set_limits(rho, inst.n, best_cost);
+            phm.vapourise(rho);
+            timer.switch_to(phase::deposit);
+            const auto &path = colony[iteration_best];
+            const auto amount = static_cast<float>(1.0 / cost[iteration_best]);
+            for (size_t i = 1; i < path.size(); ++i) phm.deposit(path[i - 1], path[i], amount);
+            phm.deposit(path.back(), path.front(), amount);
+        }
+        ++epoch;
     }
-    return path;
-}
 
-template<double rho>
-void vapourise(PhMat & phm) {
-    const auto factor = 1.0 - rho;
-    for (int i = 0; i < n_city; ++i) {
-        for (int j = 0; j < n_city; ++j) {
-            phm[i][j] *= factor;
+    // The pheromone, the best tour and the epoch count; the rest is rebuilt every step.
+    void save(snapshot &out) const {
+        if constexpr (rule == AcoRule::ant_system) {
+            out.put(phm.v);
+        } else {
+            out.put(phm.stored.v);
+            out.put(phm.scale);
+            out.put(phm.tau_min);
+            out.put(phm.tau_max);
         }
+        out.put(best);
+        out.put(best_cost);
+        out.put(epoch);
     }
-}
 
-// Assume the pheromone map is undirected.
-template<double rho>
-void accumulate(PhMat & phm, const Path & path) {
-    const auto comp = 1.0 / cost_of(path);
-    for (int i = 1; i < n_city; ++i) {
-        phm[path[i - 1]][path[i]] += comp;
-        phm[path[i]][path[i - 1]] += comp;
-    }
-    phm[path[n_city - 1]][path[0]] += comp;
-    phm[path[0]][path[n_city - 1]] += comp;
-}
+    void restore(snapshot_reader &in) {
+        if constexpr (rule == AcoRule::ant_system) {
+            in.get(std::span(phm.v));
+        } else {
+            in.get(std::span(phm.stored.v));
+            in.get(phm.scale);
+            in.get(phm.tau_min);
+            in.get(phm.tau_max);
+        }
+        in.get(best);
+        in.get(best_cost);
+        in.get(epoch);
+    }
+
+private:
+    struct Scratch {
+        std::vector<uint8_t> visited;
+        std::vector<float> weight;
+        std::vector<Deposit> deposits;
+        std::optional<LocalSearch> ls;
+    };
+
+    Exponents exp;
+    double rho;
+    uint64_t seed;
+    uint64_t epoch = 0;
+    worker_pool *pool;
+    std::vector<Scratch> scratch;
+    std::vector<float> cand_heu;
+};
 
-template<size_t n_epoch, size_t m, double alpha, double beta, double rho>
-void demo_aco(const std::string & log_name) {
-    std::ofstream log_file;
-    log_file.open(log_name);
-    // NOLINTNEXTLINE(*-msc51-cpp) I deliberately want predictable results.
-    std::mt19937 engine;
-    auto phm = init_ph_mat();
-    std::array<Path, m> colony {};
-    for (int epoch = 0; epoch < n_epoch; ++epoch) {
-        for (auto & path : colony) {
-            path = tsp_aco<alpha, beta>(engine, phm);
-        }
-        vapourise<rho>(phm);
-        for (const auto & path : colony) {
-            accumulate<rho>(phm, path);
-        }
-        for (int i = 0; i < n_city; ++i) {
-            for (int j = 0; j < n_city; ++j) {
-                log_file << phm[i][j] << " ";
+// Logs the whole pheromone matrix every epoch when log_pheromone is set, which is meant for small
+// instances, and otherwise the best tour length so far and the best of the epoch.
+template<typename Exponents, AcoRule rule>
+std::optional<run_summary> aco_run(const TspInstance &inst, const AcoParams &params, const std::string &log_name,
+                                   const sampling policy, const bool log_pheromone, const checkpointing &ck,
+                                   const stopping &crit) {
+    worker_pool pool(params.n_thread ? params.n_thread : std::thread::hardware_concurrency());
+    AntColony<Exponents, rule> aco(inst, params, &pool);
+    convergence watch(crit);
+    size_t first = 0;
+    if (ck.resume) {
+        auto in = ck.resume->state();
+        aco.restore(in);
+        watch.restore(in);
+        if (!ck.restored(in)) return std::nullopt;
+        first = ck.resume->epoch();
+    }
+    const auto width = log_pheromone ? static_cast<uint32_t>(inst.n * inst.n) : 2;
+    const auto layout = log_pheromone ? trajectory_layout::trailing : trajectory_layout::flat;
+    trajectory_writer log(log_name, {layout, width, 0, 0}, policy, ck.resume ? ck.resume->records() : 0);
+    checkpoint_writer saver(ck, log);
+    auto stop = stop_reason::epochs;
+    auto n_epoch = params.n_epoch;
+    for (size_t epoch = first; epoch < params.n_epoch; ++epoch) {
+        if (saver.due(epoch)) {
+            snapshot out;
+            aco.save(out);
+            watch.save(out);
+            saver.save(epoch, std::move(out));
+        }
+        aco.step();
+        const auto why = watch.check(aco.best_cost, params.m * (epoch + 1), [&] { return variation_of(aco.cost); });
+        const phase_timer timer(phase::log);
+        if (const auto rec = log.record(epoch); !rec.empty()) {
+            if (log_pheromone) {
+                if constexpr (rule == AcoRule::ant_system) std::ranges::copy(aco.phm.v, rec.begin());
+            } else {
+                rec[0] = aco.best_cost;
+                rec[1] = std::ranges::min(aco.cost);
             }
         }
-        log_file << std::endl;
+        if (why) {
+            stop = *why;
+            n_epoch = epoch + 1;
+            break;
+        }
+    }
+    return run_summary{aco.best_cost, params.m * n_epoch, stop};
+}
+
+// Compiled colonies: every rule with alpha = 1 and beta = 2 fixed, and with runtime exponents.
+struct AcoKernel {
+    AcoRule rule;
+    bool fixed;
+    std::optional<run_summary> (*run)(const TspInstance &, const AcoParams &, const std::string &, sampling, bool,
+                                      const checkpointing &, const stopping &);
+};
+
+using UsualExponents = FixedExponents<1.0, 2.0>;
+
+constexpr std::array<AcoKernel, 6> aco_kernels{{
+    {AcoRule::ant_system, true, aco_run<UsualExponents, AcoRule::ant_system>},
+    {AcoRule::max_min, true, aco_run<UsualExponents, AcoRule::max_min>},
+    {AcoRule::max_min_eager, true, aco_run<UsualExponents, AcoRule::max_min_eager>},
+    {AcoRule::ant_system, false, aco_run<RuntimeExponents, AcoRule::ant_system>},
+    {AcoRule::max_min, false, aco_run<RuntimeExponents, AcoRule::max_min>},
+    {AcoRule::max_min_eager, false, aco_run<RuntimeExponents, AcoRule::max_min_eager>},
+}};
+
+std::optional<run_summary> run_aco(const TspInstance &inst, const AcoParams &params, const std::string &log_name,
+                                   const sampling policy = {}, const bool log_pheromone = false,
+                                   const checkpointing &ck = {}, const stopping &crit = {}) {
+    const auto fixed = params.alpha == 1.0 && params.beta == 2.0;
+    const auto kernel = std::ranges::find_if(aco_kernels, [&](const AcoKernel &k) {
+        return k.rule == params.rule && k.fixed == fixed;
+    });
+    return kernel->run(inst, params, log_name, policy, log_pheromone, ck, crit);
+}
+
+// The original 4-city demo instance. Diagonal entries are unused.
+const char *demo4_tsp = R"(NAME : demo4
+TYPE : TSP
+DIMENSION : 4
+EDGE_WEIGHT_TYPE : EXPLICIT
+EDGE_WEIGHT_FORMAT : FULL_MATRIX
+EDGE_WEIGHT_SECTION
+0 3 1 2
+3 0 5 4
+1 5 0 2
+2 4 2 0
+)";
+
+// The instance is read from the TSPLIB file in "tsp", or else made of "cities" random cities.
+std::optional<run_summary> run_aco(const config &cfg) {
+    AcoParams p{10, 20, 1.0, 2.0, 0.1, AcoRule::ant_system, false, 100, 0};
+    std::string tsp, log_name;
+    size_t cities = 1000;
+    uint32_t instance_seed = 0;
+    sampling policy;
+    bool log_pheromone = false;
+    if (!(cfg.read("ants", p.m) && cfg.read("n_cand", p.n_cand) && cfg.read("alpha", p.alpha) &&
+          cfg.read("beta", p.beta) && cfg.read("rho", p.rho) && cfg.read("rule", p.rule, aco_rule_names) &&
+          cfg.read("local_search", p.local_search) && cfg.read("n_epoch", p.n_epoch) && cfg.read("seed", p.seed) &&
+          cfg.read("threads", p.n_thread) && cfg.read("tsp", tsp) && cfg.read("cities", cities) &&
+          cfg.read("instance_seed", instance_seed) &&
+          cfg.read("log", log_name) && cfg.read("log_every", policy.every) &&
+          cfg.read("log_pheromone", log_pheromone))) {
+        return std::nullopt;
+    }
+    if (p.m == 0 || p.n_cand == 0 || p.rho <= 0.0 || p.rho >= 1.0 || (tsp.empty() && cities < 2) ||
+        (log_pheromone && p.rule != AcoRule::ant_system)) {
+        std::cerr << "ACO needs ants >= 1, n_cand >= 1, rho in (0, 1), at least 2 cities, and the ant system rule "
+            "to log pheromone." << std::endl;
+        return std::nullopt;
     }
-    log_file.close();
+    const auto ck = read_checkpointing(cfg);
+    const auto crit = read_stopping(cfg);
+    const auto again = read_restarts(cfg);
+    if (!(ck && crit && again)) return std::nullopt;
+    const auto inst = tsp.empty() ? std::optional(random_instance(cities, instance_seed)) : load_tsplib(tsp);
+    if (!inst) return std::nullopt;
+    const auto one_run = [&](const size_t n, const uint64_t seed, const stopping &left, const size_t index) {
+        auto q = p;
+        q.m = n;
+        q.seed = seed;
+        return run_aco(*inst, q, restart_log_name(log_name, index), policy, log_pheromone, *ck, left);
+    };
+    return run_restarts(*again, *crit, p.m, p.seed, one_run);
 }
 
 void main_aco() {
     std::cout << "--> Ant Colony Optimization" << std::endl;
-    demo_aco<100, 3, 1.0, 2.0, 0.5>("aco.log");
+    std::istringstream demo4(demo4_tsp);
+    if (const auto inst = load_tsplib(demo4)) {
+        run_aco(*inst, {3, 20, 1.0, 2.0, 0.5, AcoRule::ant_system, false, 100, 0}, "aco.trj", {}, true);
+    }
+    const auto random1000 = random_instance(1000, 0);
+    run_aco(random1000, {10, 20, 1.0, 2.0, 0.1, AcoRule::ant_system, false, 100, 0}, "aco_1000.trj");
+    run_aco(random1000, {10, 20, 1.0, 2.0, 0.02, AcoRule::max_min, false, 100, 0}, "aco_mmas_1000.trj");
+    run_aco(random1000, {10, 20, 1.0, 2.0, 0.02, AcoRule::max_min, true, 100, 0}, "aco_mmas_ls_1000.trj");
+}
+
+// Lazy against eager MAX-MIN evaporation on the same seeds: time per iteration, and the largest
+// relative difference between the two pheromone matrices, a failure above lazy_tau_tolerance. Then the pheromone update alone: the ant
+// system's evaporation of the dense matrix with its buffered deposits, per edge, and a lazy
+// MAX-MIN evaporation with the deposit of one tour, per deposit. Both are repeated at a steady
+// state, where deposits make up for evaporation and no value drifts into denormals.
+void bench_aco(bench_report &report) {
+    const auto inst = random_instance(2000, 1);
+    constexpr size_t n_epoch = 50;
+    const AcoParams params{10, 20, 1.0, 2.0, 0.02, AcoRule::max_min, false, n_epoch, 7};
+    AntColony<UsualExponents, AcoRule::max_min> lazy(inst, params);
+    AntColony<UsualExponents, AcoRule::max_min_eager> eager(inst, params);
+    const auto time = [&](auto &aco) {
+        const auto begin = std::chrono::steady_clock::now();
+        for (size_t epoch = 0; epoch < n_epoch; ++epoch) aco.step();
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - begin;
+        return elapsed.count() / n_epoch;
+    };
+    const auto t_lazy = time(lazy);
+    const auto t_eager = time(eager);
+    double max_rel = 0.0;
+    for (size_t i = 0; i < inst.n; ++i) {
+        for (size_t j = 0; j < inst.n; ++j) {
+            if (i == j) continue;
+            const auto a = lazy.phm.tau(i, j), b = eager.phm.tau(i, j);
+            max_rel = std::max(max_rel, std::abs(static_cast<double>(a) - b) / b);
+        }
+    }
+    report.add({"aco", "mmas_lazy_vs_eager", {{"cities", inst.n}, {"epochs", n_epoch}},
+                {{"lazy_s_per_iter", t_lazy}, {"eager_s_per_iter", t_eager}, {"lazy_best", lazy.best_cost},
+                 {"eager_best", eager.best_cost}, {"max_rel_tau_diff", max_rel}}});
+    // The two round to float at different steps; over n_epoch epochs that stays well within this.
+    constexpr double lazy_tau_tolerance = 1e-5;
+    if (!(max_rel <= lazy_tau_tolerance)) {
+        report.add_failure({"aco", "mmas_lazy_tau", {{"cities", inst.n}, {"epochs", n_epoch}}, {}});
+    }
+
+    for (const size_t n: {size_t{200}, size_t{2000}}) {
+        const auto cities = random_instance(n, 2);
+        PhMat phm(n, 1.0f);
+        std::vector<Deposit> deposits;
+        Path tour(n);
+        std::iota(tour.begin(), tour.end(), 0);
+        for (size_t k = 0; k < params.m; ++k) accumulate(deposits, tour, cost_of(cities, tour));
+        const auto update_s = seconds_per_call([&] {
+            vapourise(phm, 0.1);
+            accumulate(phm, deposits);
+        });
+        MaxMinPhMat<true> mmas;
+        mmas.set_limits(0.02, n, cost_of(cities, tour));
+        mmas.stored = PhMat(n, mmas.tau_max);
+        const auto mmas_s = seconds_per_call([&] {
+            mmas.vapourise(0.02);
+            for (size_t i = 1; i < n; ++i) mmas.deposit(tour[i - 1], tour[i], 1e-9f);
+            mmas.deposit(tour.back(), tour.front(), 1e-9f);
+        });
+        const auto edges = static_cast<double>(n * n);
+        report.add({"aco", "pheromone_update", {{"cities", n}, {"ants", params.m}},
+                    {{"ant_system_ns_per_edge", update_s * 1e9 / edges},
+                     {"mmas_lazy_ns_per_deposit", mmas_s * 1e9 / static_cast<double>(n)}}});
+        // Keeps the updates observable.
+        if (!(phm.v[1] > 0.0f && mmas.tau(0, 1) > 0.0f)) std::cout << "bad pheromone" << std::endl;
+    }
 }
@@ -0,0 +1,109 @@
+#include "bench.h"
+
+#include <charconv>
+#include <ctime>
+
+namespace {
+    void write_string(std::ostream &os, const std::string_view s) {
+        os << '"';
+        for (const auto c: s) {
+            if (c == '"' || c == '\\') os << '\\' << c;
+            else if (static_cast<unsigned char>(c) < 0x20) os << ' ';
+            else os << c;
+        }
+        os << '"';
+    }
+
+    // Shortest text that reads back as the same double.
+    void write_number(std::ostream &os, const double v) {
+        if (!std::isfinite(v)) {
+            os << "null";
+            return;
+        }
+        std::array<char, 32> text{};
+        const auto end = std::to_chars(text.data(), text.data() + text.size(), v).ptr;
+        os << std::string_view(text.data(), end);
+    }
+
+    void write_object(std::ostream &os, const std::vector<std::pair<std::string, double>> &fields) {
+        os << '{';
+        for (size_t i = 0; i < fields.size(); ++i) {
+            if (i) os << ", ";
+            write_string(os, fields[i].first);
+            os << ": ";
+            write_number(os, fields[i].second);
+        }
+        os << '}';
+    }
+}
+
+void bench_report::add(bench_result result) {
+    std::cout << result.suite << ' ' << result.name;
+    for (const auto &[key, val]: result.params) std::cout << ' ' << key << '=' << val;
+    std::cout << " :";
+    for (const auto &[key, val]: result.metrics) std::cout << ' ' << key << '=' << val;
+    std::cout << std::endl;
+    all.push_back(std::move(result));
+}
+
+void bench_report::add_failure(bench_result result) {
+    std::cerr << result.suite << ' ' << result.name << " failed." << std::endl;
+    result.metrics = {{"failed", 1.0}};
+    ++n_failed;
+    add(std::move(result));
+}
+
+bool bench_report::write_json(const std::string &path) const {
+    std::ofstream file(path);
+    const auto now = std::time(nullptr);
+    std::array<char, 32> stamp{};
+    std::strftime(stamp.data(), stamp.size(), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&now));
+    file << "{\"build\": {\"label\": ";
+    write_string(file, label);
+    file << ", \"compiler\": ";
+    write_string(file, __VERSION__);
+    file << ", \"build_type\": ";
+    write_string(file, build_type);
+    file << ", \"threads\": " << std::thread::hardware_concurrency() << ", \"time\": ";
+    write_string(file, stamp.data());
+    file << "},\n \"results\": [";
+    for (size_t i = 0; i < all.size(); ++i) {
+        const auto &r = all[i];
+        file << (i ? ",\n  " : "\n  ") << "{\"suite\": ";
+        write_string(file, r.suite);
+        file << ", \"name\": ";
+        write_string(file, r.name);
+        file << ", \"params\": ";
+        write_object(file, r.params);
+        file << ", \"metrics\": ";
+        write_object(file, r.metrics);
+        file << '}';
+    }
+    file << "\n]}\n";
+    if (!file) {
+        std::cerr << "Failed to write " << path << "." << std::endl;
+        return false;
+    }
+    return true;
+}
+
+size_t peak_memory() {
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line)) {
+        if (!line.starts_with("VmHWM:")) continue;
+        size_t kib = 0;
+        const auto digits = line.find_first_of("0123456789");
+        if (digits != std::string::npos) std::from_chars(line.data() + digits, line.data() + line.size(), kib);
+        return kib * 1024;
+    }
+    return 0;
+}
+
+bool reset_peak_memory() {
+    // Writing 5 to clear_refs resets the peak resident set size (Linux 4.0 onwards).
+    std::ofstream clear("/proc/self/clear_refs");
+    clear << "5";
+    clear.flush();
+    return static_cast<bool>(clear);
+}
@@ -0,0 +1,67 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include "common.h"
+
+// One measurement of a benchmark suite: the case, the sizes it ran at and what came out.
+struct bench_result {
+    std::string suite;
+    std::string name;
+    std::vector<std::pair<std::string, double>> params;
+    std::vector<std::pair<std::string, double>> metrics;
+};
+
+// Results of a gene01_bench run. Each is echoed to std::cout as one line when added, and all of
+// them can be written out as JSON to compare builds:
+//
+//   {"build": {"label": ..., "compiler": ..., "build_type": ..., "threads": ..., "time": ...},
+//    "results": [{"suite": ..., "name": ..., "params": {...}, "metrics": {...}}, ...]}
+//
+// Non-finite values are written as null.
+class bench_report {
+public:
+    std::string label;
+    std::string build_type;
+
+    void add(bench_result result);
+
+    // A case that could not run, as when its settings are invalid, or whose result failed a check:
+    // recorded with the single metric failed = 1, so that a comparison of builds cannot miss it.
+    void add_failure(bench_result result);
+
+    [[nodiscard]] const std::vector<bench_result> &results() const { return all; }
+    [[nodiscard]] size_t failures() const { return n_failed; }
+
+    // False, with a message, when the file cannot be written.
+    bool write_json(const std::string &path) const;
+
+private:
+    std::vector<bench_result> all;
+    size_t n_failed = 0;
+};
+
+// Peak resident set size of the process in bytes, from VmHWM in /proc/self/status; 0 when unknown.
+size_t peak_memory();
+
+// Resets the peak to the current resident set size, so that peak_memory() covers what runs next.
+// False when the kernel does not allow it; the peak then covers the whole process.
+bool reset_peak_memory();
+
+// Seconds per call of op, over as many calls as fit in about min_seconds, and at least one.
+template<typename Op>
+double seconds_per_call(const Op &op, const double min_seconds = 0.2) {
+    size_t reps = 1;
+    for (;;) {
+        const auto begin = std::chrono::steady_clock::now();
+        for (size_t r = 0; r < reps; ++r) op();
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - begin;
+        if (elapsed.count() >= min_seconds || reps >= size_t{1} << 40) {
+            return elapsed.count() / static_cast<double>(reps);
+        }
+        // Aim past the minimum from what the last round took.
+        const auto scale = elapsed.count() > 0.0 ? 1.5 * min_seconds / elapsed.count() : 100.0;
+        reps = std::max(reps + 1, static_cast<size_t>(static_cast<double>(reps) * std::min(scale, 100.0)));
+    }
+}
+
+#endif //BENCH_H
@@ -0,0 +1,231 @@
+#include "bench.h"
+#include "engines.h"
+#include "objective.h"
+#include "population.h"
+#include "rng.h"
+#include "sweep.h"
+
+#include <charconv>
+
+void bench_pso(bench_report &report);
+void bench_aco(bench_report &report);
+void bench_ga(bench_report &report);
+void bench_nsga(bench_report &report);
+void bench_grid(bench_report &report);
+
+// Batched objectives: evaluations per second over population sizes and dimensions, for every
+// function as it is and, at 10 to 1000 dimensions, shifted and rotated.
+void bench_objective(bench_report &report) {
+    counter_rng rng(11);
+    const auto time = [&](const landscape f, const bool moved, const size_t n, const size_t n_dim) {
+        const objective fn(problem{f, moved ? 4.0 : 0.0, moved}, n_dim);
+        population pop(n, n_dim);
+        for (size_t j = 0; j < n_dim; ++j) rng.fill_uniform(pop.col(j), -5.0, 5.0);
+        const auto s = seconds_per_call([&] { fn.evaluate(pop); });
+        auto name = std::string(landscape_names[static_cast<size_t>(f)].first);
+        if (moved) name += "_rotated";
+        report.add({"objective", name, {{"n", n}, {"n_dim", n_dim}},
+                    {{"evals_per_s", static_cast<double>(n) / s}, {"ns_per_eval", s * 1e9 / static_cast<double>(n)}}});
+    };
+    for (const auto f: landscape_names | std::views::values) {
+        for (const size_t n: {size_t{1000}, size_t{100'000}}) {
+            for (const size_t n_dim: {size_t{2}, size_t{10}, size_t{100}}) time(f, false, n, n_dim);
+        }
+        time(f, false, 1000, 1000);
+        for (const size_t n_dim: {size_t{10}, size_t{100}, size_t{1000}}) time(f, true, 1000, n_dim);
+    }
+}
+
+// Bulk draws, per value, into buffers that stay in L1.
+void bench_rng(bench_report &report) {
+    counter_rng rng(13);
+    constexpr size_t n = 4096;
+    std::vector<double> real(n);
+    std::vector<uint32_t> word(n);
+    const auto time = [&](const std::string_view name, const auto &fill) {
+        const auto s = seconds_per_call(fill);
+        report.add({"rng", std::string(name), {{"n", n}}, {{"ns_per_value", s * 1e9 / n}}});
+    };
+    time("fill_bits", [&] { rng.fill_bits(word); });
+    time("fill_below", [&] { rng.fill_below(word, 1000); });
+    time("fill_uniform", [&] { rng.fill_uniform(real); });
+    time("fill_normal", [&] { rng.fill_normal(real); });
+    if (word[0] >= 1000 || std::isnan(real[0])) std::cout << "bad draws" << std::endl;
+}
+
+// Settings from "key=value key=value ..." text. The values that are numbers also make the params
+// of a result, and the others its name.
+config settings_of(const std::string_view text, std::string &name,
+                   std::vector<std::pair<std::string, double>> &params) {
+    config cfg;
+    for (const auto part: text | std::views::split(' ')) {
+        const std::string_view item(part.begin(), part.end());
+        const auto eq = item.find('=');
+        const std::string key(item.substr(0, eq)), value(item.substr(eq + 1));
+        cfg.set(key, value);
+        double v = 0.0;
+        const auto [end, ec] = std::from_chars(value.data(), value.data() + value.size(), v);
+        if (ec == std::errc() && end == value.data() + value.size()) {
+            params.emplace_back(key, v);
+        } else {
+            if (!name.empty()) name += ' ';
+            name += key == "algo" ? value : key + '=' + value;
+        }
+    }
+    return cfg;
+}
+
+// Every engine from its runtime settings, on one thread: evaluations per second, the best value and
+// the peak resident memory of the run, over population sizes and dimensions, and on shifted and
+// rotated functions up to 1000 dimensions.
+void bench_engine(bench_report &report) {
+    constexpr std::array cases{
+        "algo=de np=20 n_dim=2",
+        "algo=de np=200 n_dim=10",
+        "algo=de np=200 n_dim=30",
+        "algo=pso n_particle=50 n_dim=2",
+        "algo=pso n_particle=5000 n_dim=30",
+        "algo=ga n_gene=100 n_loci=4",
+        "algo=ga n_gene=1000 n_loci=1000 crossover=sbx p_mutate=0.001",
+        "algo=eda n_flock=500 n_dim=2",
+        "algo=eda n_flock=5000 n_dim=30",
+        "algo=eda model=cma n_dim=10 n_epoch=300",
+        "algo=eda model=cma n_dim=100 n_epoch=300",
+        "algo=de np=100 n_dim=100 n_epoch=100 function=rastrigin shift=4 rotate=true",
+        "algo=pso n_particle=200 n_dim=1000 n_epoch=20 function=rosenbrock shift=4 rotate=true",
+        "algo=ga n_gene=1000 n_loci=100 crossover=sbx function=levy",
+        "algo=eda model=cma n_dim=100 n_epoch=300 function=griewank shift=4 rotate=true",
+        "algo=aco cities=200",
+        "algo=aco cities=1000 n_epoch=20",
+        "algo=grid map_size=256 n_epoch=20",
+        "algo=grid map_size=1024 n_epoch=10",
+    };
+    for (const auto text: cases) {
+        std::string name;
+        std::vector<std::pair<std::string, double>> params;
+        const auto cfg = settings_of(text, name, params);
+        std::vector<std::string> unused;
+        reset_peak_memory();
+        const auto begin = std::chrono::steady_clock::now();
+        const auto summary = run_in_batch(cfg, unused);
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - begin;
+        if (!summary) {
+            report.add_failure({"engine", name, params, {}});
+            continue;
+        }
+        const auto evals = static_cast<double>(summary->n_eval);
+        report.add({"engine", name, params,
+                    {{"seconds", elapsed.count()}, {"evals", evals}, {"evals_per_s", evals / elapsed.count()},
+                     {"best", summary->best}, {"peak_mib", static_cast<double>(peak_memory()) / (1 << 20)}}});
+    }
+}
+
+// Island-model DE, one thread per island, over 1, 2, 4, ... islands up to the hardware threads:
+// every island evolves a population of its own, so evaluations per second should grow with the
+// islands, and speedup is their ratio to the run with one island.
+void bench_islands(bench_report &report) {
+    const auto hw = std::max<size_t>(1, std::thread::hardware_concurrency());
+    double base = 0.0;
+    for (size_t n = 1;; n = std::min(2 * n, hw)) {
+        const auto text = "algo=de np=50 n_dim=30 n_epoch=2000 interval=10 migrants=2 islands=" + std::to_string(n);
+        std::string name;
+        std::vector<std::pair<std::string, double>> params;
+        const auto cfg = settings_of(text, name, params);
+        std::vector<std::string> unused;
+        const auto begin = std::chrono::steady_clock::now();
+        const auto summary = run_in_batch(cfg, unused);
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - begin;
+        if (!summary) {
+            report.add_failure({"islands", name, params, {}});
+        } else {
+            const auto rate = static_cast<double>(summary->n_eval) / elapsed.count();
+            if (n == 1) base = rate;
+            report.add({"islands", name, params,
+                        {{"seconds", elapsed.count()}, {"evals_per_s", rate},
+                         {"speedup", base > 0.0 ? rate / base : 0.0}, {"best", summary->best}}});
+        }
+        if (n == hw) break;
+    }
+}
+
+// Evaluations and seconds until the best value first reaches a target. Every case runs with the
+// target as a stopping criterion, for at most n_epoch epochs or max_eval evaluations; cases that
+// miss it report reached = 0 and the best they got to. The last cases are runs that stall short of
+// the target, DE with a small population on the Ackley function and PSO, whose swarm collapses
+// early, on the sphere, each alone and with IPOP and BIPOP restarts.
+void bench_target(bench_report &report) {
+    constexpr std::array cases{
+        "algo=de np=50 n_dim=10 n_epoch=2000 target=1e-6",
+        "algo=pso n_particle=50 n_dim=2 n_epoch=2000 target=1e-6",
+        "algo=ga n_gene=100 n_epoch=2000 target=1e-1",
+        "algo=eda n_dim=2 n_epoch=1000 target=1e-1",
+        "algo=eda model=cma n_dim=10 n_epoch=2000 target=1e-6",
+        "algo=eda model=cma n_dim=100 n_epoch=4000 target=1e-6",
+        "algo=aco cities=200 rule=max_min local_search=true n_epoch=200 target=1.075e7",
+        "algo=de np=10 n_dim=10 n_epoch=100000 max_eval=400000 target=1e-6",
+        "algo=de np=10 n_dim=10 n_epoch=100000 max_eval=400000 stall=100 stall_tol=1e-9 restart=ipop target=1e-6",
+        "algo=de np=10 n_dim=10 n_epoch=100000 max_eval=400000 stall=100 stall_tol=1e-9 restart=bipop target=1e-6",
+        "algo=pso n_dim=10 n_epoch=100000 max_eval=300000 target=1e-2",
+        "algo=pso n_dim=10 n_epoch=100000 max_eval=300000 stall=50 stall_tol=1e-9 restart=ipop target=1e-2",
+        "algo=pso n_dim=10 n_epoch=100000 max_eval=300000 stall=50 stall_tol=1e-9 restart=bipop target=1e-2",
+    };
+    for (const auto settings: cases) {
+        std::string name;
+        std::vector<std::pair<std::string, double>> params;
+        const auto cfg = settings_of(settings, name, params);
+        std::vector<std::string> unused;
+        const auto begin = std::chrono::steady_clock::now();
+        const auto summary = run_in_batch(cfg, unused);
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - begin;
+        if (!summary) {
+            report.add_failure({"target", name, params, {}});
+            continue;
+        }
+        if (summary->stop != stop_reason::target) {
+            report.add({"target", name, params,
+                        {{"reached", 0.0}, {"evals", summary->n_eval}, {"best", summary->best}}});
+            continue;
+        }
+        report.add({"target", name, params,
+                    {{"reached", 1.0}, {"evals_to_target", summary->n_eval}, {"seconds_to_target", elapsed.count()},
+                     {"restarts", summary->n_restart}, {"best", summary->best}}});
+    }
+}
+
+constexpr std::array<std::pair<std::string_view, void (*)(bench_report &)>, 10> bench_suites{{
+    {"objective", bench_objective}, {"rng", bench_rng}, {"pso", bench_pso}, {"aco", bench_aco},
+    {"ga", bench_ga}, {"nsga", bench_nsga}, {"grid", bench_grid}, {"engine", bench_engine},
+    {"islands", bench_islands}, {"target", bench_target},
+}};
+
+// gene01_bench [--json results.json] [--label text] [suite ...]
+//
+// Runs the named suites, or all of them, printing a line per result and writing them all to the
+// JSON file if one is given; see bench.h. Exits with 1 when a case failed to run.
+int main(const int argc, char **argv) {
+    bench_report report;
+#ifdef GENE01_BUILD_TYPE
+    report.build_type = GENE01_BUILD_TYPE;
+#endif
+    std::string json;
+    std::vector<std::string_view> chosen;
+    for (int i = 1; i < argc; ++i) {
+        const std::string_view arg = argv[i];
+        if ((arg == "--json" || arg == "--label") && i + 1 < argc) {
+            (arg == "--json" ? json : report.label) = argv[++i];
+            continue;
+        }
+        if (std::ranges::find(bench_suites, arg, [](const auto &s) { return s.first; }) == bench_suites.end()) {
+            std::cerr << "Usage: gene01_bench [--json results.json] [--label text] [suite ...], with suites";
+            for (const auto &s: bench_suites) std::cerr << ' ' << s.first;
+            std::cerr << "." << std::endl;
+            return 1;
+        }
+        chosen.push_back(arg);
+    }
+    for (const auto &[name, suite]: bench_suites) {
+        if (chosen.empty() || std::ranges::find(chosen, name) != chosen.end()) suite(report);
+    }
+    if (!json.empty() && !report.write_json(json)) return 1;
+    return report.failures() ? 1 : 0;
+}
@@ -0,0 +1,228 @@
+#include "checkpoint.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <filesystem>
+
+void snapshot::append(const void *p, const size_t size) {
+    const auto at = data.size();
+    data.resize(at + size);
+    if (size) std::memcpy(data.data() + at, p, size);
+}
+
+void snapshot::put(const population &pop) {
+    put(pop.size());
+    put(pop.dim());
+    for (size_t j = 0; j <= pop.dim(); ++j) append(pop.col(j).data(), pop.size() * sizeof(double));
+}
+
+void snapshot::put(const matrix &m) {
+    put(m.rows());
+    put(m.cols());
+    for (size_t i = 0; i < m.rows(); ++i) append(m.row(i).data(), m.cols() * sizeof(double));
+}
+
+void snapshot_reader::take(void *p, const size_t size) {
+    if (!good || size > bytes.size() - at) {
+        good = false;
+        return;
+    }
+    if (size) std::memcpy(p, bytes.data() + at, size);
+    at += size;
+}
+
+void snapshot_reader::get(population &pop) {
+    size_t n = 0, n_dim = 0;
+    get(n);
+    get(n_dim);
+    if (n != pop.size() || n_dim != pop.dim()) good = false;
+    for (size_t j = 0; j <= pop.dim() && good; ++j) take(pop.col(j).data(), n * sizeof(double));
+}
+
+void snapshot_reader::get(matrix &m) {
+    size_t n_row = 0, n_col = 0;
+    get(n_row);
+    get(n_col);
+    if (n_row != m.rows() || n_col != m.cols()) good = false;
+    for (size_t i = 0; i < m.rows() && good; ++i) take(m.row(i).data(), n_col * sizeof(double));
+}
+
+namespace {
+    constexpr std::array<char, 8> checkpoint_magic{'G', 'E', 'N', 'E', '0', '1', 'C', 'K'};
+    // Layout of the engine states. Bump it whenever an engine saves other values, or in another
+    // order, so that older checkpoints are refused rather than misread.
+    constexpr uint64_t checkpoint_version = 1;
+
+    // Followed by the key, padded to 8 bytes, and then the state.
+    struct checkpoint_header {
+        std::array<char, 8> magic;
+        uint64_t version;
+        uint64_t next_epoch;
+        uint64_t n_record;
+        uint64_t key_size;
+        uint64_t state_size;
+        // FNV-1a of the key and the state.
+        uint64_t checksum;
+    };
+
+    size_t padded(const size_t size) { return (size + 7) / 8 * 8; }
+
+    uint64_t fnv1a(const std::span<const char> bytes, uint64_t h = 0xCBF29CE484222325) {
+        for (const auto c: bytes) h = (h ^ static_cast<uint8_t>(c)) * 0x100000001B3;
+        return h;
+    }
+
+    uint64_t checksum_of(const std::string_view key, const std::span<const char> state) {
+        return fnv1a(state, fnv1a(key));
+    }
+
+    // Settings a resumed run may change.
+    constexpr std::array<std::string_view, 5> free_keys{
+        "checkpoint", "checkpoint_every", "n_epoch", "threads", "profile",
+    };
+}
+
+void checkpoint_file::Unmap::operator()(void *p) const {
+    munmap(p, size);
+}
+
+std::optional<checkpoint_file> checkpoint_file::open(const std::string &path, const std::string &key) {
+    const auto fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        std::cerr << "Failed to open " << path << "." << std::endl;
+        return std::nullopt;
+    }
+    struct stat st{};
+    const auto size = fstat(fd, &st) == 0 ? static_cast<size_t>(st.st_size) : 0;
+    if (size < sizeof(checkpoint_header)) {
+        close(fd);
+        std::cerr << path << " is not a checkpoint." << std::endl;
+        return std::nullopt;
+    }
+    void *p = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) {
+        std::cerr << "Failed to map " << path << "." << std::endl;
+        return std::nullopt;
+    }
+    checkpoint_file cp;
+    cp.mapping = std::unique_ptr<void, Unmap>(p, Unmap{size});
+    checkpoint_header header{};
+    std::memcpy(&header, p, sizeof header);
+    const auto body = static_cast<const char *>(p) + sizeof header;
+    const auto room = size - sizeof header;
+    // key_size is checked before it is padded, which would wrap near 2^64.
+    if (header.magic != checkpoint_magic || header.key_size > room || padded(header.key_size) > room ||
+        header.state_size > room - padded(header.key_size)) {
+        std::cerr << path << " is not a checkpoint." << std::endl;
+        return std::nullopt;
+    }
+    if (header.version != checkpoint_version) {
+        std::cerr << "Checkpoint " << path << " was written by another version of gene01; remove it to start "
+            "this run." << std::endl;
+        return std::nullopt;
+    }
+    const std::string_view saved_key(body, header.key_size);
+    if (saved_key != key) {
+        std::cerr << "Checkpoint " << path << " belongs to another run, with settings '" << saved_key
+            << "'; remove it to start this one." << std::endl;
+        return std::nullopt;
+    }
+    cp.bytes = {body + padded(header.key_size), header.state_size};
+    if (checksum_of(saved_key, cp.bytes) != header.checksum) {
+        std::cerr << "Checkpoint " << path << " is damaged." << std::endl;
+        return std::nullopt;
+    }
+    cp.next_epoch = header.next_epoch;
+    cp.n_record = header.n_record;
+    return cp;
+}
+
+std::optional<checkpointing> read_checkpointing(const config &cfg) {
+    checkpointing ck;
+    if (!(cfg.read("checkpoint", ck.path) && cfg.read("checkpoint_every", ck.every))) return std::nullopt;
+    if (ck.every == 0) {
+        std::cerr << "checkpoint_every must be at least 1." << std::endl;
+        return std::nullopt;
+    }
+    if (!ck.enabled()) return ck;
+    for (const auto &[key, value]: cfg.all()) {
+        if (std::ranges::find(free_keys, key) != free_keys.end()) continue;
+        if (!ck.key.empty()) ck.key += ' ';
+        ck.key += key + '=' + value;
+    }
+    if (std::filesystem::exists(ck.path)) {
+        ck.resume = checkpoint_file::open(ck.path, ck.key);
+        if (!ck.resume) return std::nullopt;
+    }
+    return ck;
+}
+
+bool checkpointing::restored(const snapshot_reader &in) const {
+    if (in.done()) return true;
+    std::cerr << "Checkpoint " << path << " does not match this engine; remove it to start this run." << std::endl;
+    return false;
+}
+
+checkpoint_writer::checkpoint_writer(const checkpointing &ck, trajectory_writer &log)
+    : enabled(ck.enabled()), path(ck.path), every(ck.every), first(ck.resume ? ck.resume->epoch() : 0), key(ck.key),
+      log(log) {
+    if (enabled) writer = std::jthread([this] { serve(); });
+}
+
+checkpoint_writer::~checkpoint_writer() {
+    {
+        std::lock_guard lock(mutex);
+        stopping = true;
+    }
+    wake.notify_one();
+}
+
+void checkpoint_writer::save(const uint64_t epoch, snapshot state) {
+    const auto n_record = log.flush();
+    {
+        std::lock_guard lock(mutex);
+        pending.emplace(pending_checkpoint{epoch, n_record, std::move(state)});
+    }
+    wake.notify_one();
+}
+
+void checkpoint_writer::serve() {
+    for (;;) {
+        std::unique_lock lock(mutex);
+        wake.wait(lock, [&] { return stopping || pending; });
+        if (!pending) return;
+        const auto cp = std::move(*pending);
+        pending.reset();
+        lock.unlock();
+        log.wait_written(cp.n_record);
+        if (!write(cp)) std::cerr << "Failed to write checkpoint " << path << "." << std::endl;
+    }
+}
+
+// Written in full and synced before it replaces the last checkpoint.
+bool checkpoint_writer::write(const pending_checkpoint &cp) const {
+    const auto state = cp.state.bytes();
+    const checkpoint_header header{checkpoint_magic, checkpoint_version, cp.next_epoch, cp.n_record, key.size(), state.size(),
+                                   checksum_of(key, state)};
+    std::vector<char> head(sizeof header + padded(key.size()));
+    std::memcpy(head.data(), &header, sizeof header);
+    std::ranges::copy(key, head.begin() + sizeof header);
+    const auto tmp = path + ".tmp";
+    const auto fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) return false;
+    bool ok = true;
+    for (const auto part: {std::span<const char>(head), state}) {
+        for (size_t at = 0; ok && at < part.size();) {
+            const auto n = ::write(fd, part.data() + at, part.size() - at);
+            if (n < 0) ok = false;
+            else at += static_cast<size_t>(n);
+        }
+    }
+    ok = ok && fsync(fd) == 0;
+    ok = close(fd) == 0 && ok;
+    return ok && std::rename(tmp.c_str(), path.c_str()) == 0;
+}
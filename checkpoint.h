@@ -0,0 +1,186 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include "common.h"
+#include "config.h"
+#include "linalg.h"
+#include "population.h"
+#include "trajectory.h"
+
+#include <condition_variable>
+#include <mutex>
+
+// State of an engine as bytes: values are appended with put() and read back in the same order by
+// a snapshot_reader. Values are stored as they are in memory, like trajectories, so a checkpoint
+// is only meant to be resumed on the machine type that wrote it.
+class snapshot {
+public:
+    template<typename T> requires std::is_trivially_copyable_v<T>
+    void put(const T &v) { append(&v, sizeof v); }
+
+    // The size, then the values.
+    template<typename T>
+    void put(std::span<T> v) {
+        put(v.size());
+        append(v.data(), v.size_bytes());
+    }
+
+    template<typename T>
+    void put(const std::vector<T> &v) { put(std::span(v)); }
+
+    // The shape, then every column, fitness included.
+    void put(const population &pop);
+    void put(const matrix &m);
+
+    [[nodiscard]] std::span<const char> bytes() const { return data; }
+
+private:
+    void append(const void *p, size_t size);
+
+    std::vector<char> data;
+};
+
+// Reads a snapshot back. A get() that finds a size or shape other than the target's, or runs past
+// the end, leaves the target alone and fails the reader.
+class snapshot_reader {
+public:
+    explicit snapshot_reader(const std::span<const char> bytes) : bytes(bytes) {}
+
+    template<typename T> requires std::is_trivially_copyable_v<T>
+    void get(T &v) { take(&v, sizeof v); }
+
+    // Into a span of the size that was put.
+    template<typename T>
+    void get(std::span<T> v) {
+        size_t n = 0;
+        get(n);
+        if (n != v.size()) good = false;
+        else take(v.data(), v.size_bytes());
+    }
+
+    template<typename T>
+    void get(std::vector<T> &v) {
+        size_t n = 0;
+        get(n);
+        if (!good || n > (bytes.size() - at) / sizeof(T)) {
+            good = false;
+            return;
+        }
+        v.resize(n);
+        take(v.data(), n * sizeof(T));
+    }
+
+    // Into a population or matrix of the shape that was put.
+    void get(population &pop);
+    void get(matrix &m);
+
+    // For a value the target cannot take: fails the reader, so that every later get() leaves its
+    // target alone.
+    void fail() { good = false; }
+
+    // True when every get() succeeded and the whole snapshot was read.
+    [[nodiscard]] bool done() const { return good && at == bytes.size(); }
+
+private:
+    void take(void *p, size_t size);
+
+    std::span<const char> bytes;
+    size_t at = 0;
+    bool good = true;
+};
+
+// A checkpoint file, mapped: the epoch a run resumes at, how many trajectory records it had kept,
+// and the engine state. The file also holds the layout version of the state, the run's settings
+// key and a checksum of the state.
+class checkpoint_file {
+public:
+    // nullopt, with a message, when path is not a whole checkpoint, was written with another state
+    // layout or was taken with other settings.
+    static std::optional<checkpoint_file> open(const std::string &path, const std::string &key);
+
+    [[nodiscard]] uint64_t epoch() const { return next_epoch; }
+    [[nodiscard]] uint64_t records() const { return n_record; }
+    [[nodiscard]] snapshot_reader state() const { return snapshot_reader(bytes); }
+
+private:
+    struct Unmap {
+        size_t size;
+
+        void operator()(void *p) const;
+    };
+
+    checkpoint_file() = default;
+
+    uint64_t next_epoch = 0;
+    uint64_t n_record = 0;
+    std::span<const char> bytes;
+    std::unique_ptr<void, Unmap> mapping{nullptr, Unmap{0}};
+};
+
+// Where a run keeps its checkpoint, from "checkpoint", and every how many epochs it takes one,
+// from "checkpoint_every"; with the checkpoint to resume from when the file already holds one.
+struct checkpointing {
+    std::string path;
+    size_t every = 100;
+    // The settings of the run, bar the checkpoint settings, "n_epoch", "threads" and "profile",
+    // which a resumed run may change. A checkpoint only resumes a run with the same key.
+    std::string key;
+    std::optional<checkpoint_file> resume;
+
+    [[nodiscard]] bool enabled() const { return !path.empty(); }
+
+    // Whether in, read from resume, held exactly the state of this engine; false, with a message,
+    // when a get() failed or state was left over.
+    [[nodiscard]] bool restored(const snapshot_reader &in) const;
+};
+
+// nullopt, with a message, when a setting is invalid or the file exists but cannot be resumed.
+std::optional<checkpointing> read_checkpointing(const config &cfg);
+
+// Writes checkpoints on a background thread. Each is written to path.tmp, which is then renamed
+// over path, so that the file always holds a whole checkpoint. A checkpoint waits for the
+// trajectory records that came before it to be on file, so that the log can be continued from it.
+// The run never waits for the disk: a snapshot handed over while the previous one is still being
+// written replaces any other that is still waiting.
+class checkpoint_writer {
+public:
+    // log must outlive the writer.
+    checkpoint_writer(const checkpointing &ck, trajectory_writer &log);
+    ~checkpoint_writer();
+
+    checkpoint_writer(const checkpoint_writer &) = delete;
+    checkpoint_writer &operator=(const checkpoint_writer &) = delete;
+
+    // Whether a checkpoint is due at the start of epoch: at every multiple of every, bar the epoch
+    // the run started or resumed at.
+    [[nodiscard]] bool due(const uint64_t epoch) const {
+        return enabled && epoch != first && epoch % every == 0;
+    }
+
+    // Hand over the state of the run at the start of epoch.
+    void save(uint64_t epoch, snapshot state);
+
+private:
+    struct pending_checkpoint {
+        uint64_t next_epoch;
+        uint64_t n_record;
+        snapshot state;
+    };
+
+    void serve();
+    bool write(const pending_checkpoint &cp) const;
+
+    bool enabled;
+    std::string path;
+    size_t every;
+    uint64_t first;
+    std::string key;
+    trajectory_writer &log;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::optional<pending_checkpoint> pending;
+    bool stopping = false;
+    std::jthread writer;
+};
+
+#endif //CHECKPOINT_H
@@ -15,5 +15,16 @@
 #include <ranges>
 #include <bitset>
 #include <cstring>
+#include <numbers>
+#include <numeric>
+#include <span>
+#include <optional>
+#include <bit>
+#include <atomic>
+#include <thread>
+#include <memory>
+#include <barrier>
+#include <latch>
+#include <chrono>
 
 #endif //COMMON_H
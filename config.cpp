@@ -0,0 +1,57 @@
+#include "config.h"
+
+std::string config_trim(const std::string &s) {
+    const auto begin = s.find_first_not_of(" \t\r");
+    if (begin == std::string::npos) return {};
+    return s.substr(begin, s.find_last_not_of(" \t\r") - begin + 1);
+}
+
+std::optional<config> config::parse(std::span<char *const> args) {
+    config cfg;
+    for (size_t i = 0; i < args.size(); ++i) {
+        const std::string arg = args[i];
+        if (arg == "--config") {
+            if (i + 1 == args.size()) {
+                std::cerr << "--config needs a path." << std::endl;
+                return std::nullopt;
+            }
+            if (!cfg.load(args[++i])) return std::nullopt;
+            continue;
+        }
+        const auto eq = arg.find('=');
+        if (eq == std::string::npos || eq == 0) {
+            std::cerr << "Expected key=value, got '" << arg << "'." << std::endl;
+            return std::nullopt;
+        }
+        cfg.set(arg.substr(0, eq), arg.substr(eq + 1));
+    }
+    return cfg;
+}
+
+bool config::load(const std::string &path) {
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        std::cerr << "Failed to open " << path << "." << std::endl;
+        return false;
+    }
+    std::string line;
+    for (size_t n = 1; std::getline(file, line); ++n) {
+        line = config_trim(line.substr(0, line.find('#')));
+        if (line.empty()) continue;
+        const auto eq = line.find('=');
+        if (eq == std::string::npos) {
+            std::cerr << path << ":" << n << ": expected key = value." << std::endl;
+            return false;
+        }
+        set(config_trim(line.substr(0, eq)), config_trim(line.substr(eq + 1)));
+    }
+    return true;
+}
+
+std::vector<std::string> config::unused() const {
+    std::vector<std::string> keys;
+    for (const auto &key: values | std::views::keys) {
+        if (!used.contains(key)) keys.push_back(key);
+    }
+    return keys;
+}
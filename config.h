@@ -0,0 +1,79 @@
+#ifndef CONFIG_H
+#define CONFIG_H
+
+#include "common.h"
+
+#include <charconv>
+#include <map>
+#include <set>
+
+// Flat key=value settings, from command-line arguments and config files. A later setting of a key
+// overrides an earlier one.
+class config {
+public:
+    // Arguments are key=value pairs; "--config path" reads a file of "key = value" lines, where #
+    // starts a comment.
+    static std::optional<config> parse(std::span<char *const> args);
+
+    bool load(const std::string &path);
+    void set(const std::string &key, const std::string &value) { values[key] = value; }
+
+    [[nodiscard]] const std::map<std::string, std::string> &all() const { return values; }
+
+    // Overwrite out with the value of key when it is set. False, with a message, when the value
+    // does not parse; out is then left alone.
+    template<typename T>
+    bool read(const std::string &key, T &out) const {
+        const auto it = values.find(key);
+        if (it == values.end()) return true;
+        used.insert(key);
+        const auto &text = it->second;
+        if constexpr (std::is_same_v<T, std::string>) {
+            out = text;
+            return true;
+        } else if constexpr (std::is_same_v<T, bool>) {
+            if (text == "true" || text == "1") out = true;
+            else if (text == "false" || text == "0") out = false;
+            else return invalid(key, text);
+            return true;
+        } else {
+            T val{};
+            const auto [end, ec] = std::from_chars(text.data(), text.data() + text.size(), val);
+            if (ec != std::errc() || end != text.data() + text.size()) return invalid(key, text);
+            out = val;
+            return true;
+        }
+    }
+
+    // As read, for values named by the given table.
+    template<typename T, size_t N>
+    bool read(const std::string &key, T &out, const std::array<std::pair<std::string_view, T>, N> &names) const {
+        const auto it = values.find(key);
+        if (it == values.end()) return true;
+        used.insert(key);
+        for (const auto &[name, val]: names) {
+            if (name == it->second) {
+                out = val;
+                return true;
+            }
+        }
+        return invalid(key, it->second);
+    }
+
+    // Keys that were set but never read, most likely misspelt.
+    [[nodiscard]] std::vector<std::string> unused() const;
+
+private:
+    static bool invalid(const std::string &key, const std::string &text) {
+        std::cerr << "Invalid value '" << text << "' for " << key << "." << std::endl;
+        return false;
+    }
+
+    std::map<std::string, std::string> values;
+    mutable std::set<std::string> used;
+};
+
+// s without leading and trailing blanks.
+std::string config_trim(const std::string &s);
+
+#endif //CONFIG_H
@@ -1,14 +1,13 @@
 #include "common.h"
-
-using gene = std::array<double, 2>;
-
-double criterion(gene inst) {
-    double x = inst[0];
-    double y = inst[1];
-    double exp1 = -0.2 * std::sqrt((std::pow(x, 2.0) + std::pow(y, 2.0)) / 2.0);
-    double exp2 = (std::cos(2 * std::numbers::pi * x) + std::cos(2 * std::numbers::pi * y)) / 2.0;
-    return -20.0 * std::pow(std::numbers::e, exp1) - std::pow(std::numbers::e, exp2) + 20 + std::numbers::e;
-}
+#include "checkpoint.h"
+#include "engines.h"
+#include "objective.h"
+#include "population.h"
+#include "profile.h"
+#include "rng.h"
+#include "spsc_queue.h"
+#include "termination.h"
+#include "trajectory.h"
 
 using mutate_func = double (*)(double, double, std::array<double, 5> &, double);
 
@@ -32,81 +31,498 @@ double de_rand_2(double cur, double best, std::array<double, 5> &other, double f
     return other[0] + f * (other[1] - other[2]) + f * (other[3] - other[4]);
 }
 
-template<typename T, size_t N>
-    requires std::equality_comparable<T>
-bool array_contains(std::array<T, N> &arr, T &value) {
-    return std::ranges::any_of(arr.begin(), arr.end(), [&](auto elem) { return elem == value; });
-}
-
-template<size_t np, double cr, double f, double bound, size_t n_epoch, mutate_func mutate>
-void demo_de(const std::string &log_name) {
-    static_assert(bound >= 0.0);
-    std::vector<gene> swarm;
-    std::vector<gene> swarm_old;
-    // NOLINTNEXTLINE(*-msc51-cpp) I deliberately want predictable results.
-    std::mt19937 engine;
-    std::uniform_real_distribution d_init(-bound, bound);
-    for (int i = 0; i < np; ++i) {
-        swarm.push_back(gene{d_init(engine), d_init(engine)});
-    }
-    gene best = swarm[0];
-    double best_val = criterion(best);
-    for (auto inst: swarm) {
-        if (criterion(inst) < best_val) {
-            best = inst;
-            best_val = criterion(inst);
-        }
+// k distinct indices below n other than i, from one bounded draw each: the m-th draw picks among
+// the n - 1 - m indices still free and is shifted past the taken ones in ascending order.
+template<size_t k>
+void distinct_others(const uint32_t *bits, const size_t n, const size_t i, std::array<size_t, k> &out) {
+    std::array<size_t, k + 1> taken{i};
+    for (size_t m = 0; m < k; ++m) {
+        const auto n_taken = m + 1;
+        auto idx = static_cast<size_t>(counter_rng::below(bits[m], static_cast<uint32_t>(n - n_taken)));
+        size_t pos = 0;
+        for (; pos < n_taken && taken[pos] <= idx; ++pos) ++idx;
+        std::copy_backward(taken.begin() + pos, taken.begin() + n_taken, taken.begin() + n_taken + 1);
+        taken[pos] = idx;
+        out[m] = idx;
+    }
+}
+
+// Trial values of one dimension for every member: the mutant where the crossover mask is set,
+// the target elsewhere. Kept out of line, as GCC drops the restrict qualifiers when it is inlined
+// and then refuses to vectorize the donor gathers.
+template<mutate_func mutate>
+[[gnu::noinline]] void mutate_column(
+    double *__restrict t, const double *__restrict x, const double best, const double f,
+    const std::array<std::vector<int32_t>, 5> &donor, const uint8_t *__restrict mask, const size_t n) {
+    const auto d0 = donor[0].data(), d1 = donor[1].data(), d2 = donor[2].data();
+    const auto d3 = donor[3].data(), d4 = donor[4].data();
+    for (size_t i = 0; i < n; ++i) {
+        std::array<double, 5> other_mapped{x[d0[i]], x[d1[i]], x[d2[i]], x[d3[i]], x[d4[i]]};
+        const auto m = mutate(x[i], best, other_mapped, f);
+        t[i] = mask[i] ? m : x[i];
+    }
+}
+
+enum class crossover { binomial, exponential };
+
+// Dimension is fixed at compile time, or given at runtime when it is std::dynamic_extent.
+template<size_t dim>
+using genome = std::conditional_t<dim == std::dynamic_extent, std::vector<double>, std::array<double, dim>>;
+
+template<size_t dim>
+struct member {
+    genome<dim> x;
+    double fit;
+};
+
+template<size_t dim, mutate_func mutate, crossover cross>
+struct de_engine {
+    size_t np;
+    size_t n_dim;
+    double cr;
+    double f;
+    const objective &fn;
+    ping_pong<population> swarm;
+    member<dim> best;
+    size_t n_eval = 0;
+
+    // fn must outlive the engine.
+    de_engine(counter_rng &rng, size_t np, size_t n_dim, double cr, double f, double bound, const objective &fn)
+        : np(np), n_dim(n_dim), cr(cr), f(f), fn(fn),
+          swarm{population(np, n_dim), population(np, n_dim)},
+          best{make_genome(), 0.0},
+          start(np), len(np), take(np), draws(np * draws_per_member), prob(np) {
+        const phase_timer timer(phase::init);
+        // Five distinct donors besides the target are needed by the widest strategies.
+        assert(np >= 6);
+        assert(n_dim > 0 && (dim == std::dynamic_extent || n_dim == dim));
+        for (auto &col: donor) col.resize(np);
+        for (size_t j = 0; j < n_dim; ++j) rng.fill_uniform(swarm.cur.col(j), -bound, bound);
+        evaluate(swarm.cur);
+        update_best();
     }
-    std::ofstream log_file;
-    log_file.open(log_name);
-    std::uniform_int_distribution<size_t> d_other(0, np - 1);
-    std::uniform_int_distribution<size_t> d_mandated(0, 1);
-    std::uniform_real_distribution<> d_prob;
-    for (int epoch = 0; epoch < n_epoch; ++epoch) {
-        swarm_old = swarm;
-        for (int i = 0; i < np; ++i) {
+
+    // Build one trial vector per member into the next generation, evaluate each once, then keep
+    // the better of target and trial. Donors and crossover masks are drawn up front, a fixed number
+    // of values per member in bulk, so that the per-dimension loops below are branch-free streams
+    // over the columns.
+    void step(counter_rng &rng) {
+        const auto &cur = swarm.cur;
+        auto &next = swarm.next;
+        phase_timer timer(phase::select);
+        rng.fill_bits(draws);
+        for (size_t i = 0; i < np; ++i) {
+            const auto bits = draws.data() + i * draws_per_member;
             std::array<size_t, 5> other{};
-            for (auto &val: other) {
-                val = std::numeric_limits<size_t>::max();
-            }
-            for (int j = 0; j < 5; ++j) {
-                size_t idx = d_other(engine);
-                while (array_contains(other, idx) || idx == i) idx = d_other(engine);
-                other[j] = idx;
+            distinct_others(bits, np, i, other);
+            for (size_t j = 0; j < 5; ++j) donor[j][i] = static_cast<int32_t>(other[j]);
+            start[i] = counter_rng::below(bits[5], static_cast<uint32_t>(dims()));
+        }
+        timer.switch_to(phase::vary);
+        if constexpr (cross == crossover::exponential) {
+            // The run continues past each component with probability cr, so P(len > k) = cr^k,
+            // which inverts to a single uniform per member.
+            rng.fill_uniform(prob);
+            const auto log_cr = std::log(cr);
+            for (size_t i = 0; i < np; ++i) {
+                const auto extra = cr >= 1.0 ? static_cast<double>(dims()) : std::log(1.0 - prob[i]) / log_cr;
+                len[i] = 1 + static_cast<size_t>(std::min(extra, static_cast<double>(dims() - 1)));
             }
-            auto mandated = d_mandated(engine);
-            for (int j = 0; j < 2; ++j) {
-                if (d_prob(engine) > cr && j != mandated) continue;
-                std::array<double, 5> other_mapped{};
-                for (int k = 0; k < 5; ++k) {
-                    other_mapped[k] = swarm_old[other[k]][j];
-                }
-                gene updated = swarm[i];
-                updated[j] = mutate(swarm[i][j], best[j], other_mapped, f);
-                auto updated_val = criterion(updated);
-                if (updated_val < criterion(swarm[i])) {
-                    swarm[i] = updated;
-                }
-                if (updated_val < best_val) {
-                    best = updated;
-                    best_val = updated_val;
-                }
+        }
+        for (size_t j = 0; j < dims(); ++j) {
+            if constexpr (cross == crossover::binomial) {
+                // Every component is taken from the mutant with probability cr, and at least one always is.
+                rng.fill_uniform(prob);
+                for (size_t i = 0; i < np; ++i) take[i] = j == start[i] || prob[i] < cr;
+            } else {
+                // A run of consecutive components (wrapping around) is taken from the mutant.
+                for (size_t i = 0; i < np; ++i) take[i] = (j + dims() - start[i]) % dims() < len[i];
             }
+            mutate_column<mutate>(next.col(j).data(), cur.col(j).data(), best.x[j], f, donor, take.data(), np);
+        }
+        evaluate(next);
+        timer.switch_to(phase::update);
+        const auto next_fit = next.fit();
+        const auto cur_fit = cur.fit();
+        for (size_t i = 0; i < np; ++i) take[i] = next_fit[i] <= cur_fit[i];
+        for (size_t j = 0; j <= dims(); ++j) {
+            const auto x = cur.col(j);
+            const auto t = next.col(j);
+            for (size_t i = 0; i < np; ++i) t[i] = take[i] ? t[i] : x[i];
         }
-        log_file << best[0] << " " << best[1] << " " << best_val;
-        for (auto inst: swarm) {
-            log_file << " " << inst[0] << " " << inst[1] << " " << criterion(inst);
+        swarm.flip();
+        update_best();
+    }
+
+    void save(snapshot &out) const {
+        out.put(swarm.cur);
+        out.put(best.x);
+        out.put(best.fit);
+        out.put(n_eval);
+    }
+
+    void restore(snapshot_reader &in) {
+        in.get(swarm.cur);
+        in.get(best.x);
+        in.get(best.fit);
+        in.get(n_eval);
+    }
+
+    // Copies of the k best members, best first.
+    [[nodiscard]] std::vector<member<dim>> elite(const size_t k) const {
+        const auto order = ranked(k, std::less{});
+        std::vector<member<dim>> out;
+        for (const auto i: order) {
+            out.push_back(member<dim>{make_genome(), swarm.cur.fit()[i]});
+            swarm.cur.gather(i, out.back().x);
         }
-        log_file << std::endl;
+        return out;
+    }
+
+    // Replace the worst members with the given ones.
+    void immigrate(std::span<const member<dim>> in) {
+        const auto order = ranked(in.size(), std::greater{});
+        for (size_t k = 0; k < in.size(); ++k) {
+            swarm.cur.scatter(order[k], in[k].x);
+            swarm.cur.fit()[order[k]] = in[k].fit;
+        }
+        update_best();
+    }
+
+private:
+    // Five donors and the crossover start.
+    static constexpr size_t draws_per_member = 6;
+    std::array<std::vector<int32_t>, 5> donor;
+    std::vector<size_t> start;
+    std::vector<size_t> len;
+    std::vector<uint8_t> take;
+    std::vector<uint32_t> draws;
+    std::vector<double> prob;
+
+    // Compile-time dimensions give the column loops constant trip counts.
+    [[nodiscard]] size_t dims() const {
+        if constexpr (dim == std::dynamic_extent) return n_dim;
+        else return dim;
+    }
+
+    genome<dim> make_genome() const {
+        if constexpr (dim == std::dynamic_extent) return genome<dim>(n_dim);
+        else return genome<dim>{};
+    }
+
+    void evaluate(population &pop) {
+        fn.evaluate(pop);
+        n_eval += np;
+    }
+
+    // Indices of the first k members when ordered by fitness with cmp.
+    template<typename Compare>
+    [[nodiscard]] std::vector<size_t> ranked(const size_t k, Compare cmp) const {
+        const auto fit = swarm.cur.fit();
+        std::vector<size_t> order(np);
+        std::iota(order.begin(), order.end(), 0);
+        std::partial_sort(order.begin(), order.begin() + static_cast<ptrdiff_t>(k), order.end(),
+            [&](size_t a, size_t b) { return cmp(fit[a], fit[b]); });
+        order.resize(k);
+        return order;
+    }
+
+    void update_best() {
+        const auto fit = swarm.cur.fit();
+        const auto i = static_cast<size_t>(std::ranges::min_element(fit) - fit.begin());
+        swarm.cur.gather(i, best.x);
+        best.fit = fit[i];
+    }
+};
+
+enum class de_strategy { rand_1, best_1, cur2best_1, best_2, rand_2 };
+
+constexpr std::array<std::pair<std::string_view, de_strategy>, 5> de_strategy_names{{
+    {"rand_1", de_strategy::rand_1}, {"best_1", de_strategy::best_1}, {"cur2best_1", de_strategy::cur2best_1},
+    {"best_2", de_strategy::best_2}, {"rand_2", de_strategy::rand_2},
+}};
+
+constexpr std::array<std::pair<std::string_view, crossover>, 2> crossover_names{{
+    {"binomial", crossover::binomial}, {"exponential", crossover::exponential},
+}};
+
+struct de_params {
+    size_t np;
+    double cr;
+    double f;
+    double bound;
+    size_t n_epoch;
+    size_t n_dim;
+    de_strategy strategy;
+    crossover cross;
+    uint64_t seed;
+    problem fn{landscape::ackley};
+};
+
+enum class topology { ring, random };
+
+constexpr std::array<std::pair<std::string_view, topology>, 2> topology_names{{
+    {"ring", topology::ring}, {"random", topology::random},
+}};
+
+// Streams of an island run derive from its seed by these ids, then by round or island.
+constexpr uint64_t migration_streams = 0;
+constexpr uint64_t island_streams = 1;
+
+struct island_params {
+    size_t n_island;
+    // Generations between migrations.
+    size_t interval;
+    // Members each island sends out at every migration.
+    size_t n_migrant;
+    topology topo;
+};
+
+template<size_t dim, mutate_func mutate, crossover cross>
+std::optional<run_summary> de_run(const de_params &p, const std::string &log_name, const sampling policy,
+                                  const checkpointing &ck, const stopping &crit) {
+    counter_rng rng(p.seed);
+    const objective fn(p.fn, p.n_dim);
+    de_engine<dim, mutate, cross> de(rng, p.np, p.n_dim, p.cr, p.f, p.bound, fn);
+    convergence watch(crit);
+    size_t first = 0;
+    if (ck.resume) {
+        auto in = ck.resume->state();
+        de.restore(in);
+        in.get(rng);
+        watch.restore(in);
+        if (!ck.restored(in)) return std::nullopt;
+        first = ck.resume->epoch();
+    }
+    const auto width = static_cast<uint32_t>(p.n_dim + 1);
+    trajectory_writer log(log_name, {trajectory_layout::population, width, static_cast<uint32_t>(p.np), width}, policy,
+                          ck.resume ? ck.resume->records() : 0);
+    checkpoint_writer saver(ck, log);
+    const auto spread = [&] {
+        spread_sum sum(p.n_dim);
+        sum.add(de.swarm.cur);
+        return sum.value();
+    };
+    auto stop = stop_reason::epochs;
+    for (size_t epoch = first; epoch < p.n_epoch; ++epoch) {
+        if (saver.due(epoch)) {
+            snapshot out;
+            de.save(out);
+            out.put(rng);
+            watch.save(out);
+            saver.save(epoch, std::move(out));
+        }
+        de.step(rng);
+        const auto why = watch.check(de.best.fit, de.n_eval, spread);
+        const phase_timer timer(phase::log);
+        if (const auto rec = log.record(epoch); !rec.empty()) {
+            auto out = std::ranges::copy(de.best.x, rec.begin()).out;
+            *out++ = de.best.fit;
+            const auto &swarm = de.swarm.cur;
+            for (size_t j = 0; j <= swarm.dim(); ++j) out = std::ranges::copy(swarm.col(j), out).out;
+        }
+        if (why) {
+            stop = *why;
+            break;
+        }
+    }
+    return run_summary{de.best.fit, de.n_eval, stop};
+}
+
+// Migration targets of one round: island i sends to dest[i]. The random topology is a ring over
+// a shuffled order, so every island sends and receives exactly once; all threads derive the same
+// shuffle from the seed and the round.
+inline std::vector<size_t> migration_targets(const island_params &params, const uint64_t seed, const size_t round) {
+    std::vector<size_t> order(params.n_island);
+    std::iota(order.begin(), order.end(), 0);
+    if (params.topo == topology::random) {
+        auto rng = counter_rng(seed).split(migration_streams).split(round);
+        for (size_t k = order.size() - 1; k > 0; --k) {
+            std::swap(order[k], order[rng.below(static_cast<uint32_t>(k + 1))]);
+        }
+    }
+    std::vector<size_t> dest(params.n_island);
+    for (size_t k = 0; k < params.n_island; ++k) {
+        dest[order[k]] = order[(k + 1) % params.n_island];
+    }
+    return dest;
+}
+
+// Island model: every island evolves its own population on its own thread and, every interval
+// generations, sends copies of its best members to its target island, where they replace the
+// worst ones. Each island waits for its own immigrants of a round before going on, so a run only
+// depends on the seed and the number of islands, never on thread timing. Queues hold two rounds
+// of migrants, so an island that runs a round ahead never deadlocks on a slower one.
+template<size_t dim, mutate_func mutate, crossover cross>
+run_summary de_run_islands(const de_params &p, const island_params &params, const std::string &log_name,
+                           const sampling policy) {
+    assert(params.n_island >= 2 && params.interval > 0 && params.n_migrant < p.np);
+    const auto n_island = params.n_island;
+    using queue = spsc_queue<member<dim>>;
+    // One queue per ordered pair of islands, since the random topology may link any two.
+    std::vector<std::unique_ptr<queue>> links(n_island * n_island);
+    for (auto &link: links) link = std::make_unique<queue>(2 * params.n_migrant);
+    std::vector<std::vector<double>> history(n_island, std::vector<double>(p.n_epoch));
+    std::vector<size_t> n_eval(n_island);
+    const objective fn(p.fn, p.n_dim);
+    {
+        std::vector<std::jthread> workers;
+        for (size_t id = 0; id < n_island; ++id) {
+            workers.emplace_back([&, id] {
+                auto rng = counter_rng(p.seed).split(island_streams).split(id);
+                de_engine<dim, mutate, cross> de(rng, p.np, p.n_dim, p.cr, p.f, p.bound, fn);
+                // Sources of the current round, i.e. the inverse of the targets.
+                std::vector<size_t> source(n_island);
+                for (size_t epoch = 0; epoch < p.n_epoch; ++epoch) {
+                    de.step(rng);
+                    if ((epoch + 1) % params.interval == 0 && params.n_migrant > 0) {
+                        const auto dest = migration_targets(params, p.seed, (epoch + 1) / params.interval);
+                        for (size_t k = 0; k < n_island; ++k) source[dest[k]] = k;
+                        auto &out = *links[id * n_island + dest[id]];
+                        for (auto &m: de.elite(params.n_migrant)) out.push(std::move(m));
+                        auto &in = *links[source[id] * n_island + id];
+                        std::vector<member<dim>> arrivals;
+                        {
+                            const phase_timer timer(phase::wait);
+                            for (size_t k = 0; k < params.n_migrant; ++k) arrivals.push_back(in.pop());
+                        }
+                        de.immigrate(arrivals);
+                    }
+                    history[id][epoch] = de.best.fit;
+                }
+                n_eval[id] = de.n_eval;
+            });
+        }
+    }
+    trajectory_writer log(log_name, {trajectory_layout::flat, static_cast<uint32_t>(n_island + 1), 0, 0}, policy);
+    double best = std::numeric_limits<double>::max();
+    for (size_t epoch = 0; epoch < p.n_epoch; ++epoch) {
+        double epoch_best = std::numeric_limits<double>::max();
+        for (size_t id = 0; id < n_island; ++id) epoch_best = std::min(epoch_best, history[id][epoch]);
+        best = std::min(best, epoch_best);
+        const auto rec = log.record(epoch);
+        if (rec.empty()) continue;
+        rec[0] = epoch_best;
+        for (size_t id = 0; id < n_island; ++id) rec[id + 1] = history[id][epoch];
+    }
+    return {best, std::reduce(n_eval.begin(), n_eval.end())};
+}
+
+// Compiled DE kernels: one for every strategy and crossover at each dimension of de_fast_dims,
+// where the column loops get constant trip counts, and one at std::dynamic_extent that runs every
+// other dimension.
+struct de_kernel {
+    de_strategy strategy;
+    crossover cross;
+    size_t dim;
+    std::optional<run_summary> (*run)(const de_params &, const std::string &, sampling, const checkpointing &,
+                                      const stopping &);
+    run_summary (*run_islands)(const de_params &, const island_params &, const std::string &, sampling);
+};
+
+template<size_t dim, crossover cross>
+constexpr std::array<de_kernel, 5> de_kernel_row() {
+    const auto kernel = [](const de_strategy strategy, auto mutate) {
+        constexpr auto m = decltype(mutate)::value;
+        return de_kernel{strategy, cross, dim, de_run<dim, m, cross>, de_run_islands<dim, m, cross>};
+    };
+    return {
+        kernel(de_strategy::rand_1, std::integral_constant<mutate_func, de_rand_1>{}),
+        kernel(de_strategy::best_1, std::integral_constant<mutate_func, de_best_1>{}),
+        kernel(de_strategy::cur2best_1, std::integral_constant<mutate_func, de_cur2best_1>{}),
+        kernel(de_strategy::best_2, std::integral_constant<mutate_func, de_best_2>{}),
+        kernel(de_strategy::rand_2, std::integral_constant<mutate_func, de_rand_2>{}),
+    };
+}
+
+template<typename T, size_t... n>
+constexpr std::array<T, (n + ...)> array_concat(const std::array<T, n> &... parts) {
+    std::array<T, (n + ...)> out{};
+    auto it = out.begin();
+    ((it = std::ranges::copy(parts, it).out), ...);
+    return out;
+}
+
+template<size_t... dims>
+constexpr auto de_kernel_table() {
+    return array_concat(de_kernel_row<dims, crossover::binomial>()..., de_kernel_row<dims, crossover::exponential>()...);
+}
+
+constexpr auto de_kernels = de_kernel_table<2, 10, 30, std::dynamic_extent>();
+
+const de_kernel &find_de_kernel(const de_params &p) {
+    const de_kernel *generic = nullptr;
+    for (const auto &k: de_kernels) {
+        if (k.strategy != p.strategy || k.cross != p.cross) continue;
+        if (k.dim == p.n_dim) return k;
+        if (k.dim == std::dynamic_extent) generic = &k;
+    }
+    return *generic;
+}
+
+std::optional<run_summary> run_de(const de_params &p, const std::string &log_name, const sampling policy = {},
+                                  const checkpointing &ck = {}, const stopping &crit = {}) {
+    return find_de_kernel(p).run(p, log_name, policy, ck, crit);
+}
+
+run_summary run_de_islands(const de_params &p, const island_params &params, const std::string &log_name,
+                           const sampling policy = {}) {
+    return find_de_kernel(p).run_islands(p, params, log_name, policy);
+}
+
+std::optional<run_summary> run_de(const config &cfg) {
+    de_params p{20, 0.5, 0.5, 4.0, 300, 2, de_strategy::rand_1, crossover::binomial, 0};
+    island_params islands{1, 10, 2, topology::ring};
+    std::string log_name;
+    sampling policy;
+    if (!(cfg.read("np", p.np) && cfg.read("cr", p.cr) && cfg.read("f", p.f) && cfg.read("bound", p.bound) &&
+          cfg.read("n_epoch", p.n_epoch) && cfg.read("n_dim", p.n_dim) &&
+          cfg.read("strategy", p.strategy, de_strategy_names) && cfg.read("crossover", p.cross, crossover_names) &&
+          cfg.read("seed", p.seed) && cfg.read("islands", islands.n_island) &&
+          cfg.read("interval", islands.interval) && cfg.read("migrants", islands.n_migrant) &&
+          cfg.read("topology", islands.topo, topology_names) && cfg.read("log", log_name) &&
+          cfg.read("log_every", policy.every))) {
+        return std::nullopt;
+    }
+    if (p.np < 6 || p.n_dim == 0 || p.bound < 0.0 || p.cr < 0.0 || p.cr > 1.0 || islands.n_island == 0 ||
+        (islands.n_island > 1 && (islands.interval == 0 || islands.n_migrant >= p.np))) {
+        std::cerr << "DE needs np >= 6, n_dim >= 1, bound >= 0, cr in [0, 1], and with islands an interval "
+            "of at least 1 and fewer migrants than np." << std::endl;
+        return std::nullopt;
+    }
+    const auto fn = read_problem(cfg, p.fn);
+    const auto ck = read_checkpointing(cfg);
+    const auto crit = read_stopping(cfg);
+    const auto again = read_restarts(cfg);
+    if (!(fn && ck && crit && again)) return std::nullopt;
+    p.fn = *fn;
+    if (islands.n_island > 1 && (ck->enabled() || crit->any())) {
+        std::cerr << "DE islands cannot be checkpointed or stopped early." << std::endl;
+        return std::nullopt;
     }
-    log_file.close();
+    const auto one_run = [&](const size_t n, const uint64_t seed, const stopping &left,
+                             const size_t index) -> std::optional<run_summary> {
+        auto q = p;
+        q.np = n;
+        q.seed = seed;
+        const auto name = restart_log_name(log_name, index);
+        if (islands.n_island > 1) return run_de_islands(q, islands, name, policy);
+        return run_de(q, name, policy, *ck, left);
+    };
+    return run_restarts(*again, *crit, p.np, p.seed, one_run);
 }
 
 void main_de() {
     std::cout << "--> Differential Evolution Algorithm" << std::endl;
-    demo_de<20, 0.5, 0.5, 4.0, 300, de_rand_1>("de_rand_1.log");
-    demo_de<20, 0.5, 0.5, 4.0, 300, de_best_1>("de_best_1.log");
-    demo_de<20, 0.5, 0.5, 4.0, 300, de_cur2best_1>("de_cur2best_1.log");
-    demo_de<20, 0.5, 0.5, 4.0, 300, de_best_2>("de_best_2.log");
-    demo_de<20, 0.5, 0.5, 4.0, 300, de_rand_2>("de_rand_2.log");
+    run_de({20, 0.5, 0.5, 4.0, 300, 2, de_strategy::rand_1, crossover::binomial, 0}, "de_rand_1.trj");
+    run_de({20, 0.5, 0.5, 4.0, 300, 2, de_strategy::best_1, crossover::binomial, 0}, "de_best_1.trj");
+    run_de({20, 0.5, 0.5, 4.0, 300, 2, de_strategy::cur2best_1, crossover::binomial, 0}, "de_cur2best_1.trj");
+    run_de({20, 0.5, 0.5, 4.0, 300, 2, de_strategy::best_2, crossover::binomial, 0}, "de_best_2.trj");
+    run_de({20, 0.5, 0.5, 4.0, 300, 2, de_strategy::rand_2, crossover::binomial, 0}, "de_rand_2.trj");
+    run_de({20, 0.9, 0.5, 4.0, 300, 2, de_strategy::rand_1, crossover::exponential, 0}, "de_rand_1_exp.trj");
+    run_de({50, 0.9, 0.5, 4.0, 300, 10, de_strategy::rand_1, crossover::binomial, 0}, "de_rand_1_10d.trj");
+    run_de_islands({20, 0.9, 0.5, 4.0, 300, 10, de_strategy::rand_1, crossover::binomial, 0},
+        {4, 10, 2, topology::ring}, "de_islands_ring.trj");
+    run_de_islands({20, 0.9, 0.5, 4.0, 300, 10, de_strategy::best_1, crossover::binomial, 0},
+        {4, 10, 2, topology::random}, "de_islands_random.trj");
 }
@@ -1,46 +1,458 @@
 #include "common.h"
+#include "checkpoint.h"
+#include "engines.h"
+#include "linalg.h"
+#include "objective.h"
+#include "population.h"
+#include "profile.h"
+#include "rng.h"
+#include "termination.h"
+#include "trajectory.h"
 
-using gene = std::array<double, 2>;
-double criterion(gene inst);
-
-template<size_t n_flock, size_t n_choice, size_t n_epoch, double mean1, double std1, double mean2, double std2>
-void demo_eda(const std::string &log_name) {
-    std::ofstream log_file;
-    log_file.open(log_name);
-    // NOLINTNEXTLINE(*-msc51-cpp) I deliberately want predictable results.
-    std::mt19937 engine;
-    std::array<gene, n_flock> flock {};
-    std::array mean { mean1, mean2 }, std { std1, std2 };
-    std::normal_distribution dist1(mean[0], std[0]), dist2(mean[1], std[1]);
-    for (auto & it: flock) {
-        it = gene { dist1(engine), dist2(engine) };
-    }
-    for (int epoch = 0; epoch < n_epoch; ++epoch) {
-        std::sort(flock.begin(), flock.end(),
-            [](const gene & a, const gene & b) { return criterion(a) < criterion(b); });
-        double sum1 = 0.0, sum2 = 0.0;
-        for (int i = 0; i < n_choice; ++i) {
-            sum1 += flock[i][0];
-            sum2 += flock[i][1];
-        }
-        mean = { sum1 / n_choice, sum2 / n_choice };
-        std = { 0.0, 0.0 };
-        for (auto & it: flock) {
-            std[0] += (it[0] - mean[0]) * (it[0] - mean[0]);
-            std[1] += (it[1] - mean[1]) * (it[1] - mean[1]);
-        }
-        std[0] = std::sqrt(std[0] / n_flock);
-        std[1] = std::sqrt(std[1] / n_flock);
-        for (auto & it: flock) {
-            it[0] = std::normal_distribution(mean[0], std[0])(engine);
-            it[1] = std::normal_distribution(mean[1], std[1])(engine);
-        }
-        log_file << criterion(flock[0]) << " " << mean[0] << " " << std[0] << " " << mean[1] << " " << std[1] << std::endl;
-    }
-    log_file.close();
+// axis: an independent normal per axis (UMDA-like). emna: a full covariance refitted to the
+// selected set every epoch (EMNA-global). cma: CMA-ES, which adapts the covariance and a step size
+// from the weighted selected steps and two evolution paths.
+enum class eda_model { axis, emna, cma };
+
+constexpr std::array<std::pair<std::string_view, eda_model>, 3> eda_model_names{{
+    {"axis", eda_model::axis}, {"emna", eda_model::emna}, {"cma", eda_model::cma}
+}};
+
+struct eda_params {
+    size_t n_flock;
+    size_t n_choice;
+    size_t n_epoch;
+    // Initial mean and standard deviation of each axis; their size is the dimension.
+    std::vector<double> mean;
+    std::vector<double> std;
+    uint64_t seed;
+    eda_model model = eda_model::axis;
+    // Epochs between Cholesky factorizations of the covariance; 0 picks one per model.
+    size_t factor_every = 0;
+    problem fn{landscape::ackley};
+};
+
+std::optional<run_summary> demo_eda(const eda_params &params, const std::string &log_name, const sampling policy = {},
+                                    const checkpointing &ck = {}, const stopping &crit = {}) {
+    const auto n_flock = params.n_flock;
+    const auto n_choice = params.n_choice;
+    const auto n_dim = params.mean.size();
+    counter_rng rng(params.seed);
+    const objective fn(params.fn, n_dim);
+    population flock(n_flock, n_dim);
+    auto mean = params.mean, std = params.std;
+    {
+        const phase_timer timer(phase::init);
+        for (size_t j = 0; j < n_dim; ++j) rng.fill_normal(flock.col(j), mean[j], std[j]);
+        fn.evaluate(flock);
+    }
+    double best = std::ranges::min(flock.fit());
+    convergence watch(crit);
+    size_t first = 0;
+    if (ck.resume) {
+        auto in = ck.resume->state();
+        in.get(flock);
+        in.get(std::span(mean));
+        in.get(std::span(std));
+        in.get(best);
+        in.get(rng);
+        watch.restore(in);
+        if (!ck.restored(in)) return std::nullopt;
+        first = ck.resume->epoch();
+    }
+    trajectory_writer log(log_name, {trajectory_layout::flat, static_cast<uint32_t>(1 + 2 * n_dim), 0, 0}, policy,
+                          ck.resume ? ck.resume->records() : 0);
+    checkpoint_writer saver(ck, log);
+    // The model's spread: the root mean square of its standard deviations.
+    const auto spread = [&] {
+        return std::sqrt(std::transform_reduce(std.begin(), std.end(), std.begin(), 0.0) / static_cast<double>(n_dim));
+    };
+    auto stop = stop_reason::epochs;
+    auto n_epoch = params.n_epoch;
+    std::vector<size_t> order(n_flock);
+    for (size_t epoch = first; epoch < params.n_epoch; ++epoch) {
+        if (saver.due(epoch)) {
+            snapshot out;
+            out.put(flock);
+            out.put(mean);
+            out.put(std);
+            out.put(best);
+            out.put(rng);
+            watch.save(out);
+            saver.save(epoch, std::move(out));
+        }
+        phase_timer timer(phase::select);
+        const auto fit = flock.fit();
+        // Every member is evaluated once into the fitness column, so truncation only has to
+        // partition the indices around the n_choice-th best, in linear time.
+        std::iota(order.begin(), order.end(), 0);
+        std::ranges::nth_element(order, order.begin() + static_cast<ptrdiff_t>(n_choice - 1), std::less{},
+                                 [&](const size_t i) { return fit[i]; });
+        timer.switch_to(phase::update);
+        for (size_t j = 0; j < mean.size(); ++j) {
+            const auto x = flock.col(j);
+            double sum = 0.0;
+            for (size_t i = 0; i < n_choice; ++i) sum += x[order[i]];
+            // The spread of the whole flock about the new mean, in one pass over the column: the
+            // sums are taken about the previous mean, which keeps them small, and moved over after.
+            // Each lane keeps its own sums so that the loop vectorises without reordering additions.
+            constexpr size_t lanes = 8;
+            const auto shift = mean[j];
+            std::array<double, lanes> part_d{}, part_d2{};
+            size_t i = 0;
+            for (; i + lanes <= n_flock; i += lanes) {
+                for (size_t l = 0; l < lanes; ++l) {
+                    const auto d = x[i + l] - shift;
+                    part_d[l] += d;
+                    part_d2[l] += d * d;
+                }
+            }
+            for (size_t l = 0; i < n_flock; ++i, ++l) {
+                const auto d = x[i] - shift;
+                part_d[l] += d;
+                part_d2[l] += d * d;
+            }
+            const auto sum_d = std::reduce(part_d.begin(), part_d.end());
+            const auto sum_d2 = std::reduce(part_d2.begin(), part_d2.end());
+            mean[j] = sum / static_cast<double>(n_choice);
+            const auto move = mean[j] - shift;
+            const auto n = static_cast<double>(n_flock);
+            std[j] = std::sqrt(std::max(0.0, sum_d2 / n - 2.0 * move * sum_d / n + move * move));
+        }
+        timer.switch_to(phase::vary);
+        for (size_t j = 0; j < n_dim; ++j) rng.fill_normal(flock.col(j), mean[j], std[j]);
+        fn.evaluate(flock);
+        timer.switch_to(phase::update);
+        best = std::min(best, std::ranges::min(fit));
+        const auto why = watch.check(best, n_flock * (epoch + 2), spread);
+        timer.switch_to(phase::log);
+        if (const auto rec = log.record(epoch); !rec.empty()) {
+            rec[0] = fit[0];
+            for (size_t j = 0; j < n_dim; ++j) {
+                rec[1 + 2 * j] = mean[j];
+                rec[2 + 2 * j] = std[j];
+            }
+        }
+        if (why) {
+            stop = *why;
+            n_epoch = epoch + 1;
+            break;
+        }
+    }
+    return run_summary{best, n_flock * (n_epoch + 1), stop};
+}
+
+// Multivariate normal N(mean, sigma^2 C) over n_dim axes, sampled a flock at a time as
+// x = mean + sigma L z with L the Cholesky factor of C. Only the lower triangle of C is kept. The
+// factor is refreshed every factor_every epochs, as the covariance drifts slowly; until then the
+// model samples from the last factor, with which the steps it learns from stay consistent.
+struct gaussian_model {
+    size_t n_dim;
+    std::vector<double> mean;
+    double sigma = 1.0;
+    matrix cov, factor;
+    // Standard normal draws of the last flock and the steps L z they made, one row per axis and
+    // one column per member.
+    matrix z, y;
+    // Weighted steps of the selected members, one per row, for the rank-mu update.
+    matrix steps;
+
+    gaussian_model(const eda_params &params, const size_t n_step)
+        : n_dim(params.mean.size()), mean(params.mean), cov(n_dim, n_dim), factor(n_dim, n_dim),
+          z(n_dim, params.n_flock), y(n_dim, params.n_flock), steps(n_step, n_dim) {
+        for (size_t j = 0; j < n_dim; ++j) cov(j, j) = params.std[j] * params.std[j];
+        refactor();
+    }
+
+    void sample(counter_rng &rng, population &flock) {
+        rng.fill_normal(z.storage());
+        z.clear_padding();
+        lower_times(factor, z, y);
+        for (size_t j = 0; j < n_dim; ++j) {
+            const auto x = flock.col(j);
+            const auto step = y.row(j);
+            for (size_t i = 0; i < x.size(); ++i) x[i] = mean[j] + sigma * step[i];
+        }
+    }
+
+    // Factorizes the covariance. Rounding can leave it slightly indefinite, in which case the
+    // diagonal is raised by a growing fraction of its mean until the factorization succeeds; the
+    // old factor stays when even that fails.
+    void refactor() {
+        double trace = 0.0;
+        for (size_t j = 0; j < n_dim; ++j) trace += cov(j, j);
+        auto ridge = 1e-14 * trace / static_cast<double>(n_dim);
+        for (int attempt = 0; attempt < 8 && !cholesky(cov, factor); ++attempt, ridge *= 100.0) {
+            for (size_t j = 0; j < n_dim; ++j) cov(j, j) += ridge;
+        }
+    }
+
+    // The last sample's z and y are kept too, as CMA-ES learns from them.
+    void save(snapshot &out) const {
+        out.put(mean);
+        out.put(sigma);
+        out.put(cov);
+        out.put(factor);
+        out.put(z);
+        out.put(y);
+    }
+
+    void restore(snapshot_reader &in) {
+        in.get(std::span(mean));
+        in.get(sigma);
+        in.get(cov);
+        in.get(factor);
+        in.get(z);
+        in.get(y);
+    }
+
+    // Root mean square spread of the model over the axes.
+    [[nodiscard]] double spread() const {
+        double trace = 0.0;
+        for (size_t j = 0; j < n_dim; ++j) trace += cov(j, j);
+        return sigma * std::sqrt(trace / static_cast<double>(n_dim));
+    }
+};
+
+// EMNA-global: the mean and the maximum-likelihood covariance of the n_choice selected members,
+// whose indices lead elite.
+void fit_emna(gaussian_model &model, const population &flock, const std::span<const size_t> elite) {
+    const auto n_choice = static_cast<double>(elite.size());
+    for (size_t j = 0; j < model.n_dim; ++j) {
+        const auto x = flock.col(j);
+        double sum = 0.0;
+        for (const auto i: elite) sum += x[i];
+        model.mean[j] = sum / n_choice;
+    }
+    const auto scale = 1.0 / std::sqrt(n_choice);
+    for (size_t k = 0; k < elite.size(); ++k) {
+        const auto row = model.steps.row(k);
+        for (size_t j = 0; j < model.n_dim; ++j) row[j] = (flock.col(j)[elite[k]] - model.mean[j]) * scale;
+    }
+    rank_update(model.cov, 0.0, model.steps, elite.size());
+}
+
+// CMA-ES state besides the model, with the default learning rates of Hansen, "The CMA Evolution
+// Strategy: A Tutorial" (2016). The factor takes the place of C^(1/2): the selected z, which are
+// L^-1 of the steps, drive the step-size path.
+struct cma_state {
+    std::vector<double> weights;
+    double mu_eff, c_sigma, d_sigma, c_c, c_1, c_mu, chi_n;
+    std::vector<double> p_sigma, p_c, step_w, z_w;
+
+    cma_state(const size_t n_dim, const size_t n_choice)
+        : weights(n_choice), p_sigma(n_dim), p_c(n_dim), step_w(n_dim), z_w(n_dim) {
+        for (size_t k = 0; k < n_choice; ++k) {
+            weights[k] = std::log(static_cast<double>(n_choice) + 0.5) - std::log(static_cast<double>(k + 1));
+        }
+        const auto sum = std::reduce(weights.begin(), weights.end());
+        for (auto &w: weights) w /= sum;
+        mu_eff = 1.0 / std::transform_reduce(weights.begin(), weights.end(), weights.begin(), 0.0);
+        const auto n = static_cast<double>(n_dim);
+        c_sigma = (mu_eff + 2.0) / (n + mu_eff + 5.0);
+        d_sigma = 1.0 + 2.0 * std::max(0.0, std::sqrt((mu_eff - 1.0) / (n + 1.0)) - 1.0) + c_sigma;
+        c_c = (4.0 + mu_eff / n) / (n + 4.0 + 2.0 * mu_eff / n);
+        c_1 = 2.0 / ((n + 1.3) * (n + 1.3) + mu_eff);
+        c_mu = std::min(1.0 - c_1, 2.0 * (mu_eff - 2.0 + 1.0 / mu_eff) / ((n + 2.0) * (n + 2.0) + mu_eff));
+        chi_n = std::sqrt(n) * (1.0 - 1.0 / (4.0 * n) + 1.0 / (21.0 * n * n));
+    }
+
+    // Epochs between factorizations, as in the tutorial's lazy eigendecomposition.
+    [[nodiscard]] size_t factor_gap(const size_t n_dim) const {
+        return std::max<size_t>(1, static_cast<size_t>(1.0 / ((c_1 + c_mu) * static_cast<double>(n_dim) * 10.0)));
+    }
+};
+
+// One CMA-ES update from the last flock, whose n_choice best members lead elite, best first.
+void fit_cma(gaussian_model &model, cma_state &cma, const std::span<const size_t> elite, const size_t epoch) {
+    const auto n_dim = model.n_dim;
+    std::ranges::fill(cma.step_w, 0.0);
+    std::ranges::fill(cma.z_w, 0.0);
+    for (size_t j = 0; j < n_dim; ++j) {
+        const auto y = model.y.row(j), z = model.z.row(j);
+        for (size_t k = 0; k < elite.size(); ++k) {
+            cma.step_w[j] += cma.weights[k] * y[elite[k]];
+            cma.z_w[j] += cma.weights[k] * z[elite[k]];
+        }
+    }
+    const auto path_sigma = std::sqrt(cma.c_sigma * (2.0 - cma.c_sigma) * cma.mu_eff);
+    double norm2 = 0.0;
+    for (size_t j = 0; j < n_dim; ++j) {
+        model.mean[j] += model.sigma * cma.step_w[j];
+        cma.p_sigma[j] = (1.0 - cma.c_sigma) * cma.p_sigma[j] + path_sigma * cma.z_w[j];
+        norm2 += cma.p_sigma[j] * cma.p_sigma[j];
+    }
+    const auto norm = std::sqrt(norm2);
+    // The covariance path stalls while the step-size path is long, so that C does not grow along
+    // a direction that sigma is still catching up with.
+    const auto unbias = std::sqrt(1.0 - std::pow(1.0 - cma.c_sigma, 2.0 * static_cast<double>(epoch + 1)));
+    const auto h_sigma = norm / unbias < (1.4 + 2.0 / (static_cast<double>(n_dim) + 1.0)) * cma.chi_n;
+    const auto path_c = h_sigma ? std::sqrt(cma.c_c * (2.0 - cma.c_c) * cma.mu_eff) : 0.0;
+    for (size_t j = 0; j < n_dim; ++j) cma.p_c[j] = (1.0 - cma.c_c) * cma.p_c[j] + path_c * cma.step_w[j];
+
+    // Rank-one and rank-mu updates together, as one symmetric update by the rows of steps.
+    for (size_t k = 0; k < elite.size(); ++k) {
+        const auto row = model.steps.row(k);
+        const auto scale = std::sqrt(cma.c_mu * cma.weights[k]);
+        for (size_t j = 0; j < n_dim; ++j) row[j] = scale * model.y(j, elite[k]);
+    }
+    const auto last = model.steps.row(elite.size());
+    for (size_t j = 0; j < n_dim; ++j) last[j] = std::sqrt(cma.c_1) * cma.p_c[j];
+    const auto keep = 1.0 - cma.c_1 - cma.c_mu + (h_sigma ? 0.0 : cma.c_1 * cma.c_c * (2.0 - cma.c_c));
+    rank_update(model.cov, keep, model.steps, elite.size() + 1);
+    model.sigma *= std::exp(cma.c_sigma / cma.d_sigma * (norm / cma.chi_n - 1.0));
+}
+
+// EDA with a full covariance: EMNA-global or CMA-ES. Records hold the best value of the epoch,
+// the spread of the model and its mean.
+std::optional<run_summary> demo_gaussian(const eda_params &params, const std::string &log_name,
+                                         const sampling policy = {}, const checkpointing &ck = {},
+                                         const stopping &crit = {}) {
+    const auto n_flock = params.n_flock;
+    const auto n_choice = params.n_choice;
+    const auto n_dim = params.mean.size();
+    const auto is_cma = params.model == eda_model::cma;
+    counter_rng rng(params.seed);
+    const objective fn(params.fn, n_dim);
+    population flock(n_flock, n_dim);
+    gaussian_model model(params, n_choice + (is_cma ? 1 : 0));
+    cma_state cma(n_dim, is_cma ? n_choice : 1);
+    const auto factor_every = params.factor_every ? params.factor_every : is_cma ? cma.factor_gap(n_dim) : 1;
+    {
+        const phase_timer timer(phase::init);
+        model.sample(rng, flock);
+        fn.evaluate(flock);
+    }
+    const auto fit = flock.fit();
+    double best = std::ranges::min(fit);
+    convergence watch(crit);
+    size_t first = 0;
+    if (ck.resume) {
+        auto in = ck.resume->state();
+        in.get(flock);
+        model.restore(in);
+        in.get(std::span(cma.p_sigma));
+        in.get(std::span(cma.p_c));
+        in.get(best);
+        in.get(rng);
+        watch.restore(in);
+        if (!ck.restored(in)) return std::nullopt;
+        first = ck.resume->epoch();
+    }
+    trajectory_writer log(log_name, {trajectory_layout::flat, static_cast<uint32_t>(2 + n_dim), 0, 0}, policy,
+                          ck.resume ? ck.resume->records() : 0);
+    checkpoint_writer saver(ck, log);
+    auto stop = stop_reason::epochs;
+    auto n_epoch = params.n_epoch;
+    std::vector<size_t> order(n_flock);
+    const auto elite = std::span(order).first(n_choice);
+    for (size_t epoch = first; epoch < params.n_epoch; ++epoch) {
+        if (saver.due(epoch)) {
+            snapshot out;
+            out.put(flock);
+            model.save(out);
+            out.put(cma.p_sigma);
+            out.put(cma.p_c);
+            out.put(best);
+            out.put(rng);
+            watch.save(out);
+            saver.save(epoch, std::move(out));
+        }
+        phase_timer timer(phase::select);
+        std::iota(order.begin(), order.end(), 0);
+        const auto by_fit = [&](const size_t i) { return fit[i]; };
+        if (is_cma) {
+            std::ranges::partial_sort(order, order.begin() + static_cast<ptrdiff_t>(n_choice), std::less{}, by_fit);
+            timer.switch_to(phase::update);
+            fit_cma(model, cma, elite, epoch);
+        } else {
+            std::ranges::nth_element(order, order.begin() + static_cast<ptrdiff_t>(n_choice - 1), std::less{}, by_fit);
+            timer.switch_to(phase::update);
+            fit_emna(model, flock, elite);
+        }
+        if ((epoch + 1) % factor_every == 0) model.refactor();
+        timer.switch_to(phase::vary);
+        model.sample(rng, flock);
+        fn.evaluate(flock);
+        timer.switch_to(phase::update);
+        const auto epoch_best = std::ranges::min(fit);
+        best = std::min(best, epoch_best);
+        const auto why = watch.check(best, n_flock * (epoch + 2), [&] { return model.spread(); });
+        timer.switch_to(phase::log);
+        if (const auto rec = log.record(epoch); !rec.empty()) {
+            rec[0] = epoch_best;
+            rec[1] = model.spread();
+            std::ranges::copy(model.mean, rec.begin() + 2);
+        }
+        if (why) {
+            stop = *why;
+            n_epoch = epoch + 1;
+            break;
+        }
+    }
+    return run_summary{best, n_flock * (n_epoch + 1), stop};
+}
+
+std::optional<run_summary> run_eda(const config &cfg) {
+    eda_params p{500, 100, 100, {}, {}, 0};
+    size_t n_dim = 2;
+    double mean = 10.0, std = 2.0;
+    std::string log_name;
+    sampling policy;
+    if (!(cfg.read("model", p.model, eda_model_names) && cfg.read("n_dim", n_dim) && cfg.read("mean", mean) &&
+          cfg.read("std", std) && cfg.read("factor_every", p.factor_every))) {
+        return std::nullopt;
+    }
+    if (n_dim == 0) {
+        std::cerr << "EDA needs n_dim >= 1." << std::endl;
+        return std::nullopt;
+    }
+    // CMA-ES defaults to its usual small flock, 4 + 3 ln n, and half of it selected.
+    if (p.model == eda_model::cma) {
+        p.n_flock = 4 + static_cast<size_t>(3.0 * std::log(static_cast<double>(n_dim)));
+        p.n_choice = p.n_flock / 2;
+    }
+    // "mean" and "std" set every axis; "mean<k>" and "std<k>" then set axis k, from 1.
+    p.mean.assign(n_dim, mean);
+    p.std.assign(n_dim, std);
+    for (size_t k = 0; k < n_dim; ++k) {
+        const auto axis = std::to_string(k + 1);
+        if (!(cfg.read("mean" + axis, p.mean[k]) && cfg.read("std" + axis, p.std[k]))) return std::nullopt;
+    }
+    if (!(cfg.read("n_flock", p.n_flock) && cfg.read("n_choice", p.n_choice) && cfg.read("n_epoch", p.n_epoch) &&
+          cfg.read("seed", p.seed) && cfg.read("log", log_name) && cfg.read("log_every", policy.every))) {
+        return std::nullopt;
+    }
+    if (p.n_choice == 0 || p.n_choice > p.n_flock) {
+        std::cerr << "EDA needs 1 <= n_choice <= n_flock." << std::endl;
+        return std::nullopt;
+    }
+    if (p.model == eda_model::emna && p.n_choice <= n_dim) {
+        std::cerr << "EMNA needs n_choice > n_dim for a full-rank covariance." << std::endl;
+        return std::nullopt;
+    }
+    const auto fn = read_problem(cfg, p.fn);
+    const auto ck = read_checkpointing(cfg);
+    const auto crit = read_stopping(cfg);
+    const auto again = read_restarts(cfg);
+    if (!(fn && ck && crit && again)) return std::nullopt;
+    p.fn = *fn;
+    // Restarts keep the share of the flock that is selected, which for CMA-ES is the usual half.
+    const auto one_run = [&](const size_t n, const uint64_t seed, const stopping &left, const size_t index) {
+        auto q = p;
+        q.n_flock = n;
+        q.n_choice = std::max<size_t>(1, p.n_choice * n / p.n_flock);
+        q.seed = seed;
+        const auto name = restart_log_name(log_name, index);
+        if (q.model == eda_model::axis) return demo_eda(q, name, policy, *ck, left);
+        return demo_gaussian(q, name, policy, *ck, left);
+    };
+    return run_restarts(*again, *crit, p.n_flock, p.seed, one_run);
 }
 
 void main_eda() {
     std::cout << "--> Estimation of Distribution Algorithm" << std::endl;
-    demo_eda<500, 100, 100, 10.0, 2.0, 10.0, 2.0>("eda.log");
-}
\ No newline at end of file
+    demo_eda({500, 100, 100, {10.0, 10.0}, {2.0, 2.0}, 0}, "eda.trj");
+    constexpr size_t n_dim = 30;
+    demo_gaussian({14, 7, 1000, std::vector(n_dim, 10.0), std::vector(n_dim, 2.0), 0, eda_model::cma}, "eda_cma.trj");
+}
@@ -0,0 +1,50 @@
+#ifndef ENGINES_H
+#define ENGINES_H
+
+#include "common.h"
+#include "config.h"
+
+// Why a run ended: it ran its n_epoch epochs, or met one of the criteria of termination.h.
+enum class stop_reason { epochs, budget, target, stall, diversity };
+
+constexpr std::array<std::string_view, 5> stop_reason_names{"epochs", "budget", "target", "stall", "diversity"};
+
+// Outcome of one optimizer run.
+struct run_summary {
+    // Objective value of the best solution found; lower is better for every engine.
+    double best;
+    // Objective evaluations, or tours built for ACO.
+    size_t n_eval;
+    // Why the run, or its last restart, ended.
+    stop_reason stop = stop_reason::epochs;
+    // Runs after the first; see restarts in termination.h.
+    size_t n_restart = 0;
+};
+
+// Runtime entry points. Each reads its settings from cfg, falling back to the defaults of its
+// first demo for those not set, and writes a trajectory to the path in "log", if any, keeping
+// every "log_every"-th epoch. nullopt, with a message, when a setting is invalid.
+std::optional<run_summary> run_de(const config &cfg);
+std::optional<run_summary> run_pso(const config &cfg);
+std::optional<run_summary> run_ga(const config &cfg);
+// The GA's multi-objective mode, NSGA-II, which run_ga runs when "multi" names a problem.
+std::optional<run_summary> run_nsga(const config &cfg);
+std::optional<run_summary> run_eda(const config &cfg);
+std::optional<run_summary> run_aco(const config &cfg);
+std::optional<run_summary> run_grid(const config &cfg);
+
+// Runs the engine named by "algo".
+inline std::optional<run_summary> run_engine(const config &cfg) {
+    std::string algo;
+    cfg.read("algo", algo);
+    if (algo == "de") return run_de(cfg);
+    if (algo == "pso") return run_pso(cfg);
+    if (algo == "ga") return run_ga(cfg);
+    if (algo == "eda") return run_eda(cfg);
+    if (algo == "aco") return run_aco(cfg);
+    if (algo == "grid") return run_grid(cfg);
+    std::cerr << "Unknown algo '" << algo << "'; expected de, pso, ga, eda, aco or grid." << std::endl;
+    return std::nullopt;
+}
+
+#endif //ENGINES_H
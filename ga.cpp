@@ -1,124 +1,423 @@
 #include "common.h"
+#include "bench.h"
+#include "checkpoint.h"
+#include "engines.h"
+#include "objective.h"
+#include "profile.h"
+#include "rng.h"
+#include "selection.h"
+#include "termination.h"
+#include "trajectory.h"
+#include "variation.h"
 
-using Gene = std::array<double, 4>;
+// Maximised: 1 / (1 + f), from the objective value f >= 0 of a chromosome.
+double fitness_of(const double value) {
+    return 1.0 / (value + 1.0);
+}
+
+double squared_norm(const std::span<const double> sol) {
+    return std::transform_reduce(sol.begin(), sol.end(), 0.0, std::plus{}, [](const double v) { return v * v; });
+}
+
+enum class ga_selection { roulette, alias, sus, tournament };
 
-struct Entity {
-    Gene gene;
-    double fit;
+constexpr std::array<std::pair<std::string_view, ga_selection>, 4> ga_selection_names{{
+    {"roulette", ga_selection::roulette}, {"alias", ga_selection::alias}, {"sus", ga_selection::sus},
+    {"tournament", ga_selection::tournament},
+}};
+
+enum class ga_crossover { swap, uniform, blend, sbx };
+
+constexpr std::array<std::pair<std::string_view, ga_crossover>, 4> ga_crossover_names{{
+    {"swap", ga_crossover::swap}, {"uniform", ga_crossover::uniform}, {"blend", ga_crossover::blend},
+    {"sbx", ga_crossover::sbx},
+}};
+
+struct ga_params {
+    size_t n_gene;
+    size_t n_choice;
+    size_t n_epoch;
+    double bound;
+    double p_cross;
+    // Per locus.
+    double p_mutate;
+    uint64_t seed;
+    ga_selection selection = ga_selection::roulette;
+    // Tournament size.
+    size_t k = 2;
+    // Chromosome length.
+    size_t n_loci = 4;
+    // swap exchanges one random locus between the parents.
+    ga_crossover cross = ga_crossover::swap;
+    double blx_alpha = 0.5;
+    double sbx_eta = 15.0;
+    problem fn{landscape::sphere};
 };
 
-std::ostream &operator<<(std::ostream &os, const Entity &entity) {
-    os << entity.gene[0] << " " << entity.gene[1] << " " << entity.gene[2] << " " << entity.gene[3] << " " << entity.fit;
-    return os;
-}
+// Chromosomes one after another in a single buffer, with their objective values and fitness.
+struct ga_rows {
+    size_t n_loci;
+    std::vector<double> genes;
+    std::vector<double> value;
+    std::vector<double> fit;
 
-double evaluate(const Gene & sol) {
-    const auto den = std::pow(sol[0], 2.0) + std::pow(sol[1], 2.0) +
-        std::pow(sol[2], 2.0) + std::pow(sol[3], 2.0) + 1.0;
-    return 1.0 / den;
-}
+    ga_rows(const size_t n, const size_t n_loci) : n_loci(n_loci), genes(n * n_loci), value(n), fit(n) {}
 
-template<size_t n_gene, size_t n_choice, size_t n_epoch, double bound, double p_cross, double p_mutate>
-void demo_ga(const std::string &log_name) {
-    static_assert(bound >= 0.0);
-    std::ofstream log_file;
-    log_file.open(log_name);
+    std::span<double> row(const size_t i) { return {genes.data() + i * n_loci, n_loci}; }
 
-    // initialize the flock
-    std::array<Entity, n_gene> flock {};
-    Entity best { Gene {}, std::numeric_limits<double>::min() };
-    // NOLINTNEXTLINE(*-msc51-cpp) I deliberately want predictable results.
-    std::mt19937 engine;
-    std::uniform_real_distribution d_init(-bound, bound);
-    for (auto & entity: flock) {
-        for (auto & value: entity.gene) {
-            value = d_init(engine);
+    void copy(const size_t i, ga_rows &from, const size_t j) {
+        std::ranges::copy(from.row(j), row(i).begin());
+        value[i] = from.value[j];
+        fit[i] = from.fit[j];
+    }
+
+    // The plain sphere is the squared norm, which mutation can also keep up to date locus by locus.
+    void evaluate(const size_t i, const objective &fn) {
+        value[i] = plain_sphere(fn) ? squared_norm(row(i)) : fn.value(row(i));
+        fit[i] = fitness_of(value[i]);
+    }
+
+    static bool plain_sphere(const objective &fn) { return fn.function() == landscape::sphere && !fn.moved(); }
+};
+
+// Buffers of one generation, kept from one generation to the next.
+struct ga_generation {
+    const objective &fn;
+    ga_rows flock;
+    ga_rows pool;
+    std::vector<uint32_t> picks;
+    std::vector<uint8_t> avail;
+    std::vector<uint32_t> changed;
+    prefix_sum_wheel wheel;
+    alias_table alias;
+
+    // fn must outlive the generation.
+    ga_generation(const size_t n_gene, const size_t n_choice, const size_t n_loci, const objective &fn)
+        : fn(fn), flock(n_gene, n_loci), pool(n_choice, n_loci), picks(n_choice), avail(n_choice) {}
+
+    // Fill the pool from the flock.
+    void select(const ga_params &params, counter_rng &rng) {
+        switch (params.selection) {
+            case ga_selection::roulette:
+                wheel.build(flock.fit);
+                wheel.select(rng, picks);
+                break;
+            case ga_selection::alias:
+                alias.build(flock.fit);
+                alias.select(rng, picks);
+                break;
+            case ga_selection::sus:
+                // Shuffled, as crossover pairs neighbours in the pool.
+                sus_select(flock.fit, rng, picks);
+                for (size_t i = picks.size(); i > 1; --i) {
+                    std::swap(picks[i - 1], picks[rng.below(static_cast<uint32_t>(i))]);
+                }
+                break;
+            case ga_selection::tournament:
+                tournament_select(flock.fit, params.k, rng, picks);
+                break;
         }
-        entity.fit = evaluate(entity.gene);
-        if (entity.fit > best.fit) {
-            best = entity;
+        for (size_t i = 0; i < picks.size(); ++i) pool.copy(i, flock, picks[i]);
+    }
+
+    // Cross flock members i and j in place.
+    void cross(const ga_params &params, const size_t i, const size_t j, counter_rng &rng) {
+        const auto a = flock.row(i), b = flock.row(j);
+        switch (params.cross) {
+            case ga_crossover::swap: {
+                const auto comp = rng.below(static_cast<uint32_t>(flock.n_loci));
+                std::swap(a[comp], b[comp]);
+                break;
+            }
+            case ga_crossover::uniform:
+                cross_uniform(a, b, rng);
+                break;
+            case ga_crossover::blend:
+                cross_blend(a, b, params.blx_alpha, -params.bound, params.bound, rng);
+                break;
+            case ga_crossover::sbx:
+                cross_sbx(a, b, params.sbx_eta, -params.bound, params.bound, rng);
+                break;
         }
+        flock.evaluate(i, fn);
+        flock.evaluate(j, fn);
     }
 
+    // Mutate the whole flock as one run of loci, so that the cost follows the number of resets. On
+    // the plain sphere the squared norm of a member is updated at every reset; any other function
+    // evaluates each member changed once afterwards. The members changed are left in changed, in
+    // order.
+    void mutate(const ga_params &params, counter_rng &rng) {
+        const auto n_loci = flock.n_loci;
+        const auto running = ga_rows::plain_sphere(fn);
+        changed.clear();
+        mutate_reset(flock.genes, params.p_mutate, -params.bound, params.bound, rng,
+                     [&](const size_t locus, const double old) {
+                         const auto i = static_cast<uint32_t>(locus / n_loci);
+                         const auto v = flock.genes[locus];
+                         if (running) flock.value[i] += v * v - old * old;
+                         if (changed.empty() || changed.back() != i) changed.push_back(i);
+                     });
+        for (const auto i: changed) {
+            if (running) flock.fit[i] = fitness_of(flock.value[i]);
+            else flock.evaluate(i, fn);
+        }
+    }
+};
+
+// Maximises the fitness 1 / (1 + f), i.e. minimises the objective f, which is what it reports. The
+// GA evaluates chromosomes one at a time as they change, through objective::value.
+std::optional<run_summary> demo_ga(const ga_params &params, const std::string &log_name, const sampling policy = {},
+                                   const checkpointing &ck = {}, const stopping &crit = {}) {
+    const auto n_gene = params.n_gene;
+    const auto n_choice = params.n_choice;
+    const auto n_loci = params.n_loci;
+
+    // initialize the flock
+    const objective fn(params.fn, n_loci);
+    ga_generation gen(n_gene, n_choice, n_loci, fn);
+    auto &flock = gen.flock;
+    auto &pool = gen.pool;
+    auto &avail = gen.avail;
+    std::vector<double> best_genes(n_loci);
+    double best_fit = std::numeric_limits<double>::min();
+    const auto track_best = [&](const size_t i) {
+        if (flock.fit[i] <= best_fit) return;
+        best_fit = flock.fit[i];
+        std::ranges::copy(flock.row(i), best_genes.begin());
+    };
+    size_t n_eval = n_gene;
+    counter_rng rng(params.seed);
+    {
+        const phase_timer timer(phase::init);
+        rng.fill_uniform(flock.genes, -params.bound, params.bound);
+        for (size_t i = 0; i < n_gene; ++i) {
+            flock.evaluate(i, fn);
+            track_best(i);
+        }
+        profile_count(profile_counter::evaluations, n_gene);
+    }
+    convergence watch(crit);
+    size_t first = 0;
+    if (ck.resume) {
+        auto in = ck.resume->state();
+        in.get(std::span(flock.genes));
+        in.get(std::span(flock.value));
+        in.get(std::span(flock.fit));
+        in.get(std::span(best_genes));
+        in.get(best_fit);
+        in.get(n_eval);
+        in.get(rng);
+        watch.restore(in);
+        if (!ck.restored(in)) return std::nullopt;
+        first = ck.resume->epoch();
+    }
+    const auto width = static_cast<uint32_t>(n_loci + 1);
+    trajectory_writer log(log_name, {trajectory_layout::population, width, static_cast<uint32_t>(n_gene), width},
+                          policy, ck.resume ? ck.resume->records() : 0);
+    checkpoint_writer saver(ck, log);
+    const auto spread = [&] {
+        spread_sum sum(n_loci);
+        sum.add_rows(flock.genes);
+        return sum.value();
+    };
+    auto stop = stop_reason::epochs;
+
     // evolution loop
-    std::bernoulli_distribution d_cross(p_cross);
-    for (size_t epoch = 0; epoch < n_epoch; ++epoch) {
-        // compute the sum of flock's fitness values
-        double sum = 0.0;
-        for (auto & entity: flock) {
-            sum += entity.fit;
+    for (size_t epoch = first; epoch < params.n_epoch; ++epoch) {
+        if (saver.due(epoch)) {
+            snapshot out;
+            out.put(flock.genes);
+            out.put(flock.value);
+            out.put(flock.fit);
+            out.put(best_genes);
+            out.put(best_fit);
+            out.put(n_eval);
+            out.put(rng);
+            watch.save(out);
+            saver.save(epoch, std::move(out));
         }
 
         // selection
-        std::array<Entity, n_choice> pool {};
-        std::uniform_real_distribution d_selected(0.0, sum);
-        for (size_t i = 0; i < n_choice; ++i) {
-            double r = d_selected(engine);
-            for (auto & entity: flock) {
-                r -= entity.fit;
-                if (r <= 0.0) {
-                    pool[i] = entity;
-                    break;
-                }
-            }
-        }
+        phase_timer timer(phase::select);
+        const auto n_eval_before = n_eval;
+        gen.select(params, rng);
+
+        // Chromosomes are evaluated as they change, a few loci at a time, which is too fine to
+        // time on its own: their evaluation counts towards vary.
+        timer.switch_to(phase::vary);
 
         // crossover
         // decide availability
-        std::bitset<n_choice> avail;
         for (size_t i = 0; i < n_choice; ++i) {
-            avail[i] = d_cross(engine);
+            avail[i] = rng.uniform() < params.p_cross;
         }
 
         // actual operation
-        std::uniform_int_distribution d_comp(0, 3);
         for (size_t i = 0; i < n_choice; ++i) {
             if (!avail[i]) {
                 // not available and stay same
-                flock[i] = pool[i];
+                flock.copy(i, pool, i);
                 continue;
             }
             size_t target = i + 1;
-            while (!avail[target] && target < n_choice) {
+            while (target < n_choice && !avail[target]) {
                 // copy over those not available
-                flock[i] = pool[i];
+                flock.copy(i, pool, i);
                 ++target;
             }
             if (target >= n_choice) {
                 // choices exhausted
-                flock[i] = pool[i];
+                flock.copy(i, pool, i);
                 break;
             }
-            // copy, swap and re-evaluate
-            flock[i] = pool[i];
-            flock[target] = pool[target];
-            size_t comp = d_comp(engine);
-            std::swap(flock[i].gene[comp], flock[target].gene[comp]);
-            flock[i].fit = evaluate(flock[i].gene);
-            flock[target].fit = evaluate(flock[target].gene);
-            if (flock[i].fit > best.fit) {
-                best = flock[i];
-            }
+            // copy, cross and re-evaluate
+            flock.copy(i, pool, i);
+            flock.copy(target, pool, target);
+            gen.cross(params, i, target, rng);
+            n_eval += 2;
+            track_best(i);
+            track_best(target);
             i = target;
         }
 
         // mutate
-        std::bernoulli_distribution d_mutate(p_mutate);
-        for (auto & entity: flock) {
-            for (auto & value: entity.gene) {
-                if (!d_mutate(engine)) continue;
-                value = d_init(engine);
+        gen.mutate(params, rng);
+        n_eval += gen.changed.size();
+        for (const auto i: gen.changed) track_best(i);
+        profile_count(profile_counter::evaluations, n_eval - n_eval_before);
+        const auto why = watch.check(1.0 / best_fit - 1.0, n_eval, spread);
+
+        timer.switch_to(phase::log);
+        if (const auto rec = log.record(epoch); !rec.empty()) {
+            std::ranges::copy(best_genes, rec.begin());
+            rec[width - 1] = best_fit;
+            for (size_t i = 0; i < n_gene; ++i) {
+                for (size_t j = 0; j < n_loci; ++j) rec[width + j * n_gene + i] = flock.genes[i * n_loci + j];
+                rec[width + n_loci * n_gene + i] = flock.fit[i];
             }
         }
+        if (why) {
+            stop = *why;
+            break;
+        }
+    }
+    return run_summary{1.0 / best_fit - 1.0, n_eval, stop};
+}
 
-        log_file << best;
-        for (auto & entity: flock) log_file << " " << entity;
-        log_file << std::endl;
+std::optional<run_summary> run_ga(const config &cfg) {
+    if (cfg.all().contains("multi")) return run_nsga(cfg);
+    ga_params p{5, 5, 100, 5.0, 0.88, 0.1, 0};
+    std::string log_name;
+    sampling policy;
+    if (!(cfg.read("n_gene", p.n_gene) && cfg.read("n_choice", p.n_choice) && cfg.read("n_epoch", p.n_epoch) &&
+          cfg.read("bound", p.bound) && cfg.read("p_cross", p.p_cross) && cfg.read("p_mutate", p.p_mutate) &&
+          cfg.read("seed", p.seed) && cfg.read("selection", p.selection, ga_selection_names) &&
+          cfg.read("tournament", p.k) && cfg.read("n_loci", p.n_loci) &&
+          cfg.read("crossover", p.cross, ga_crossover_names) && cfg.read("blx_alpha", p.blx_alpha) &&
+          cfg.read("sbx_eta", p.sbx_eta) && cfg.read("log", log_name) && cfg.read("log_every", policy.every))) {
+        return std::nullopt;
     }
-    log_file.close();
+    if (p.n_gene == 0 || p.n_choice == 0 || p.n_choice > p.n_gene || p.bound < 0.0 || p.k == 0 ||
+        p.n_gene > std::numeric_limits<uint32_t>::max() || p.n_loci == 0 || p.blx_alpha < 0.0 || p.sbx_eta < 0.0) {
+        std::cerr << "GA needs 1 <= n_choice <= n_gene < 2^32, bound >= 0, tournament >= 1, n_loci >= 1, "
+            "blx_alpha >= 0 and sbx_eta >= 0." << std::endl;
+        return std::nullopt;
+    }
+    const auto fn = read_problem(cfg, p.fn);
+    const auto ck = read_checkpointing(cfg);
+    const auto crit = read_stopping(cfg);
+    const auto again = read_restarts(cfg);
+    if (!(fn && ck && crit && again)) return std::nullopt;
+    p.fn = *fn;
+    // Restarts keep the share of the flock that is selected.
+    const auto one_run = [&](const size_t n, const uint64_t seed, const stopping &left, const size_t index) {
+        auto q = p;
+        q.n_gene = std::min<size_t>(n, std::numeric_limits<uint32_t>::max());
+        q.n_choice = std::max<size_t>(1, p.n_choice * q.n_gene / p.n_gene);
+        q.seed = seed;
+        return demo_ga(q, restart_log_name(log_name, index), policy, *ck, left);
+    };
+    return run_restarts(*again, *crit, p.n_gene, p.seed, one_run);
 }
 
 void main_ga() {
     std::cout << "--> Genetic Algorithm" << std::endl;
-    demo_ga<5, 5, 100, 5.0, 0.88, 0.1>("ga.log");
-}
\ No newline at end of file
+    demo_ga({5, 5, 100, 5.0, 0.88, 0.1, 0}, "ga.trj");
+}
+
+// Selection throughput: time to fill a pool as large as the population, table build included, over
+// populations of 10^2 to 10^7. The linear scan of the wheel, which the roulette first was, is only
+// run while it takes seconds at most.
+void bench_ga(bench_report &report) {
+    counter_rng rng(3);
+    for (size_t n = 100; n <= 10'000'000; n *= 10) {
+        std::vector<double> fit(n);
+        rng.fill_uniform(fit);
+        std::vector<uint32_t> picks(n);
+        prefix_sum_wheel wheel;
+        alias_table alias;
+        const auto time = [&](const std::string_view name, const auto &fill) {
+            const auto per_gen = seconds_per_call(fill);
+            report.add({"ga", "select_" + std::string(name), {{"individuals", n}},
+                        {{"seconds_per_generation", per_gen}, {"ns_per_pick", per_gen * 1e9 / static_cast<double>(n)}}});
+        };
+        if (n <= 10'000) {
+            time("linear", [&] {
+                const auto sum = std::accumulate(fit.begin(), fit.end(), 0.0);
+                for (auto &p: picks) {
+                    auto r = sum * rng.uniform();
+                    size_t i = 0;
+                    while (i + 1 < n && (r -= fit[i]) > 0.0) ++i;
+                    p = static_cast<uint32_t>(i);
+                }
+            });
+        }
+        time("prefix_sum", [&] {
+            wheel.build(fit);
+            wheel.select(rng, picks);
+        });
+        time("alias", [&] {
+            alias.build(fit);
+            alias.select(rng, picks);
+        });
+        time("sus", [&] { sus_select(fit, rng, picks); });
+        time("tournament_2", [&] { tournament_select(fit, 2, rng, picks); });
+        time("tournament_8", [&] { tournament_select(fit, 8, rng, picks); });
+        // Keeps the picks observable.
+        if (picks[0] >= n) std::cout << "bad pick" << std::endl;
+    }
+
+    // Variation cost per chromosome of 10^3 to 10^6 loci: mutation at 10^-3 per locus by geometric
+    // skips and by a draw per locus, polynomial mutation, and the crossovers.
+    for (size_t n_loci = 1000; n_loci <= 1'000'000; n_loci *= 10) {
+        std::vector<double> a(n_loci), b(n_loci);
+        rng.fill_uniform(a, -5.0, 5.0);
+        rng.fill_uniform(b, -5.0, 5.0);
+        double sink = 0.0;
+        const auto time = [&](const std::string_view name, const auto &op) {
+            const auto per_op = seconds_per_call(op);
+            report.add({"ga", std::string(name), {{"loci", n_loci}},
+                        {{"ns_per_chromosome", per_op * 1e9},
+                         {"ns_per_locus", per_op * 1e9 / static_cast<double>(n_loci)}}});
+        };
+        time("mutate_skip", [&] {
+            mutate_reset(a, 1e-3, -5.0, 5.0, rng, [&](const size_t, const double old) { sink += old; });
+        });
+        time("mutate_each", [&] {
+            for (auto &v: a) {
+                if (rng.uniform() < 1e-3) {
+                    sink += v;
+                    v = -5.0 + 10.0 * rng.uniform();
+                }
+            }
+        });
+        time("mutate_polynomial", [&] {
+            mutate_polynomial(a, 1e-3, 20.0, -5.0, 5.0, rng, [&](const size_t, const double old) { sink += old; });
+        });
+        time("cross_uniform", [&] { cross_uniform(a, b, rng); });
+        time("cross_blend", [&] { cross_blend(a, b, 0.5, -5.0, 5.0, rng); });
+        time("cross_sbx", [&] { cross_sbx(a, b, 15.0, -5.0, 5.0, rng); });
+        if (std::isnan(sink + a[0] + b[0])) std::cout << "bad variation" << std::endl;
+    }
+}
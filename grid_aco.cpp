@@ -0,0 +1,513 @@
+#include "common.h"
+#include "bench.h"
+#include "checkpoint.h"
+#include "engines.h"
+#include "heightmap.h"
+#include "profile.h"
+#include "rng.h"
+#include "termination.h"
+#include "trajectory.h"
+#include "worker_pool.h"
+
+#include <filesystem>
+#include <unordered_map>
+
+struct GridCell {
+    uint32_t x;
+    uint32_t y;
+
+    bool operator==(const GridCell &) const = default;
+};
+
+using GridPath = std::vector<GridCell>;
+
+struct GridParams {
+    // Ants.
+    size_t m;
+    double alpha;
+    double beta;
+    double rho;
+    size_t n_epoch;
+    uint64_t seed;
+    GridCell start;
+    GridCell goal;
+    // Cell sides per height unit: a move costs sqrt(run^2 + (height_scale * rise)^2).
+    double height_scale = 1.0;
+    // Moves an ant may make before it gives up; 0 for 8 times the octile distance to the goal.
+    size_t max_steps = 0;
+    // Workers walking ants; 0 for one per hardware thread.
+    size_t n_thread = 0;
+};
+
+// The 8 moves, anticlockwise from east; odd ones are diagonal.
+constexpr std::array<std::array<int32_t, 2>, 8> grid_moves{{
+    {1, 0}, {1, 1}, {0, 1}, {-1, 1}, {-1, 0}, {-1, -1}, {0, -1}, {1, -1}
+}};
+
+// Length of the shortest 8-neighbour path between two cells on flat open ground.
+inline double octile(const GridCell a, const GridCell b) {
+    const auto dx = static_cast<double>(a.x > b.x ? a.x - b.x : b.x - a.x);
+    const auto dy = static_cast<double>(a.y > b.y ? a.y - b.y : b.y - a.y);
+    return std::max(dx, dy) + (std::numbers::sqrt2 - 1.0) * std::min(dx, dy);
+}
+
+// Cost of each of the 8 moves out of every cell of a tile; infinite off the map and into or out
+// of a wall. 32 KiB, so the tile an ant is crossing stays in L1 or L2.
+struct CostTile {
+    std::array<std::array<float, 8>, tile_cells> move;
+};
+
+// Cost tiles made the first time an ant enters the tile, so that a walk over a large map only
+// pays for the region it explores. Workers may race to make the same tile: each builds its own,
+// one wins the compare-exchange, and the others drop theirs.
+class CostTiles {
+public:
+    CostTiles(const Heightmap &map, const double height_scale)
+        : map(map), height_scale(height_scale), tiles(map.n_tiles()) {}
+
+    CostTiles(const CostTiles &) = delete;
+    CostTiles &operator=(const CostTiles &) = delete;
+
+    ~CostTiles() {
+        for (auto &t: tiles) delete t.load(std::memory_order_relaxed);
+    }
+
+    const CostTile &of(const size_t tile) {
+        auto cur = tiles[tile].load(std::memory_order_acquire);
+        if (cur) return *cur;
+        auto fresh = std::make_unique<CostTile>();
+        fill(tile, *fresh);
+        if (tiles[tile].compare_exchange_strong(cur, fresh.get(), std::memory_order_acq_rel)) return *fresh.release();
+        return *cur;
+    }
+
+    [[nodiscard]] size_t computed() const {
+        return static_cast<size_t>(std::ranges::count_if(tiles, [](const auto &t) {
+            return t.load(std::memory_order_relaxed) != nullptr;
+        }));
+    }
+
+private:
+    void fill(const size_t tile, CostTile &out) const {
+        const auto x0 = static_cast<uint32_t>(tile % map.tiles_x()) * tile_edge;
+        const auto y0 = static_cast<uint32_t>(tile / map.tiles_x()) * tile_edge;
+        constexpr auto inf = std::numeric_limits<float>::infinity();
+        for (uint32_t c = 0; c < tile_cells; ++c) {
+            const auto x = x0 + c % tile_edge, y = y0 + c / tile_edge;
+            auto &move = out.move[c];
+            move.fill(inf);
+            if (x >= map.width() || y >= map.height()) continue;
+            const auto here = map.at(x, y);
+            if (here == wall_height) continue;
+            for (size_t d = 0; d < grid_moves.size(); ++d) {
+                const auto nx = x + grid_moves[d][0], ny = y + grid_moves[d][1];
+                if (nx >= map.width() || ny >= map.height()) continue;
+                const auto there = map.at(nx, ny);
+                if (there == wall_height) continue;
+                const auto run2 = d % 2 ? 2.0 : 1.0;
+                const auto rise = height_scale * (static_cast<double>(there) - here);
+                move[d] = static_cast<float>(std::sqrt(run2 + rise * rise));
+            }
+        }
+    }
+
+    const Heightmap &map;
+    double height_scale;
+    std::vector<std::atomic<CostTile *>> tiles;
+};
+
+// MAX-MIN pheromone on cells, tiled like the heightmap. Values are stored relative to a global
+// scale as in the lazy MaxMinPhMat of the TSP colony, so evaporation costs nothing per cell, and
+// a tile is only allocated when a deposit first lands in it; until then all its cells hold the
+// initial value.
+struct TiledPheromone {
+    using Tile = std::array<float, tile_cells>;
+
+    std::vector<std::unique_ptr<Tile>> tiles;
+    float untouched = 0.0f;
+    double scale = 1.0;
+    float tau_min = 0.0f;
+    float tau_max = 0.0f;
+
+    [[nodiscard]] float tau(const size_t cell) const {
+        const auto &t = tiles[cell / tile_cells];
+        const auto stored = t ? (*t)[cell % tile_cells] : untouched;
+        return std::max(tau_min, static_cast<float>(scale * stored));
+    }
+
+    void vapourise(const double rho) {
+        scale *= 1.0 - rho;
+        if (scale < 1e-30) {
+            for (const auto &t: tiles) {
+                if (!t) continue;
+                for (auto &val: *t) val = static_cast<float>(val * scale);
+            }
+            untouched = static_cast<float>(untouched * scale);
+            scale = 1.0;
+        }
+    }
+
+    void deposit(const size_t cell, const float amount) {
+        const auto val = std::min(tau_max, tau(cell) + amount);
+        auto &t = tiles[cell / tile_cells];
+        if (!t) {
+            t = std::make_unique<Tile>();
+            t->fill(untouched);
+        }
+        (*t)[cell % tile_cells] = static_cast<float>(val / scale);
+    }
+
+    // As MaxMinPhMat::set_limits, with the cells of the best path in place of the cities.
+    void set_limits(const double rho, const size_t n, const double best_cost) {
+        const auto p_dec = std::pow(0.05, 1.0 / static_cast<double>(n));
+        const auto avg = std::max(static_cast<double>(n) / 2.0 - 1.0, 1.0);
+        const auto max = 1.0 / (rho * best_cost);
+        tau_max = static_cast<float>(max);
+        tau_min = static_cast<float>(std::min(max, max * (1.0 - p_dec) / (avg * p_dec)));
+    }
+
+    // Every tile as a flag for whether it is allocated, followed by its cells if it is.
+    void save(snapshot &out) const {
+        out.put(tiles.size());
+        for (const auto &t: tiles) {
+            out.put(static_cast<uint8_t>(t != nullptr));
+            if (t) out.put(*t);
+        }
+        out.put(untouched);
+        out.put(scale);
+        out.put(tau_min);
+        out.put(tau_max);
+    }
+
+    void restore(snapshot_reader &in) {
+        size_t n = 0;
+        in.get(n);
+        if (n != tiles.size()) {
+            in.fail();
+            return;
+        }
+        for (size_t i = 0; i < n; ++i) {
+            uint8_t present = 0;
+            in.get(present);
+            if (!present) {
+                tiles[i].reset();
+                continue;
+            }
+            if (!tiles[i]) tiles[i] = std::make_unique<Tile>();
+            in.get(*tiles[i]);
+        }
+        in.get(untouched);
+        in.get(scale);
+        in.get(tau_min);
+        in.get(tau_max);
+    }
+
+    [[nodiscard]] size_t allocated() const {
+        return static_cast<size_t>(std::ranges::count_if(tiles, [](const auto &t) { return t != nullptr; }));
+    }
+};
+
+// Ant colony path planning from start to goal over a heightmap, under the MAX-MIN rule with
+// pheromone on cells. Each step weighs the open neighbours by tau^alpha * (progress + 1)^-beta,
+// where progress is the cost of the move plus the change in octile distance to the goal: 0 for a
+// move straight towards it on flat ground. An ant does not step straight back unless it has to,
+// and when it reaches a cell already on its path, the loop is cut out. The iteration-best path
+// deposits.
+//
+// As in the TSP colony, ants are split into contiguous blocks over the workers and each draws from
+// its own stream split by (seed, epoch, ant), so a run gives the same result for any number of
+// workers.
+class GridColony {
+public:
+    GridPath best;
+    double best_cost = std::numeric_limits<double>::infinity();
+    std::vector<GridPath> colony;
+    std::vector<double> cost;
+    size_t reached = 0;
+
+    GridColony(const Heightmap &map, const GridParams &params, worker_pool *pool = nullptr)
+        : colony(params.m), cost(params.m), map(map), costs(map, params.height_scale), params(params),
+          exp{static_cast<float>(params.alpha), static_cast<float>(params.beta)}, pool(pool),
+          scratch(pool ? pool->size() : 1) {
+        const auto distance = std::max(octile(params.start, params.goal), 1.0);
+        max_steps = params.max_steps ? params.max_steps : static_cast<size_t>(8.0 * distance) + tile_edge;
+        // Until an ant gets through, the limits assume a path as short as the octile distance.
+        phm.tiles.resize(map.n_tiles());
+        phm.set_limits(params.rho, static_cast<size_t>(distance) + 1, distance);
+        phm.untouched = phm.tau_max;
+    }
+
+    void step() {
+        // A path is costed as it is walked, so its evaluation counts towards construct.
+        const auto build = [&](const size_t w) {
+            const phase_timer timer(phase::construct);
+            auto &s = scratch[w];
+            const auto m = colony.size();
+            const auto lo = m * w / scratch.size(), hi = m * (w + 1) / scratch.size();
+            profile_count(profile_counter::tours, hi - lo);
+            profile_count(profile_counter::evaluations, hi - lo);
+            for (size_t k = lo; k < hi; ++k) {
+                auto rng = counter_rng(params.seed).split(epoch).split(k);
+                if (!walk(rng, s, colony[k])) cost[k] = std::numeric_limits<double>::infinity();
+                else cost[k] = s.prefix.back();
+            }
+        };
+        if (pool) pool->run(build);
+        else build(0);
+        phase_timer timer(phase::update);
+        const auto iteration_best = static_cast<size_t>(std::ranges::min_element(cost) - cost.begin());
+        reached = static_cast<size_t>(std::ranges::count_if(cost, [](const double c) { return std::isfinite(c); }));
+        if (cost[iteration_best] < best_cost) {
+            best = colony[iteration_best];
+            best_cost = cost[iteration_best];
+            phm.set_limits(params.rho, best.size(), best_cost);
+        }
+        timer.switch_to(phase::evaporate);
+        phm.vapourise(params.rho);
+        timer.switch_to(phase::deposit);
+        if (reached) {
+            const auto amount = static_cast<float>(1.0 / cost[iteration_best]);
+            for (const auto c: colony[iteration_best]) phm.deposit(map.index(c.x, c.y), amount);
+        }
+        ++epoch;
+    }
+
+    [[nodiscard]] size_t steps() const {
+        return std::transform_reduce(scratch.begin(), scratch.end(), size_t{0}, std::plus{},
+                                     [](const Scratch &s) { return s.steps; });
+    }
+
+    // The pheromone, the best path and the epoch count. Cost tiles are computed again as walks
+    // reach them.
+    void save(snapshot &out) const {
+        phm.save(out);
+        out.put(best);
+        out.put(best_cost);
+        out.put(epoch);
+    }
+
+    void restore(snapshot_reader &in) {
+        phm.restore(in);
+        in.get(best);
+        in.get(best_cost);
+        in.get(epoch);
+    }
+
+    [[nodiscard]] size_t cost_tiles() const { return costs.computed(); }
+    [[nodiscard]] size_t pheromone_tiles() const { return phm.allocated(); }
+
+private:
+    struct Scratch {
+        // Cost of the path up to each of its cells.
+        std::vector<double> prefix;
+        // Position on the path of every cell on it, by x + y * 2^32.
+        std::unordered_map<uint64_t, size_t> pos;
+        size_t steps = 0;
+    };
+
+    struct Exponents {
+        float alpha;
+        float beta;
+
+        [[nodiscard]] float weight(const float ph, const float progress) const {
+            if (alpha == 1.0f && beta == 2.0f) return ph / (progress * progress);
+            return std::pow(ph, alpha) * std::pow(progress, -beta);
+        }
+    };
+
+    static uint64_t key(const GridCell c) { return c.x | static_cast<uint64_t>(c.y) << 32; }
+
+    bool walk(counter_rng &rng, Scratch &s, GridPath &path) {
+        const auto goal = params.goal;
+        auto cur = params.start;
+        GridCell prev{std::numeric_limits<uint32_t>::max(), std::numeric_limits<uint32_t>::max()};
+        path.assign(1, cur);
+        s.prefix.assign(1, 0.0);
+        s.pos.clear();
+        s.pos.emplace(key(cur), 0);
+        std::array<float, 8> weight{};
+        for (size_t n = 0; n < max_steps && cur != goal; ++n) {
+            const auto here = map.index(cur.x, cur.y);
+            const auto &move = costs.of(here / tile_cells).move[here % tile_cells];
+            const auto to_goal = octile(cur, goal);
+            float sum = 0.0f;
+            size_t back = grid_moves.size();
+            for (size_t d = 0; d < grid_moves.size(); ++d) {
+                weight[d] = 0.0f;
+                if (!std::isfinite(move[d])) continue;
+                const GridCell next{cur.x + grid_moves[d][0], cur.y + grid_moves[d][1]};
+                if (next == prev) {
+                    back = d;
+                    continue;
+                }
+                const auto progress = static_cast<float>(move[d] + octile(next, goal) - to_goal) + 1.0f;
+                weight[d] = exp.weight(phm.tau(map.index(next.x, next.y)), progress);
+                sum += weight[d];
+            }
+            auto pick = back;
+            if (sum > 0.0f) {
+                auto value = static_cast<float>(rng.uniform()) * sum;
+                for (size_t d = 0; d < grid_moves.size(); ++d) {
+                    if (weight[d] == 0.0f) continue;
+                    pick = d;
+                    if (value < weight[d]) break;
+                    value -= weight[d];
+                }
+            }
+            if (pick == grid_moves.size()) return false;
+            const GridCell next{cur.x + grid_moves[pick][0], cur.y + grid_moves[pick][1]};
+            if (const auto it = s.pos.find(key(next)); it != s.pos.end()) {
+                const auto keep = it->second + 1;
+                for (size_t i = keep; i < path.size(); ++i) s.pos.erase(key(path[i]));
+                path.resize(keep);
+                s.prefix.resize(keep);
+            } else {
+                s.pos.emplace(key(next), path.size());
+                path.push_back(next);
+                s.prefix.push_back(s.prefix.back() + move[pick]);
+            }
+            prev = cur;
+            cur = next;
+            ++s.steps;
+        }
+        return cur == goal;
+    }
+
+    const Heightmap &map;
+    CostTiles costs;
+    TiledPheromone phm;
+    GridParams params;
+    Exponents exp;
+    size_t max_steps = 0;
+    uint64_t epoch = 0;
+    worker_pool *pool;
+    std::vector<Scratch> scratch;
+};
+
+// Records hold the best path cost so far, the best of the epoch and the share of ants that reached
+// the goal; costs are infinite until an ant gets through.
+std::optional<run_summary> grid_run(const Heightmap &map, const GridParams &params, const std::string &log_name,
+                                    const sampling policy = {}, const checkpointing &ck = {},
+                                    const stopping &crit = {}) {
+    worker_pool pool(params.n_thread ? params.n_thread : std::thread::hardware_concurrency());
+    GridColony aco(map, params, &pool);
+    convergence watch(crit);
+    size_t first = 0;
+    if (ck.resume) {
+        auto in = ck.resume->state();
+        aco.restore(in);
+        watch.restore(in);
+        if (!ck.restored(in)) return std::nullopt;
+        first = ck.resume->epoch();
+    }
+    trajectory_writer log(log_name, {trajectory_layout::flat, 3, 0, 0}, policy, ck.resume ? ck.resume->records() : 0);
+    checkpoint_writer saver(ck, log);
+    auto stop = stop_reason::epochs;
+    auto n_epoch = params.n_epoch;
+    for (size_t epoch = first; epoch < params.n_epoch; ++epoch) {
+        if (saver.due(epoch)) {
+            snapshot out;
+            aco.save(out);
+            watch.save(out);
+            saver.save(epoch, std::move(out));
+        }
+        aco.step();
+        const auto why = watch.check(aco.best_cost, params.m * (epoch + 1), [&] { return variation_of(aco.cost); });
+        const phase_timer timer(phase::log);
+        if (const auto rec = log.record(epoch); !rec.empty()) {
+            rec[0] = aco.best_cost;
+            rec[1] = std::ranges::min(aco.cost);
+            rec[2] = static_cast<double>(aco.reached) / static_cast<double>(params.m);
+        }
+        if (why) {
+            stop = *why;
+            n_epoch = epoch + 1;
+            break;
+        }
+    }
+    return run_summary{aco.best_cost, params.m * n_epoch, stop};
+}
+
+// The map is the heightmap file in "map", or else random terrain of "map_size" cells a side. The
+// path runs from (start_x, start_y) to (goal_x, goal_y), by default between opposite corners.
+std::optional<run_summary> run_grid(const config &cfg) {
+    GridParams p{10, 1.0, 2.0, 0.02, 100, 0, {0, 0}, {0, 0}};
+    std::string map_path, log_name;
+    uint32_t map_size = 256;
+    uint64_t map_seed = 0;
+    sampling policy;
+    if (!(cfg.read("map", map_path) && cfg.read("map_size", map_size) && cfg.read("map_seed", map_seed))) {
+        return std::nullopt;
+    }
+    if (map_path.empty() && (map_size == 0 || map_size > heightmap_max_side)) {
+        std::cerr << "Grid ACO needs map_size between 1 and " << heightmap_max_side << "." << std::endl;
+        return std::nullopt;
+    }
+    const auto map = map_path.empty() ? std::optional(random_heightmap(map_size, map_size, map_seed))
+                                      : Heightmap::open(map_path);
+    if (!map) return std::nullopt;
+    p.goal = {map->width() - 1, map->height() - 1};
+    if (!(cfg.read("ants", p.m) && cfg.read("alpha", p.alpha) && cfg.read("beta", p.beta) &&
+          cfg.read("rho", p.rho) && cfg.read("n_epoch", p.n_epoch) && cfg.read("seed", p.seed) &&
+          cfg.read("start_x", p.start.x) && cfg.read("start_y", p.start.y) && cfg.read("goal_x", p.goal.x) &&
+          cfg.read("goal_y", p.goal.y) && cfg.read("height_scale", p.height_scale) &&
+          cfg.read("max_steps", p.max_steps) && cfg.read("threads", p.n_thread) && cfg.read("log", log_name) &&
+          cfg.read("log_every", policy.every))) {
+        return std::nullopt;
+    }
+    const auto open = [&](const GridCell c) {
+        return c.x < map->width() && c.y < map->height() && map->at(c.x, c.y) != wall_height;
+    };
+    if (p.m == 0 || p.rho <= 0.0 || p.rho >= 1.0 || p.height_scale < 0.0 || !open(p.start) || !open(p.goal)) {
+        std::cerr << "Grid ACO needs ants >= 1, rho in (0, 1), height_scale >= 0, and start and goal on open cells "
+            "of the map." << std::endl;
+        return std::nullopt;
+    }
+    const auto ck = read_checkpointing(cfg);
+    const auto crit = read_stopping(cfg);
+    const auto again = read_restarts(cfg);
+    if (!(ck && crit && again)) return std::nullopt;
+    const auto one_run = [&](const size_t n, const uint64_t seed, const stopping &left, const size_t index) {
+        auto q = p;
+        q.m = n;
+        q.seed = seed;
+        return grid_run(*map, q, restart_log_name(log_name, index), policy, *ck, left);
+    };
+    return run_restarts(*again, *crit, p.m, p.seed, one_run);
+}
+
+void main_grid() {
+    std::cout << "--> Ant Colony path planning" << std::endl;
+    const auto map = random_heightmap(256, 256, 0);
+    grid_run(map, {10, 1.0, 2.0, 0.02, 100, 0, {0, 0}, {255, 255}}, "grid.trj");
+}
+
+// An 8192 x 8192 map written out and mapped back, then a colony working a 512-cell stretch of it:
+// the time to open the map, the time per epoch and per ant step, and how many tiles the walks
+// touched. A map that cannot be written or mapped is a failure.
+void bench_grid(bench_report &report) {
+    constexpr uint32_t side = 8192;
+    constexpr size_t n_epoch = 20;
+    const GridParams params{10, 1.0, 2.0, 0.02, n_epoch, 7, {4000, 4000}, {4512, 4256}};
+    const auto failed = [&] {
+        report.add_failure({"grid", "aco_grid", {{"side", side}, {"ants", params.m}, {"epochs", n_epoch}}, {}});
+    };
+    std::error_code ec;
+    const auto path = (std::filesystem::temp_directory_path(ec) / "gene01_bench.ghm").string();
+    if (ec || !random_heightmap(side, side, 1).save(path)) return failed();
+    const auto begin = std::chrono::steady_clock::now();
+    const auto map = Heightmap::open(path);
+    const std::chrono::duration<double> open_elapsed = std::chrono::steady_clock::now() - begin;
+    if (!map) return failed();
+    worker_pool pool(std::thread::hardware_concurrency());
+    GridColony aco(*map, params, &pool);
+    const auto run_begin = std::chrono::steady_clock::now();
+    for (size_t epoch = 0; epoch < n_epoch; ++epoch) aco.step();
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - run_begin;
+    report.add({"grid", "aco_grid", {{"side", side}, {"ants", params.m}, {"epochs", n_epoch}},
+                {{"open_ms", open_elapsed.count() * 1e3}, {"s_per_epoch", elapsed.count() / n_epoch},
+                 {"ns_per_step", elapsed.count() * 1e9 / static_cast<double>(aco.steps())},
+                 {"cost_tiles", aco.cost_tiles()}, {"pheromone_tiles", aco.pheromone_tiles()},
+                 {"tiles", map->n_tiles()}, {"best", aco.best_cost}}});
+    std::filesystem::remove(path);
+}
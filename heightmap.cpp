@@ -0,0 +1,132 @@
+#include "heightmap.h"
+#include "profile.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// The file stores little-endian heights that are used in place.
+static_assert(std::endian::native == std::endian::little);
+
+void Heightmap::Unmap::operator()(void *p) const {
+    munmap(p, size);
+}
+
+Heightmap::Heightmap(const uint32_t w, const uint32_t h)
+    : w(w), h(h), n_tile_x(static_cast<uint32_t>((uint64_t{w} + tile_edge - 1) / tile_edge)),
+      n_tile_y(static_cast<uint32_t>((uint64_t{h} + tile_edge - 1) / tile_edge)) {}
+
+std::optional<Heightmap> Heightmap::open(const std::string &path) {
+    const phase_timer timer(phase::init);
+    const auto fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        std::cerr << "Failed to open " << path << "." << std::endl;
+        return std::nullopt;
+    }
+    struct stat st{};
+    const auto size = fstat(fd, &st) == 0 ? static_cast<size_t>(st.st_size) : 0;
+    if (size < heightmap_data_offset) {
+        close(fd);
+        std::cerr << path << " is not a heightmap." << std::endl;
+        return std::nullopt;
+    }
+    void *p = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) {
+        std::cerr << "Failed to map " << path << "." << std::endl;
+        return std::nullopt;
+    }
+    std::unique_ptr<void, Unmap> mapping(p, Unmap{size});
+    HeightmapHeader header{};
+    std::memcpy(&header, p, sizeof header);
+    Heightmap map(header.width, header.height);
+    // Tiles that fit after the header, so that the size is never computed from untrusted sides.
+    const auto room = (size - heightmap_data_offset) / (tile_cells * sizeof(uint16_t));
+    if (header.magic != heightmap_magic || header.tile_edge != tile_edge || header.width == 0 || header.height == 0 ||
+        header.width > heightmap_max_side || header.height > heightmap_max_side || map.n_tiles() > room) {
+        std::cerr << path << " is not a heightmap of " << tile_edge << "x" << tile_edge << " tiles, at most "
+            << heightmap_max_side << " cells a side." << std::endl;
+        return std::nullopt;
+    }
+    map.cells = reinterpret_cast<const uint16_t *>(static_cast<const char *>(p) + heightmap_data_offset);
+    map.mapping = std::move(mapping);
+    return map;
+}
+
+bool Heightmap::save(const std::string &path) const {
+    std::ofstream file(path, std::ios::binary);
+    HeightmapHeader header{heightmap_magic, w, h, tile_edge, 0};
+    std::vector<char> head(heightmap_data_offset);
+    std::memcpy(head.data(), &header, sizeof header);
+    file.write(head.data(), static_cast<std::streamsize>(head.size()));
+    file.write(reinterpret_cast<const char *>(cells), static_cast<std::streamsize>(n_tiles() * tile_cells * 2));
+    if (!file) {
+        std::cerr << "Failed to write " << path << "." << std::endl;
+        return false;
+    }
+    return true;
+}
+
+namespace {
+    // Value in [0, 1) at lattice point (x, y) of an octave, by the SplitMix64 finalizer.
+    double lattice_value(const uint64_t seed, const uint64_t octave, const uint64_t x, const uint64_t y) {
+        auto z = seed + octave * 0x9E3779B97F4A7C15 + x * 0xC2B2AE3D27D4EB4F + y * 0x165667B19E3779F9;
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EB;
+        z ^= z >> 31;
+        return static_cast<double>(z >> 11) * 0x1p-53;
+    }
+
+    double fade(const double t) { return t * t * (3.0 - 2.0 * t); }
+}
+
+Heightmap random_heightmap(const uint32_t width, const uint32_t height, const uint64_t seed) {
+    const phase_timer timer(phase::init);
+    // Octaves of lattice spacing 256 down to 4 cells, each of half the amplitude of the last.
+    constexpr uint32_t n_octave = 7;
+    constexpr uint32_t widest = 256;
+    constexpr double total_amp = 2.0 - 1.0 / (1 << (n_octave - 1));
+    Heightmap map(width, height);
+    map.owned.resize(map.n_tiles() * tile_cells);
+    map.cells = map.owned.data();
+    std::array<double, tile_cells> sum{};
+    // Lattice values covering one tile; a tile spans at most tile_edge / 4 + 2 points per side.
+    constexpr size_t span = tile_edge / 4 + 2;
+    std::array<double, span * span> lattice{};
+    for (size_t t = 0; t < map.n_tiles(); ++t) {
+        const auto x0 = static_cast<uint32_t>(t % map.n_tile_x) * tile_edge;
+        const auto y0 = static_cast<uint32_t>(t / map.n_tile_x) * tile_edge;
+        sum.fill(0.0);
+        for (uint32_t k = 0; k < n_octave; ++k) {
+            const auto spacing = widest >> k;
+            const auto amp = 1.0 / (1 << k);
+            const auto lx0 = x0 / spacing, ly0 = y0 / spacing;
+            const auto n_point = (tile_edge - 1) / spacing + 2;
+            for (uint32_t j = 0; j < n_point; ++j) {
+                for (uint32_t i = 0; i < n_point; ++i) lattice[j * span + i] = lattice_value(seed, k, lx0 + i, ly0 + j);
+            }
+            for (uint32_t cy = 0; cy < tile_edge; ++cy) {
+                const auto gy = y0 + cy;
+                const auto j = gy / spacing - ly0;
+                const auto ty = fade(static_cast<double>(gy % spacing) / spacing);
+                for (uint32_t cx = 0; cx < tile_edge; ++cx) {
+                    const auto gx = x0 + cx;
+                    const auto i = gx / spacing - lx0;
+                    const auto tx = fade(static_cast<double>(gx % spacing) / spacing);
+                    const auto p = &lattice[j * span + i];
+                    const auto top = p[0] + tx * (p[1] - p[0]);
+                    const auto bottom = p[span] + tx * (p[span + 1] - p[span]);
+                    sum[cy * tile_edge + cx] += amp * (top + ty * (bottom - top));
+                }
+            }
+        }
+        const auto out = map.owned.data() + t * tile_cells;
+        for (uint32_t c = 0; c < tile_cells; ++c) {
+            const auto x = x0 + c % tile_edge, y = y0 + c / tile_edge;
+            out[c] = x < width && y < height ? static_cast<uint16_t>(std::lround(1000.0 * sum[c] / total_amp))
+                                             : wall_height;
+        }
+    }
+    return map;
+}
@@ -0,0 +1,76 @@
+#ifndef HEIGHTMAP_H
+#define HEIGHTMAP_H
+
+#include "common.h"
+
+// Heights on a grid of cells, kept in square tiles of tile_edge^2 cells: the tiles row by row
+// over the map, and the cells row by row within a tile. A tile of 16-bit heights is 2 KiB, so the
+// cells around a walker lie on one or two pages instead of on tile_edge rows of a row-major map.
+// Sides that are not a multiple of tile_edge are padded with walls.
+//
+// File layout: a HeightmapHeader, zeros up to heightmap_data_offset, then every tile as
+// little-endian uint16, so that a mapped file is used in place.
+constexpr uint32_t tile_edge = 32;
+constexpr size_t tile_cells = tile_edge * tile_edge;
+constexpr size_t heightmap_data_offset = 4096;
+// Longest side of a map, which keeps its cell and tile counts well inside 64 bits.
+constexpr uint32_t heightmap_max_side = 1u << 24;
+// Height of an impassable cell.
+constexpr uint16_t wall_height = 0xFFFF;
+
+struct HeightmapHeader {
+    std::array<char, 8> magic;
+    uint32_t width;
+    uint32_t height;
+    uint32_t tile_edge;
+    uint32_t reserved;
+};
+
+constexpr std::array<char, 8> heightmap_magic{'G', 'E', 'N', 'E', '0', '1', 'H', 'M'};
+
+class Heightmap {
+public:
+    // Maps the file read-only; nothing is read until a tile is touched. nullopt, with a message,
+    // when it cannot be mapped or is not a heightmap.
+    static std::optional<Heightmap> open(const std::string &path);
+
+    [[nodiscard]] uint32_t width() const { return w; }
+    [[nodiscard]] uint32_t height() const { return h; }
+    [[nodiscard]] uint32_t tiles_x() const { return n_tile_x; }
+    [[nodiscard]] size_t n_tiles() const { return static_cast<size_t>(n_tile_x) * n_tile_y; }
+
+    // Position of cell (x, y) in the tiled layout; tile t holds positions t * tile_cells onwards.
+    [[nodiscard]] size_t index(const uint32_t x, const uint32_t y) const {
+        const auto tile = static_cast<size_t>(y / tile_edge) * n_tile_x + x / tile_edge;
+        return tile * tile_cells + (y % tile_edge) * tile_edge + x % tile_edge;
+    }
+
+    [[nodiscard]] uint16_t at(const uint32_t x, const uint32_t y) const { return cells[index(x, y)]; }
+
+    // Writes the map in the file layout. False, with a message, on failure.
+    bool save(const std::string &path) const;
+
+private:
+    friend Heightmap random_heightmap(uint32_t width, uint32_t height, uint64_t seed);
+
+    struct Unmap {
+        size_t size;
+        void operator()(void *p) const;
+    };
+
+    Heightmap(uint32_t w, uint32_t h);
+
+    uint32_t w = 0;
+    uint32_t h = 0;
+    uint32_t n_tile_x = 0;
+    uint32_t n_tile_y = 0;
+    const uint16_t *cells = nullptr;
+    // Owner of cells: a mapped file, or a vector for generated maps.
+    std::unique_ptr<void, Unmap> mapping{nullptr, Unmap{0}};
+    std::vector<uint16_t> owned;
+};
+
+// Rolling terrain of fractal value noise with heights in [0, 1000], generated tile by tile.
+Heightmap random_heightmap(uint32_t width, uint32_t height, uint64_t seed);
+
+#endif //HEIGHTMAP_H
@@ -1,27 +1,42 @@
-# Heightmap compilation script
+# Heightmap compilation script: converts the colour-coded heightmap.png into heightmap.ghm, the
+# tiled binary heightmap that gene01 maps (see heightmap.h), for `gene01 run algo=grid map=...`.
+
+import struct
 
 from PIL import Image
 
-c1 = (158, 217, 246)
-c2 = (203, 226, 163)
-c3 = (255, 250, 188)
-c4 = (251, 203, 114)
-c5 = (222, 163, 83)
+levels = {
+    (158, 217, 246): 0,
+    (203, 226, 163): 1,
+    (255, 250, 188): 2,
+    (251, 203, 114): 3,
+    (222, 163, 83): 4,
+}
+
+TILE_EDGE = 32
+DATA_OFFSET = 4096
+WALL = 0xFFFF
 
 img = Image.open('heightmap.png').convert('RGB')
+width, height = img.width, img.height
+tiles_x = (width + TILE_EDGE - 1) // TILE_EDGE
+tiles_y = (height + TILE_EDGE - 1) // TILE_EDGE
+
+
+def level(x, y):
+    if x >= width or y >= height:
+        return WALL
+    pixel = img.getpixel((x, y))
+    if pixel not in levels:
+        raise ValueError('invalid color')
+    return levels[pixel]
+
 
-with open('heightmap.txt', 'w') as o:
-    for y in range(img.height):
-        for x in range(img.width):
-            if img.getpixel((x, y)) == c1:
-                o.write('0')
-            elif img.getpixel((x, y)) == c2:
-                o.write('1')
-            elif img.getpixel((x, y)) == c3:
-                o.write('2')
-            elif img.getpixel((x, y)) == c4:
-                o.write('3')
-            elif img.getpixel((x, y)) == c5:
-                o.write('4')
-            else:
-                raise ValueError('invalid color')
\ No newline at end of file
+with open('heightmap.ghm', 'wb') as o:
+    header = b'GENE01HM' + struct.pack('<4I', width, height, TILE_EDGE, 0)
+    o.write(header.ljust(DATA_OFFSET, b'\0'))
+    for ty in range(tiles_y):
+        for tx in range(tiles_x):
+            cells = [level(tx * TILE_EDGE + cx, ty * TILE_EDGE + cy)
+                     for cy in range(TILE_EDGE) for cx in range(TILE_EDGE)]
+            o.write(struct.pack(f'<{len(cells)}H', *cells))
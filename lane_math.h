@@ -0,0 +1,58 @@
+#ifndef LANE_MATH_H
+#define LANE_MATH_H
+
+#include "common.h"
+
+// Logarithm and exponential over arrays. Each step is a plain loop over the lanes, so they
+// vectorise without calls into libm, at an error of a few ulp. Only the first n lanes are
+// computed, all of them by default; n should be a multiple of the vector width.
+
+// out[l] = log x[l] for positive normal x[l]. x = m 2^e with m in [sqrt(1/2), sqrt(2)), and
+// log m = 2 atanh((m - 1) / (m + 1)) by its series.
+template<size_t N>
+void log_lanes(const double (&x)[N], double (&out)[N], const size_t n = N) {
+    alignas(64) double e[N], t[N], t2[N], p[N];
+    for (size_t l = 0; l < n; ++l) {
+        const auto bits = std::bit_cast<uint64_t>(x[l]);
+        const auto m = std::bit_cast<double>((bits & 0x000FFFFFFFFFFFFF) | 0x3FF0000000000000);
+        const auto high = m > std::numbers::sqrt2;
+        const auto mr = high ? 0.5 * m : m;
+        e[l] = static_cast<double>(static_cast<int64_t>(bits >> 52) - (high ? 1022 : 1023));
+        t[l] = (mr - 1.0) / (mr + 1.0);
+        t2[l] = t[l] * t[l];
+        p[l] = 1.0 / 21;
+    }
+    for (int k = 9; k >= 0; --k) {
+        const auto c = 1.0 / (2 * k + 1);
+        for (size_t l = 0; l < n; ++l) p[l] = p[l] * t2[l] + c;
+    }
+    constexpr double ln2_hi = 0x1.62e42fefa3800p-1;
+    constexpr double ln2_lo = 0x1.ef35793c76730p-45;
+    for (size_t l = 0; l < n; ++l) out[l] = e[l] * ln2_hi + (e[l] * ln2_lo + 2.0 * t[l] * p[l]);
+}
+
+// out[l] = exp x[l], with x[l] clamped to [-708, 709] where the result stays a normal number.
+// x = k log 2 + r with |r| <= log 2 / 2, exp r by its Taylor polynomial, and 2^k put in the
+// exponent.
+template<size_t N>
+void exp_lanes(const double (&x)[N], double (&out)[N], const size_t n = N) {
+    alignas(64) double k[N], r[N], p[N];
+    constexpr double ln2_hi = 0x1.62e42fefa3800p-1;
+    constexpr double ln2_lo = 0x1.ef35793c76730p-45;
+    for (size_t l = 0; l < n; ++l) {
+        const auto v = std::clamp(x[l], -708.0, 709.0);
+        k[l] = std::nearbyint(v * std::numbers::log2e);
+        r[l] = v - k[l] * ln2_hi - k[l] * ln2_lo;
+        p[l] = 1.0 / 479001600;
+    }
+    for (int i = 11; i >= 0; --i) {
+        auto c = 1.0;
+        for (int f = 2; f <= i; ++f) c /= f;
+        for (size_t l = 0; l < n; ++l) p[l] = p[l] * r[l] + c;
+    }
+    for (size_t l = 0; l < n; ++l) {
+        out[l] = p[l] * std::bit_cast<double>(static_cast<uint64_t>(static_cast<int64_t>(k[l]) + 1023) << 52);
+    }
+}
+
+#endif //LANE_MATH_H
@@ -0,0 +1,106 @@
+#include "linalg.h"
+
+void rank_update(matrix &c, const double keep, const matrix &y, const size_t n_vec) {
+    constexpr size_t tile = 64;
+    const auto n = c.rows();
+    for (size_t i0 = 0; i0 < n; i0 += tile) {
+        const auto i1 = std::min(i0 + tile, n);
+        for (size_t j0 = 0; j0 <= i0; j0 += tile) {
+            for (size_t i = i0; i < i1; ++i) {
+                // Row i of the tile, up to the diagonal.
+                const auto j1 = std::min(j0 + tile, i + 1);
+                const auto out = &c(i, 0);
+                for (size_t j = j0; j < j1; ++j) out[j] *= keep;
+                for (size_t k = 0; k < n_vec; ++k) {
+                    const auto yk = y.row(k).data();
+                    const auto a = yk[i];
+                    for (size_t j = j0; j < j1; ++j) out[j] += a * yk[j];
+                }
+            }
+        }
+    }
+}
+
+namespace {
+    // Dot product of the first n values of a and b, over eight partial sums so that the loop
+    // vectorises without reordering additions.
+    double dot(const double *a, const double *b, const size_t n) {
+        constexpr size_t lanes = 8;
+        std::array<double, lanes> part{};
+        size_t k = 0;
+        for (; k + lanes <= n; k += lanes) {
+            for (size_t l = 0; l < lanes; ++l) part[l] += a[k + l] * b[k + l];
+        }
+        for (size_t l = 0; k < n; ++k, ++l) part[l] += a[k] * b[k];
+        return std::reduce(part.begin(), part.end());
+    }
+}
+
+bool cholesky(const matrix &c, matrix &l) {
+    // Row by row (Cholesky-Crout): entry (i, j) needs the dot product of rows i and j of l before
+    // column j, both contiguous.
+    for (size_t i = 0; i < c.rows(); ++i) {
+        const auto li = &l(i, 0);
+        for (size_t j = 0; j < i; ++j) li[j] = (c(i, j) - dot(li, &l(j, 0), j)) / l(j, j);
+        const auto pivot = c(i, i) - dot(li, li, i);
+        if (!(pivot > 0.0)) return false;
+        li[i] = std::sqrt(pivot);
+    }
+    return true;
+}
+
+void lower_times(const matrix &l, const matrix &z, matrix &y) {
+    constexpr size_t col_block = 256;
+    constexpr size_t row_block = 64;
+    const auto n = l.rows();
+    const auto width = z.padded_cols();
+    for (auto &v: y.storage()) v = 0.0;
+    for (size_t c0 = 0; c0 < width; c0 += col_block) {
+        const auto c1 = std::min(c0 + col_block, width);
+        for (size_t b0 = 0; b0 < n; b0 += row_block) {
+            const auto b1 = std::min(b0 + row_block, n);
+            // Rows b0..b1 of z, over these columns, are reused by every row of y from b0 down.
+            for (size_t a = b0; a < n; ++a) {
+                const auto out = y.row(a).data();
+                for (size_t b = b0; b < std::min(b1, a + 1); ++b) {
+                    const auto lab = l(a, b);
+                    const auto in = z.row(b).data();
+                    for (size_t k = c0; k < c1; ++k) out[k] += lab * in[k];
+                }
+            }
+        }
+    }
+}
+
+void times_columns(const matrix &a, const population &x, const size_t first, const size_t len, matrix &y) {
+    constexpr size_t block = 64;
+    const auto n = a.rows(), m = a.cols();
+    for (size_t i = 0; i < n; ++i) std::fill_n(&y(i, 0), len, 0.0);
+    for (size_t k0 = 0; k0 < m; k0 += block) {
+        const auto k1 = std::min(k0 + block, m);
+        size_t i = 0;
+        for (; i + 4 <= n; i += 4) {
+            double *__restrict out0 = &y(i, 0), *__restrict out1 = &y(i + 1, 0);
+            double *__restrict out2 = &y(i + 2, 0), *__restrict out3 = &y(i + 3, 0);
+            for (size_t k = k0; k < k1; ++k) {
+                const double *__restrict in = x.col(k).data() + first;
+                const auto a0 = a(i, k), a1 = a(i + 1, k), a2 = a(i + 2, k), a3 = a(i + 3, k);
+                for (size_t c = 0; c < len; ++c) {
+                    const auto v = in[c];
+                    out0[c] += a0 * v;
+                    out1[c] += a1 * v;
+                    out2[c] += a2 * v;
+                    out3[c] += a3 * v;
+                }
+            }
+        }
+        for (; i < n; ++i) {
+            double *__restrict out = &y(i, 0);
+            for (size_t k = k0; k < k1; ++k) {
+                const double *__restrict in = x.col(k).data() + first;
+                const auto aik = a(i, k);
+                for (size_t c = 0; c < len; ++c) out[c] += aik * in[c];
+            }
+        }
+    }
+}
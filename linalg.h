@@ -0,0 +1,64 @@
+#ifndef LINALG_H
+#define LINALG_H
+
+#include "common.h"
+#include "population.h"
+
+// Dense row-major matrix. Like population columns, every row starts on a cache line and is padded
+// with zeros to a whole number of lines.
+class matrix {
+public:
+    matrix() = default;
+
+    matrix(const size_t n_row, const size_t n_col)
+        : n_row(n_row), n_col(n_col), stride((n_col + lane - 1) / lane * lane), data(stride * n_row) {}
+
+    [[nodiscard]] size_t rows() const { return n_row; }
+    [[nodiscard]] size_t cols() const { return n_col; }
+    [[nodiscard]] size_t padded_cols() const { return stride; }
+
+    std::span<double> row(const size_t i) { return {data.data() + i * stride, n_col}; }
+    [[nodiscard]] std::span<const double> row(const size_t i) const { return {data.data() + i * stride, n_col}; }
+
+    double &operator()(const size_t i, const size_t j) { return data[i * stride + j]; }
+    double operator()(const size_t i, const size_t j) const { return data[i * stride + j]; }
+
+    // Every element, padding included, row after row.
+    std::span<double> storage() { return data; }
+
+    // Zero the padding after a write through storage().
+    void clear_padding() {
+        for (size_t i = 0; i < n_row; ++i) std::fill_n(data.data() + i * stride + n_col, stride - n_col, 0.0);
+    }
+
+private:
+    static constexpr size_t lane = column_align / sizeof(double);
+    size_t n_row = 0;
+    size_t n_col = 0;
+    size_t stride = 0;
+    aligned_vector<double> data;
+};
+
+// Symmetric rank-k update of the lower triangle of the square c: c = keep c + sum of y_k y_k^T over
+// the first n_vec rows y_k of y, which must have c.rows() columns. The upper triangle is not read
+// or written. c is updated tile by tile, so that each tile of c stays in L1 while the rows of y
+// stream past it.
+void rank_update(matrix &c, double keep, const matrix &y, size_t n_vec);
+
+// Cholesky factor of the symmetric positive definite c, whose lower triangle alone is read:
+// l l^T = c with l lower triangular. l must be c's shape; its upper triangle is left alone. False
+// when a pivot is not positive, i.e. c is not numerically positive definite.
+bool cholesky(const matrix &c, matrix &l);
+
+// y = l z for lower triangular l, with z and y of l.rows() rows. Computed on blocks of columns and
+// of rows of z small enough for L2, as a sum of scaled rows so that the inner loop vectorises.
+void lower_times(const matrix &l, const matrix &z, matrix &y);
+
+// y = a x over members first, ..., first + len - 1 of x, taking x as the dim() by size() matrix of
+// its columns: row i of y holds coordinate i of those members after the map. len must be no more
+// than y.cols() and end within x.padded_size(). Four rows of y are updated together, over blocks of
+// 64 columns of a, so that every stretch of x loaded is used four times while those rows stay in
+// L1 and the block's stretches of x in L2.
+void times_columns(const matrix &a, const population &x, size_t first, size_t len, matrix &y);
+
+#endif //LINALG_H
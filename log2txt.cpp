@@ -0,0 +1,18 @@
+#include "common.h"
+#include "trajectory.h"
+
+// Regenerate the text log of a trajectory file: log2txt de_rand_1.trj [de_rand_1.log]
+int main(const int argc, char **argv) {
+    if (argc < 2) {
+        std::cerr << "Usage: " << argv[0] << " <trajectory> [text log]" << std::endl;
+        return 2;
+    }
+    const std::string in = argv[1];
+    auto out = argc > 2 ? std::string(argv[2]) : in.substr(0, in.rfind('.')) + ".log";
+    auto reader = trajectory_reader::open(in);
+    if (!reader) return 1;
+    std::ofstream log_file(out);
+    std::vector<double> values(reader->shape().record_size());
+    while (reader->next(values)) print_record(log_file, reader->shape(), values);
+    return 0;
+}
@@ -1,15 +1,100 @@
+#include "engines.h"
+#include "profile.h"
+#include "sweep.h"
+#include "tune.h"
+
+#include <chrono>
+#include <string_view>
 
 void main_de();
 void main_pso();
 void main_ga();
 void main_eda();
 void main_aco();
+void main_grid();
+
+// gene01 run algo=<de|pso|ga|eda|aco|grid> [key=value ...] [--config file]
+//
+// DE, PSO, GA and EDA minimise the function named by function=<sphere|rastrigin|...>, which
+// shift, rotate and instance move as in the BBOB suite; see objective.h. With
+// multi=<zdt1|zdt2|zdt3|dtlz2>, the GA runs NSGA-II on that multi-objective problem instead and
+// reports the distance of its first front from the Pareto-optimal set; see nsga.cpp.
+//
+// The run ends after n_epoch epochs or on a stopping criterion, and may be restarted with a larger
+// population; see termination.h. The line it prints says which criterion ended it.
+//
+// With checkpoint=<file>, the run saves its state every checkpoint_every epochs and, when the file
+// already holds a checkpoint of the same settings, resumes from it; see checkpoint.h.
+//
+// Built with GENE01_PROFILE, the run ends with its profile on std::cerr, and profile=<file> writes
+// it as JSON too; see profile.h.
+int run(const std::span<char *const> args) {
+    const auto cfg = config::parse(args);
+    if (!cfg) return 1;
+    std::string profile_path;
+    if (!cfg->read("profile", profile_path)) return 1;
+    if (!profiling && !profile_path.empty()) {
+        std::cerr << "Built without GENE01_PROFILE; profile=" << profile_path << " is ignored." << std::endl;
+    }
+    const auto begin = std::chrono::steady_clock::now();
+    const auto summary = run_engine(*cfg);
+    if (!summary) return 1;
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - begin;
+    for (const auto &key: cfg->unused()) std::cerr << "Unused setting '" << key << "'." << std::endl;
+    std::cout << "best " << summary->best << " evaluations " << summary->n_eval << " seconds " << elapsed.count()
+        << " stop " << stop_reason_names[static_cast<size_t>(summary->stop)] << " restarts " << summary->n_restart
+        << std::endl;
+    if constexpr (profiling) {
+        profile_summary(std::cerr);
+        if (!profile_path.empty() && !write_profile_json(profile_path)) return 1;
+    }
+    return 0;
+}
+
+// Optional thread count argument, all hardware threads by default.
+std::optional<size_t> thread_count(const std::span<char *const> args, const size_t i) {
+    size_t n_thread = std::thread::hardware_concurrency();
+    if (i < args.size()) {
+        const std::string_view text = args[i];
+        const auto [end, ec] = std::from_chars(text.data(), text.data() + text.size(), n_thread);
+        if (ec != std::errc() || end != text.data() + text.size() || n_thread == 0) {
+            std::cerr << "Invalid thread count '" << text << "'." << std::endl;
+            return std::nullopt;
+        }
+    }
+    return n_thread;
+}
+
+// gene01 sweep spec results [threads]; see sweep.h.
+int sweep(const std::span<char *const> args) {
+    if (args.size() < 2 || args.size() > 3) {
+        std::cerr << "Usage: gene01 sweep spec results [threads]" << std::endl;
+        return 1;
+    }
+    const auto n_thread = thread_count(args, 2);
+    return n_thread && run_sweep(args[0], args[1], *n_thread) ? 0 : 1;
+}
+
+// gene01 tune spec [threads]; see tune.h.
+int tune(const std::span<char *const> args) {
+    if (args.empty() || args.size() > 2) {
+        std::cerr << "Usage: gene01 tune spec [threads]" << std::endl;
+        return 1;
+    }
+    const auto n_thread = thread_count(args, 1);
+    return n_thread && run_tune(args[0], *n_thread) ? 0 : 1;
+}
 
-int main() {
-    main_de();
-    main_pso();
-    main_ga();
-    main_eda();
-    main_aco();
+int main(const int argc, char **argv) {
+    if (argc > 1 && std::string_view(argv[1]) == "run") return run(std::span(argv + 2, argc - 2));
+    if (argc > 1 && std::string_view(argv[1]) == "sweep") return sweep(std::span(argv + 2, argc - 2));
+    if (argc > 1 && std::string_view(argv[1]) == "tune") return tune(std::span(argv + 2, argc - 2));
+    for (const auto demo: {main_de, main_pso, main_ga, main_eda, main_aco, main_grid}) {
+        demo();
+        if constexpr (profiling) {
+            profile_summary(std::cout);
+            profile_reset();
+        }
+    }
     return 0;
-}
\ No newline at end of file
+}
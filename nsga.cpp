@@ -0,0 +1,320 @@
+#include "common.h"
+#include "bench.h"
+#include "checkpoint.h"
+#include "engines.h"
+#include "pareto.h"
+#include "profile.h"
+#include "rng.h"
+#include "termination.h"
+#include "trajectory.h"
+#include "variation.h"
+
+// Multi-objective test problems over [0, 1]^n, all minimised:
+//   - zdt1, zdt2, zdt3 (Zitzler, Deb and Thiele, 2000): f1 = x_1 and f2 = g h(f1 / g), with
+//     g = 1 + 9 sum x_j / (n - 1) over j > 1 and h(r) = 1 - sqrt r, 1 - r^2 and
+//     1 - sqrt r - r sin(10 pi f1); convex, concave and disconnected fronts;
+//   - dtlz2 (Deb, Thiele, Laumanns and Zitzler, 2002), with any number M of objectives:
+//     f_m = (1 + g) cos(x_1 pi / 2) ... cos(x_{M-m} pi / 2) sin(x_{M-m+1} pi / 2), without the
+//     sine for m = 1, and g = sum (x_j - 1/2)^2 over j >= M; the front is the unit sphere.
+// Their Pareto-optimal sets are where g is least: 1 for ZDT and 0 for DTLZ2.
+enum class front_problem { zdt1, zdt2, zdt3, dtlz2 };
+
+constexpr std::array<std::pair<std::string_view, front_problem>, 4> front_problem_names{{
+    {"zdt1", front_problem::zdt1}, {"zdt2", front_problem::zdt2}, {"zdt3", front_problem::zdt3},
+    {"dtlz2", front_problem::dtlz2},
+}};
+
+// Objectives of x into column i of objs, which has a row per objective; returns the distance of x
+// from the Pareto-optimal set, g less its least value.
+double evaluate_front(const front_problem f, const std::span<const double> x, matrix &objs, const size_t i) {
+    constexpr auto half_pi = std::numbers::pi / 2.0;
+    if (f == front_problem::dtlz2) {
+        const auto n_obj = objs.rows();
+        double g = 0.0;
+        for (size_t j = n_obj - 1; j < x.size(); ++j) g += (x[j] - 0.5) * (x[j] - 0.5);
+        for (size_t r = 0; r < n_obj; ++r) {
+            auto v = 1.0 + g;
+            for (size_t j = 0; j + r + 1 < n_obj; ++j) v *= std::cos(x[j] * half_pi);
+            if (r > 0) v *= std::sin(x[n_obj - 1 - r] * half_pi);
+            objs(r, i) = v;
+        }
+        return g;
+    }
+    const auto rest = std::reduce(x.begin() + 1, x.end());
+    const auto g = 1.0 + 9.0 * rest / static_cast<double>(x.size() - 1);
+    const auto r = x[0] / g;
+    objs(0, i) = x[0];
+    switch (f) {
+        case front_problem::zdt1:
+            objs(1, i) = g * (1.0 - std::sqrt(r));
+            break;
+        case front_problem::zdt2:
+            objs(1, i) = g * (1.0 - r * r);
+            break;
+        default:
+            objs(1, i) = g * (1.0 - std::sqrt(r) - r * std::sin(10.0 * std::numbers::pi * x[0]));
+            break;
+    }
+    return g - 1.0;
+}
+
+struct nsga_params {
+    size_t n_gene;
+    size_t n_loci;
+    size_t n_epoch;
+    double p_cross;
+    // Per locus.
+    double p_mutate;
+    double sbx_eta;
+    double pm_eta;
+    uint64_t seed;
+    front_problem multi = front_problem::zdt1;
+    size_t n_obj = 2;
+};
+
+// NSGA-II (Deb et al., 2002): every epoch breeds as many offspring as there are parents, by binary
+// tournaments on front then crowding distance, SBX and polynomial mutation, and keeps the best half of
+// parents and offspring together, front by front, splitting the last front that fits in part by
+// crowding distance. Chromosomes are rows in one buffer, as in the GA, and objectives a row each of
+// a matrix, parents in the first n_gene places and offspring in the next. Reports the mean
+// distance of the first front from the Pareto-optimal set.
+std::optional<run_summary> demo_nsga(const nsga_params &params, const std::string &log_name,
+                                     const sampling policy = {}, const checkpointing &ck = {},
+                                     const stopping &crit = {}) {
+    const auto n = params.n_gene;
+    const auto n_loci = params.n_loci;
+    const auto n_obj = params.n_obj;
+
+    std::vector<double> genes(2 * n * n_loci);
+    matrix objs(n_obj, 2 * n);
+    std::vector<double> dist(2 * n);
+    std::vector<double> crowd(2 * n);
+    std::vector<uint32_t> rank(n);
+    const auto row = [&](const size_t i) { return std::span(genes).subspan(i * n_loci, n_loci); };
+    const auto parents = std::span(genes).first(n * n_loci);
+    const auto offspring = std::span(genes).subspan(n * n_loci);
+    front_sorter sorter;
+    const auto mean_distance = [&] {
+        double sum = 0.0;
+        size_t count = 0;
+        for (size_t i = 0; i < n; ++i) {
+            if (rank[i] == 0) {
+                sum += dist[i];
+                ++count;
+            }
+        }
+        return sum / static_cast<double>(count);
+    };
+    size_t n_eval = n;
+    counter_rng rng(params.seed);
+    {
+        const phase_timer timer(phase::init);
+        rng.fill_uniform(parents);
+        matrix initial(n_obj, n);
+        for (size_t i = 0; i < n; ++i) dist[i] = evaluate_front(params.multi, row(i), initial, i);
+        sorter.sort(initial);
+        for (size_t k = 0; k < sorter.fronts(); ++k) sorter.crowd(initial, k, crowd);
+        std::ranges::copy(sorter.ranks(), rank.begin());
+        for (size_t r = 0; r < n_obj; ++r) std::ranges::copy(initial.row(r), objs.row(r).begin());
+        profile_count(profile_counter::evaluations, n);
+    }
+    auto best = mean_distance();
+    convergence watch(crit);
+    size_t first = 0;
+    if (ck.resume) {
+        auto in = ck.resume->state();
+        in.get(parents);
+        in.get(objs);
+        in.get(std::span(dist));
+        in.get(std::span(crowd));
+        in.get(std::span(rank));
+        in.get(best);
+        in.get(n_eval);
+        in.get(rng);
+        watch.restore(in);
+        if (!ck.restored(in)) return std::nullopt;
+        first = ck.resume->epoch();
+    }
+    // The mean distance, the size of the first front and the number of fronts, then every parent's
+    // objectives and front.
+    const auto width = static_cast<uint32_t>(n_obj + 1);
+    trajectory_writer log(log_name, {trajectory_layout::population, 3, static_cast<uint32_t>(n), width}, policy,
+                          ck.resume ? ck.resume->records() : 0);
+    checkpoint_writer saver(ck, log);
+    const auto spread = [&] {
+        spread_sum sum(n_loci);
+        sum.add_rows(parents);
+        return sum.value();
+    };
+    // The better of two parents drawn uniformly.
+    const auto tournament = [&] {
+        const auto a = rng.below(static_cast<uint32_t>(n)), b = rng.below(static_cast<uint32_t>(n));
+        return rank[a] < rank[b] || (rank[a] == rank[b] && crowd[a] >= crowd[b]) ? a : b;
+    };
+    std::vector<uint32_t> chosen, split;
+    std::vector<double> kept_genes(n * n_loci);
+    matrix kept_objs(n_obj, n);
+    std::vector<double> kept_dist(n), kept_crowd(n);
+    auto stop = stop_reason::epochs;
+
+    for (size_t epoch = first; epoch < params.n_epoch; ++epoch) {
+        if (saver.due(epoch)) {
+            snapshot out;
+            out.put(parents);
+            out.put(objs);
+            out.put(dist);
+            out.put(crowd);
+            out.put(rank);
+            out.put(best);
+            out.put(n_eval);
+            out.put(rng);
+            watch.save(out);
+            saver.save(epoch, std::move(out));
+        }
+
+        // Offspring in pairs, the last alone when n is odd.
+        phase_timer timer(phase::vary);
+        for (size_t s = 0; s < n; s += 2) {
+            const auto a = row(n + s);
+            std::ranges::copy(row(tournament()), a.begin());
+            if (s + 1 == n) break;
+            const auto b = row(n + s + 1);
+            std::ranges::copy(row(tournament()), b.begin());
+            if (rng.uniform() < params.p_cross) cross_sbx(a, b, params.sbx_eta, 0.0, 1.0, rng);
+        }
+        mutate_polynomial(offspring, params.p_mutate, params.pm_eta, 0.0, 1.0, rng, [](size_t, double) {});
+
+        timer.switch_to(phase::evaluate);
+        for (size_t i = n; i < 2 * n; ++i) dist[i] = evaluate_front(params.multi, row(i), objs, i);
+        n_eval += n;
+        profile_count(profile_counter::evaluations, n);
+
+        // Whole fronts while they fit, then the least crowded of the next.
+        timer.switch_to(phase::update);
+        sorter.sort(objs);
+        chosen.clear();
+        for (size_t k = 0; chosen.size() < n; ++k) {
+            sorter.crowd(objs, k, crowd);
+            const auto f = sorter.front(k);
+            if (chosen.size() + f.size() <= n) {
+                chosen.insert(chosen.end(), f.begin(), f.end());
+                continue;
+            }
+            split.assign(f.begin(), f.end());
+            std::ranges::sort(split, [&](const uint32_t a, const uint32_t b) {
+                return crowd[a] > crowd[b] || (crowd[a] == crowd[b] && a < b);
+            });
+            chosen.insert(chosen.end(), split.begin(), split.begin() + static_cast<ptrdiff_t>(n - chosen.size()));
+        }
+        for (size_t s = 0; s < n; ++s) {
+            const auto c = chosen[s];
+            std::ranges::copy(row(c), kept_genes.begin() + static_cast<ptrdiff_t>(s * n_loci));
+            for (size_t r = 0; r < n_obj; ++r) kept_objs(r, s) = objs(r, c);
+            kept_dist[s] = dist[c];
+            kept_crowd[s] = crowd[c];
+            rank[s] = sorter.ranks()[c];
+        }
+        std::ranges::copy(kept_genes, parents.begin());
+        for (size_t r = 0; r < n_obj; ++r) std::ranges::copy(kept_objs.row(r), objs.row(r).begin());
+        std::ranges::copy(kept_dist, dist.begin());
+        std::ranges::copy(kept_crowd, crowd.begin());
+        best = mean_distance();
+        const auto why = watch.check(best, n_eval, spread);
+
+        timer.switch_to(phase::log);
+        if (const auto rec = log.record(epoch); !rec.empty()) {
+            rec[0] = best;
+            rec[1] = static_cast<double>(std::ranges::count(rank, 0u));
+            rec[2] = static_cast<double>(std::ranges::max(rank) + 1);
+            for (size_t i = 0; i < n; ++i) {
+                for (size_t r = 0; r < n_obj; ++r) rec[3 + r * n + i] = objs(r, i);
+                rec[3 + n_obj * n + i] = rank[i];
+            }
+        }
+        if (why) {
+            stop = *why;
+            break;
+        }
+    }
+    return run_summary{best, n_eval, stop};
+}
+
+std::optional<run_summary> run_nsga(const config &cfg) {
+    // p_mutate is 1 / n_loci and n_obj the problem's own unless set.
+    nsga_params p{100, 30, 250, 0.9, std::numeric_limits<double>::quiet_NaN(), 15.0, 20.0, 0};
+    size_t n_obj = 0;
+    std::string log_name;
+    sampling policy;
+    if (!(cfg.read("multi", p.multi, front_problem_names) && cfg.read("n_obj", n_obj) &&
+          cfg.read("n_gene", p.n_gene) && cfg.read("n_loci", p.n_loci) && cfg.read("n_epoch", p.n_epoch) &&
+          cfg.read("p_cross", p.p_cross) && cfg.read("p_mutate", p.p_mutate) && cfg.read("sbx_eta", p.sbx_eta) &&
+          cfg.read("pm_eta", p.pm_eta) && cfg.read("seed", p.seed) && cfg.read("log", log_name) &&
+          cfg.read("log_every", policy.every))) {
+        return std::nullopt;
+    }
+    const auto zdt = p.multi != front_problem::dtlz2;
+    p.n_obj = n_obj ? n_obj : zdt ? 2 : 3;
+    if (std::isnan(p.p_mutate)) p.p_mutate = 1.0 / static_cast<double>(p.n_loci);
+    if (p.n_gene == 0 || p.n_gene > std::numeric_limits<uint32_t>::max() / 2 || p.n_obj < 2 ||
+        (zdt && p.n_obj != 2) || p.n_loci < std::max<size_t>(2, p.n_obj) || p.sbx_eta < 0.0 ||
+        p.pm_eta < 0.0) {
+        std::cerr << "NSGA-II needs 1 <= n_gene < 2^31, n_obj = 2 for ZDT and n_obj >= 2 for DTLZ2, "
+            "n_loci >= max(2, n_obj), sbx_eta >= 0 and pm_eta >= 0." << std::endl;
+        return std::nullopt;
+    }
+    const auto ck = read_checkpointing(cfg);
+    const auto crit = read_stopping(cfg);
+    const auto again = read_restarts(cfg);
+    if (!(ck && crit && again)) return std::nullopt;
+    const auto one_run = [&](const size_t n, const uint64_t seed, const stopping &left, const size_t index) {
+        auto q = p;
+        q.n_gene = std::min<size_t>(n, std::numeric_limits<uint32_t>::max() / 2);
+        q.seed = seed;
+        return demo_nsga(q, restart_log_name(log_name, index), policy, *ck, left);
+    };
+    return run_restarts(*again, *crit, p.n_gene, p.seed, one_run);
+}
+
+// Non-dominated sorting of 10^2 to 10^5 points with 2 and 3 objectives, and up to 10^4 with 5,
+// where the scans of ENS-BS grow quadratic, drawn uniformly from the unit cube, which spreads them
+// over many fronts, or on the plane where the objectives sum to M - 1, which puts them all on one.
+// The sort alone, crowding distance over every front after it, and the naive sort while it takes
+// seconds at most; the ranks of the two must agree, and a case where they do not is a failure.
+void bench_nsga(bench_report &report) {
+    counter_rng rng(17);
+    for (const size_t n_obj: {size_t{2}, size_t{3}, size_t{5}}) {
+        for (const auto one_front: {false, true}) {
+            for (size_t n = 100; n <= (n_obj > 3 ? 10'000 : 100'000); n *= 10) {
+                matrix objs(n_obj, n);
+                for (size_t r = 0; r < n_obj; ++r) rng.fill_uniform(objs.row(r));
+                if (one_front) {
+                    for (size_t i = 0; i < n; ++i) {
+                        objs(n_obj - 1, i) = static_cast<double>(n_obj - 1);
+                        for (size_t r = 0; r + 1 < n_obj; ++r) objs(n_obj - 1, i) -= objs(r, i);
+                    }
+                }
+                front_sorter sorter;
+                std::vector<double> crowd(n);
+                const auto spread = std::string(one_front ? "_one_front" : "_uniform");
+                const auto time = [&](const std::string_view name, const auto &op) {
+                    const auto s = seconds_per_call(op);
+                    report.add({"nsga", std::string(name) + spread, {{"n", n}, {"n_obj", n_obj}},
+                                {{"ms_per_sort", s * 1e3}, {"ns_per_point", s * 1e9 / static_cast<double>(n)},
+                                 {"fronts", sorter.fronts()}}});
+                };
+                time("sort", [&] { sorter.sort(objs); });
+                time("sort_crowd", [&] {
+                    sorter.sort(objs);
+                    for (size_t k = 0; k < sorter.fronts(); ++k) sorter.crowd(objs, k, crowd);
+                });
+                if (n <= 10'000) {
+                    std::vector<uint32_t> rank(n);
+                    time("naive", [&] { naive_front_ranks(objs, rank); });
+                    if (!std::ranges::equal(rank, sorter.ranks())) {
+                        report.add_failure({"nsga", "ranks" + spread, {{"n", n}, {"n_obj", n_obj}}, {}});
+                    }
+                }
+            }
+        }
+    }
+}
\ No newline at end of file
@@ -0,0 +1,373 @@
+#include "objective.h"
+#include "profile.h"
+#include "rng.h"
+
+#include <immintrin.h>
+
+namespace {
+    // Minimiser of x sin sqrt x near 420.97, and its value there.
+    constexpr double schwefel_x = 420.96874635998202731;
+    constexpr double schwefel_f = 418.98288727243370627;
+
+    // The functions on one point z, already moved.
+    double sphere(std::span<const double> z) {
+        double sum = 0.0;
+        for (const auto v: z) sum += v * v;
+        return sum;
+    }
+
+    double rastrigin(std::span<const double> z) {
+        double sum = 10.0 * static_cast<double>(z.size());
+        for (const auto v: z) sum += v * v - 10.0 * std::cos(2 * std::numbers::pi * v);
+        return sum;
+    }
+
+    double rosenbrock(std::span<const double> z) {
+        double sum = 0.0;
+        for (size_t j = 0; j + 1 < z.size(); ++j) {
+            const auto x = z[j] + 1.0;
+            const auto t = z[j + 1] + 1.0 - x * x;
+            sum += 100.0 * t * t + z[j] * z[j];
+        }
+        return sum;
+    }
+
+    double ackley(std::span<const double> x) {
+        double sum_sq = 0.0;
+        double sum_cos = 0.0;
+        for (const auto v: x) {
+            sum_sq += v * v;
+            sum_cos += std::cos(2 * std::numbers::pi * v);
+        }
+        const auto n = static_cast<double>(x.size());
+        return -20.0 * std::exp(-0.2 * std::sqrt(sum_sq / n)) - std::exp(sum_cos / n) + 20 + std::numbers::e;
+    }
+
+    double griewank(std::span<const double> z) {
+        double sum = 0.0, prod = 1.0;
+        for (size_t j = 0; j < z.size(); ++j) {
+            sum += z[j] * z[j];
+            prod *= std::cos(z[j] / std::sqrt(static_cast<double>(j + 1)));
+        }
+        return 1.0 + sum / 4000.0 - prod;
+    }
+
+    double schwefel(std::span<const double> z) {
+        double sum = 0.0;
+        for (const auto v: z) {
+            const auto x = v + schwefel_x;
+            sum += x * std::sin(std::sqrt(std::abs(x)));
+        }
+        return schwefel_f * static_cast<double>(z.size()) - sum;
+    }
+
+    double levy(std::span<const double> z) {
+        if (z.empty()) return 0.0;
+        const auto sin2 = [](const double a) { return std::sin(a) * std::sin(a); };
+        const auto n = z.size();
+        double sum = sin2(std::numbers::pi * (1.0 + z[0] / 4.0));
+        for (size_t j = 0; j + 1 < n; ++j) {
+            const auto w1 = z[j] / 4.0;
+            sum += w1 * w1 * (1.0 + 10.0 * sin2(std::numbers::pi * (1.0 + w1) + 1.0));
+        }
+        const auto w1 = z[n - 1] / 4.0;
+        return sum + w1 * w1 * (1.0 + sin2(2 * std::numbers::pi * (1.0 + w1)));
+    }
+
+    double value_of(const landscape f, const std::span<const double> z) {
+        switch (f) {
+            case landscape::sphere: return sphere(z);
+            case landscape::rastrigin: return rastrigin(z);
+            case landscape::rosenbrock: return rosenbrock(z);
+            case landscape::ackley: return ackley(z);
+            case landscape::griewank: return griewank(z);
+            case landscape::schwefel: return schwefel(z);
+            case landscape::levy: return levy(z);
+        }
+        return 0.0;
+    }
+}
+
+#if defined(__AVX512F__)
+#define VECTOR_KERNELS
+struct simd {
+    using reg = __m512d;
+    static constexpr size_t width = 8;
+    static reg load(const double *p) { return _mm512_load_pd(p); }
+    static void store(double *p, const reg a) { _mm512_store_pd(p, a); }
+    static reg set1(const double a) { return _mm512_set1_pd(a); }
+    static reg add(const reg a, const reg b) { return _mm512_add_pd(a, b); }
+    static reg sub(const reg a, const reg b) { return _mm512_sub_pd(a, b); }
+    static reg mul(const reg a, const reg b) { return _mm512_mul_pd(a, b); }
+    static reg fmadd(const reg a, const reg b, const reg c) { return _mm512_fmadd_pd(a, b, c); }
+    static reg fnmadd(const reg a, const reg b, const reg c) { return _mm512_fnmadd_pd(a, b, c); }
+    static reg max(const reg a, const reg b) { return _mm512_max_pd(a, b); }
+    static reg sqrt(const reg a) { return _mm512_sqrt_pd(a); }
+    static reg abs(const reg a) { return _mm512_abs_pd(a); }
+    static reg round(const reg a) { return _mm512_roundscale_pd(a, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC); }
+    static reg shl_bits(const reg a, const int n) {
+        return _mm512_castsi512_pd(_mm512_slli_epi64(_mm512_castpd_si512(a), n));
+    }
+    static reg add_bits(const reg a, const int64_t n) {
+        return _mm512_castsi512_pd(_mm512_add_epi64(_mm512_castpd_si512(a), _mm512_set1_epi64(n)));
+    }
+    static reg xor_bits(const reg a, const reg b) {
+        return _mm512_castsi512_pd(_mm512_xor_si512(_mm512_castpd_si512(a), _mm512_castpd_si512(b)));
+    }
+};
+#elif defined(__AVX2__) && defined(__FMA__)
+#define VECTOR_KERNELS
+struct simd {
+    using reg = __m256d;
+    static constexpr size_t width = 4;
+    static reg load(const double *p) { return _mm256_load_pd(p); }
+    static void store(double *p, const reg a) { _mm256_store_pd(p, a); }
+    static reg set1(const double a) { return _mm256_set1_pd(a); }
+    static reg add(const reg a, const reg b) { return _mm256_add_pd(a, b); }
+    static reg sub(const reg a, const reg b) { return _mm256_sub_pd(a, b); }
+    static reg mul(const reg a, const reg b) { return _mm256_mul_pd(a, b); }
+    static reg fmadd(const reg a, const reg b, const reg c) { return _mm256_fmadd_pd(a, b, c); }
+    static reg fnmadd(const reg a, const reg b, const reg c) { return _mm256_fnmadd_pd(a, b, c); }
+    static reg max(const reg a, const reg b) { return _mm256_max_pd(a, b); }
+    static reg sqrt(const reg a) { return _mm256_sqrt_pd(a); }
+    static reg abs(const reg a) { return _mm256_andnot_pd(_mm256_set1_pd(-0.0), a); }
+    static reg round(const reg a) { return _mm256_round_pd(a, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC); }
+    static reg shl_bits(const reg a, const int n) {
+        return _mm256_castsi256_pd(_mm256_slli_epi64(_mm256_castpd_si256(a), n));
+    }
+    static reg add_bits(const reg a, const int64_t n) {
+        return _mm256_castsi256_pd(_mm256_add_epi64(_mm256_castpd_si256(a), _mm256_set1_epi64x(n)));
+    }
+    static reg xor_bits(const reg a, const reg b) {
+        return _mm256_castsi256_pd(_mm256_xor_si256(_mm256_castpd_si256(a), _mm256_castpd_si256(b)));
+    }
+};
+#endif
+
+#ifdef VECTOR_KERNELS
+// Adding 1.5 * 2^52 to an integral double leaves the integer, in two's complement, in the low
+// mantissa bits.
+constexpr double int_magic = 0x1.8p52;
+
+// exp(a) for a >= -708: a = n ln2 + r with |r| <= ln2 / 2, a degree-13 Taylor polynomial for
+// exp(r), and 2^n assembled directly in the exponent bits.
+simd::reg exp_kernel(simd::reg a) {
+    using s = simd;
+    a = s::max(a, s::set1(-708.0));
+    const auto n = s::round(s::mul(a, s::set1(std::numbers::log2e)));
+    auto r = s::fnmadd(n, s::set1(0x1.62e42fefa3800p-1), a);
+    r = s::fnmadd(n, s::set1(0x1.ef35793c76730p-45), r);
+    auto p = s::set1(1.0 / 6227020800.0);
+    constexpr std::array<double, 13> coef{
+        1.0 / 479001600.0, 1.0 / 39916800.0, 1.0 / 3628800.0, 1.0 / 362880.0, 1.0 / 40320.0,
+        1.0 / 5040.0, 1.0 / 720.0, 1.0 / 120.0, 1.0 / 24.0, 1.0 / 6.0, 0.5, 1.0, 1.0
+    };
+    for (const auto c: coef) p = s::fmadd(p, r, s::set1(c));
+    const auto scale = s::shl_bits(s::add_bits(s::add(n, s::set1(int_magic)), 1023), 52);
+    return s::mul(p, scale);
+}
+
+// cos(2 pi x): x = q / 2 + r with |r| <= 1/4 is reduced exactly in units of whole turns, so
+// cos(2 pi x) = (-1)^q cos(2 pi r), and cos is a degree-20 Taylor polynomial on [-pi/2, pi/2].
+simd::reg cos_2pi_kernel(const simd::reg x) {
+    using s = simd;
+    const auto q = s::round(s::add(x, x));
+    const auto r = s::fnmadd(q, s::set1(0.5), x);
+    const auto t = s::mul(r, s::set1(2 * std::numbers::pi));
+    const auto y = s::mul(t, t);
+    auto p = s::set1(1.0 / 2432902008176640000.0);
+    constexpr std::array<double, 10> coef{
+        -1.0 / 6402373705728000.0, 1.0 / 20922789888000.0, -1.0 / 87178291200.0, 1.0 / 479001600.0,
+        -1.0 / 3628800.0, 1.0 / 40320.0, -1.0 / 720.0, 1.0 / 24.0, -0.5, 1.0
+    };
+    for (const auto c: coef) p = s::fmadd(p, y, s::set1(c));
+    const auto sign = s::shl_bits(s::add(q, s::set1(int_magic)), 63);
+    return s::xor_bits(p, sign);
+}
+
+// Members are processed in blocks small enough for their running sums to stay in registers and L1
+// while every column is streamed through once.
+constexpr size_t block = 4 * simd::width;
+
+// Values of up to block members, whose coordinate j is at z[j * stride], z[j * stride + 1], ...,
+// into out; len is a whole number of registers. Every sine is a cos_2pi_kernel a quarter turn on,
+// and every sin^2 a = (1 - cos 2a) / 2.
+template<landscape f>
+void block_values(const double *z, const size_t stride, const size_t n_dim, const size_t len, double *out) {
+    using s = simd;
+    const auto n = static_cast<double>(n_dim);
+    // Rosenbrock's terms each take two neighbouring axes.
+    const auto n_term = f == landscape::rosenbrock ? n_dim - 1 : n_dim;
+    s::reg a[block / s::width]{}, b[block / s::width]{};
+    if constexpr (f == landscape::griewank) std::ranges::fill(b, s::set1(1.0));
+    for (size_t j = 0; j < n_term; ++j) {
+        const auto col = z + j * stride;
+        // Griewank's cos(z / sqrt j), in turns.
+        const auto root = std::sqrt(static_cast<double>(j + 1));
+        const auto turn = f == landscape::griewank ? 0.5 / std::numbers::pi / root : 0.0;
+        for (size_t k = 0; k * s::width < len; ++k) {
+            const auto x = s::load(col + k * s::width);
+            if constexpr (f == landscape::sphere) {
+                a[k] = s::fmadd(x, x, a[k]);
+            } else if constexpr (f == landscape::rastrigin) {
+                a[k] = s::add(a[k], s::fnmadd(s::set1(10.0), cos_2pi_kernel(x), s::mul(x, x)));
+            } else if constexpr (f == landscape::rosenbrock) {
+                const auto x1 = s::add(x, s::set1(1.0));
+                const auto t = s::fnmadd(x1, x1, s::add(s::load(col + stride + k * s::width), s::set1(1.0)));
+                a[k] = s::fmadd(s::set1(100.0), s::mul(t, t), s::fmadd(x, x, a[k]));
+            } else if constexpr (f == landscape::ackley) {
+                a[k] = s::fmadd(x, x, a[k]);
+                b[k] = s::add(b[k], cos_2pi_kernel(x));
+            } else if constexpr (f == landscape::griewank) {
+                a[k] = s::fmadd(x, x, a[k]);
+                b[k] = s::mul(b[k], cos_2pi_kernel(s::mul(x, s::set1(turn))));
+            } else if constexpr (f == landscape::schwefel) {
+                const auto xs = s::add(x, s::set1(schwefel_x));
+                const auto turns = s::fmadd(s::sqrt(s::abs(xs)), s::set1(0.5 / std::numbers::pi), s::set1(-0.25));
+                a[k] = s::fmadd(xs, cos_2pi_kernel(turns), a[k]);
+            } else {
+                const auto w1 = s::mul(x, s::set1(0.25));
+                const auto w = s::add(w1, s::set1(1.0));
+                if (j == 0) a[k] = s::fnmadd(s::set1(0.5), cos_2pi_kernel(w), s::set1(0.5));
+                // 1 + 10 sin^2(pi w + 1) inside, 1 + sin^2(2 pi w) on the last axis.
+                const auto last = j + 1 == n_dim;
+                const auto c = cos_2pi_kernel(last ? s::add(w, w) : s::add(w, s::set1(std::numbers::inv_pi)));
+                const auto g = s::fnmadd(s::set1(last ? 0.5 : 5.0), c, s::set1(last ? 1.5 : 6.0));
+                a[k] = s::fmadd(s::mul(w1, w1), g, a[k]);
+            }
+        }
+    }
+    for (size_t k = 0; k * s::width < len; ++k) {
+        auto val = a[k];
+        if constexpr (f == landscape::rastrigin) {
+            val = s::add(a[k], s::set1(10.0 * n));
+        } else if constexpr (f == landscape::ackley) {
+            const auto exp1 = exp_kernel(s::mul(s::set1(-0.2), s::sqrt(s::mul(a[k], s::set1(1.0 / n)))));
+            const auto exp2 = exp_kernel(s::mul(b[k], s::set1(1.0 / n)));
+            val = s::sub(s::fnmadd(s::set1(20.0), exp1, s::set1(20 + std::numbers::e)), exp2);
+        } else if constexpr (f == landscape::griewank) {
+            val = s::sub(s::fmadd(a[k], s::set1(1.0 / 4000.0), s::set1(1.0)), b[k]);
+        } else if constexpr (f == landscape::schwefel) {
+            val = s::sub(s::set1(schwefel_f * n), a[k]);
+        }
+        s::store(out + k * s::width, val);
+    }
+}
+
+using block_kernel = void (*)(const double *, size_t, size_t, size_t, double *);
+
+constexpr std::array<block_kernel, 7> block_kernels{
+    block_values<landscape::sphere>, block_values<landscape::rastrigin>, block_values<landscape::rosenbrock>,
+    block_values<landscape::ackley>, block_values<landscape::griewank>, block_values<landscape::schwefel>,
+    block_values<landscape::levy>,
+};
+
+void objective::evaluate(population &pop) const {
+    const phase_timer timer(phase::evaluate);
+    profile_count(profile_counter::evaluations, pop.size());
+    const auto kernel = block_kernels[static_cast<size_t>(f)];
+    const auto fit = pop.fit().data();
+    const auto size = pop.padded_size();
+    if (!moved()) {
+        for (size_t i0 = 0; i0 < size; i0 += block) {
+            kernel(pop.col(0).data() + i0, size, n_dim, std::min(block, size - i0), fit + i0);
+        }
+        return;
+    }
+    // Members are moved a chunk at a time into z, one row per axis, which the kernels then read
+    // like population columns.
+    constexpr size_t chunk = 256;
+    matrix z(n_dim, std::min(chunk, size));
+    for (size_t i0 = 0; i0 < size; i0 += chunk) {
+        const auto len = std::min(chunk, size - i0);
+        if (rot.rows()) {
+            times_columns(rot, pop, i0, len, z);
+            for (size_t j = 0; j < n_dim; ++j) {
+                const auto row = &z(j, 0);
+                for (size_t c = 0; c < len; ++c) row[c] -= rot_x_opt[j];
+            }
+        } else {
+            for (size_t j = 0; j < n_dim; ++j) {
+                const auto x = pop.col(j).data() + i0;
+                const auto row = &z(j, 0);
+                for (size_t c = 0; c < len; ++c) row[c] = x[c] - x_opt[j];
+            }
+        }
+        for (size_t c0 = 0; c0 < len; c0 += block) {
+            kernel(&z(0, c0), z.padded_cols(), n_dim, std::min(block, len - c0), fit + i0 + c0);
+        }
+    }
+}
+#else
+void objective::evaluate(population &pop) const {
+    const phase_timer timer(phase::evaluate);
+    profile_count(profile_counter::evaluations, pop.size());
+    std::vector<double> x(pop.dim());
+    const auto fit = pop.fit();
+    for (size_t i = 0; i < pop.size(); ++i) {
+        pop.gather(i, x);
+        fit[i] = value(x);
+    }
+}
+#endif
+
+namespace {
+    // Rows of a Gaussian matrix, made orthonormal one after another by modified Gram-Schmidt.
+    matrix random_rotation(counter_rng rng, const size_t n) {
+        matrix r(n, n);
+        for (size_t i = 0; i < n; ++i) {
+            const auto row = r.row(i);
+            rng.fill_normal(row);
+            for (size_t k = 0; k < i; ++k) {
+                const auto prev = r.row(k);
+                const auto d = std::transform_reduce(row.begin(), row.end(), prev.begin(), 0.0);
+                for (size_t j = 0; j < n; ++j) row[j] -= d * prev[j];
+            }
+            const auto norm = std::sqrt(std::transform_reduce(row.begin(), row.end(), row.begin(), 0.0));
+            for (auto &v: row) v /= norm;
+        }
+        return r;
+    }
+}
+
+objective::objective(const problem &p, const size_t n_dim) : f(p.f), n_dim(n_dim) {
+    if (p.shift == 0.0 && !p.rotate) return;
+    // Streams of the instance: 0 for the optimum, 1 for the rotation.
+    const counter_rng draws(p.instance);
+    x_opt.resize(n_dim);
+    draws.split(0).fill_uniform(x_opt, -p.shift, p.shift);
+    if (!p.rotate) return;
+    rot = random_rotation(draws.split(1), n_dim);
+    rot_x_opt.resize(n_dim);
+    for (size_t i = 0; i < n_dim; ++i) {
+        const auto row = rot.row(i);
+        rot_x_opt[i] = std::transform_reduce(row.begin(), row.end(), x_opt.begin(), 0.0);
+    }
+}
+
+double objective::value(const std::span<const double> x) const {
+    if (!moved()) return value_of(f, x);
+    std::vector<double> z(n_dim);
+    for (size_t i = 0; i < n_dim; ++i) {
+        if (rot.rows()) {
+            const auto row = rot.row(i);
+            z[i] = std::transform_reduce(row.begin(), row.end(), x.begin(), 0.0) - rot_x_opt[i];
+        } else {
+            z[i] = x[i] - x_opt[i];
+        }
+    }
+    return value_of(f, z);
+}
+
+std::optional<problem> read_problem(const config &cfg, const problem &fallback) {
+    auto p = fallback;
+    if (!(cfg.read("function", p.f, landscape_names) && cfg.read("shift", p.shift) && cfg.read("rotate", p.rotate) &&
+          cfg.read("instance", p.instance))) {
+        return std::nullopt;
+    }
+    if (!(p.shift >= 0.0)) {
+        std::cerr << "The shift of a function must be at least 0." << std::endl;
+        return std::nullopt;
+    }
+    return p;
+}
@@ -0,0 +1,73 @@
+#ifndef OBJECTIVE_H
+#define OBJECTIVE_H
+
+#include "common.h"
+#include "config.h"
+#include "linalg.h"
+#include "population.h"
+
+// Benchmark functions in any dimension, each written so that its minimum is 0 at the origin:
+//   - sphere: sum z^2;
+//   - rastrigin: 10 D + sum (z^2 - 10 cos 2 pi z);
+//   - rosenbrock: sum 100 (x_{j+1} - x_j^2)^2 + (x_j - 1)^2 with x = z + 1;
+//   - ackley: -20 exp(-0.2 sqrt(sum z^2 / D)) - exp(sum cos 2 pi z / D) + 20 + e;
+//   - griewank: 1 + sum z^2 / 4000 - prod cos(z_j / sqrt j);
+//   - schwefel: 418.98... D - sum x sin sqrt|x| with x = z + 420.97..., whose minimum is 0 up to
+//     about 2e-12 per axis;
+//   - levy: sin^2(pi w_1) + sum (w_j - 1)^2 (1 + 10 sin^2(pi w_j + 1)) + (w_D - 1)^2 (1 + sin^2 2 pi w_D)
+//     over j < D, with w = 1 + z / 4.
+enum class landscape { sphere, rastrigin, rosenbrock, ackley, griewank, schwefel, levy };
+
+constexpr std::array<std::pair<std::string_view, landscape>, 7> landscape_names{{
+    {"sphere", landscape::sphere}, {"rastrigin", landscape::rastrigin}, {"rosenbrock", landscape::rosenbrock},
+    {"ackley", landscape::ackley}, {"griewank", landscape::griewank}, {"schwefel", landscape::schwefel},
+    {"levy", landscape::levy},
+}};
+
+// Which function a run minimises, from "function", and how it is moved, as in the BBOB suite:
+// z = R (x - x_opt). x_opt is drawn uniformly within shift of the origin on every axis, from
+// "shift", and R is a random rotation when "rotate" is set; both are drawn from "instance", so that
+// runs with the same instance see the same landscape.
+struct problem {
+    landscape f;
+    double shift = 0.0;
+    bool rotate = false;
+    uint64_t instance = 1;
+};
+
+// The settings over fallback; nullopt, with a message, when one is invalid.
+std::optional<problem> read_problem(const config &cfg, const problem &fallback);
+
+// A problem in n_dim dimensions, with its shift and rotation drawn. Evaluating is thread-safe.
+class objective {
+public:
+    objective(const problem &p, size_t n_dim);
+
+    // The value of every member of pop, written into its fitness column. Members are taken in
+    // blocks whose running sums stay in registers while every coordinate column streams through
+    // once. A moved problem first maps each chunk of up to 256 members to z, with the rotation as
+    // one blocked matrix product over the chunk. The kernels use AVX-512 or AVX2 when the target
+    // has them, with polynomial cos and exp; over 300 to 1000 uniform points at D = 1 to 1000, in
+    // [-5, 5], [-32.768, 32.768] for Ackley and [-500, 500] for Schwefel, their values were within
+    // a relative 6e-15 of value(), and within 6e-12 absolute for Schwefel, whose terms are up to
+    // 500 each.
+    void evaluate(population &pop) const;
+
+    // The value of a single point, through the scalar functions of the standard library.
+    [[nodiscard]] double value(std::span<const double> x) const;
+
+    [[nodiscard]] landscape function() const { return f; }
+    [[nodiscard]] size_t dim() const { return n_dim; }
+    [[nodiscard]] bool moved() const { return !x_opt.empty(); }
+
+private:
+    landscape f;
+    size_t n_dim;
+    // Empty when the problem is not moved, and rot when it is not rotated.
+    std::vector<double> x_opt;
+    matrix rot;
+    // rot x_opt, subtracted after the product so that x need not be shifted first.
+    std::vector<double> rot_x_opt;
+};
+
+#endif //OBJECTIVE_H
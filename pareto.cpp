@@ -0,0 +1,217 @@
+#include "pareto.h"
+
+namespace {
+    // Bits of x whose order as integers is the order of the values, with -0 as 0.
+    uint64_t sort_key(const double x) {
+        const auto bits = std::bit_cast<uint64_t>(x + 0.0);
+        return bits ^ ((0 - (bits >> 63)) | uint64_t{1} << 63);
+    }
+
+    double key_value(const uint64_t key) {
+        return std::bit_cast<double>(key ^ (((key >> 63) - 1) | uint64_t{1} << 63));
+    }
+
+    // How many of the first values of v pass, when those that pass come first: a binary search
+    // that steps by arithmetic rather than by a branch, which would mispredict at every other
+    // halving, as prefix_sum_wheel::pick does.
+    template<typename T, typename Pass>
+    size_t count_passing(const std::span<const T> v, const Pass &pass) {
+        if (v.empty()) return 0;
+        const T *base = v.data();
+        for (auto len = v.size(); len > 1; len -= len / 2) base += static_cast<size_t>(pass(base[len / 2])) * (len / 2);
+        return base - v.data() + pass(*base);
+    }
+}
+
+// LSD radix sort by 11-bit digits, which is stable, so that equal keys keep the order they were
+// added in, and skips the digits every key shares, such as most of the exponent. A comparison sort
+// takes few keys.
+void front_sorter::sort_keyed() {
+    constexpr size_t bits = 11, n_digit = 6, radix = size_t{1} << bits;
+    const auto n = keyed.size();
+    if (n < 256) {
+        std::ranges::stable_sort(keyed, {}, &std::pair<uint64_t, uint32_t>::first);
+        return;
+    }
+    count.assign(n_digit * radix, 0);
+    for (const auto &[key, i]: keyed) {
+        for (size_t d = 0; d < n_digit; ++d) ++count[d * radix + (key >> (d * bits) & (radix - 1))];
+    }
+    spare.resize(n);
+    for (size_t d = 0; d < n_digit; ++d) {
+        const auto c = std::span(count).subspan(d * radix, radix);
+        if (c[keyed[0].first >> (d * bits) & (radix - 1)] == n) continue;
+        std::exclusive_scan(c.begin(), c.end(), c.begin(), uint32_t{0});
+        for (const auto &e: keyed) spare[c[e.first >> (d * bits) & (radix - 1)]++] = e;
+        std::swap(keyed, spare);
+    }
+}
+
+void front_sorter::sort(const matrix &objs) {
+    const auto n_obj = objs.rows();
+    const auto n = objs.cols();
+    order.resize(n);
+    rank.resize(n);
+    // By the first objective alone, with the keys beside the indices rather than behind them, then
+    // runs of points level in it by the others.
+    keyed.clear();
+    for (size_t i = 0; i < n; ++i) keyed.emplace_back(n_obj ? sort_key(objs(0, i)) : 0, static_cast<uint32_t>(i));
+    sort_keyed();
+    for (size_t a = 0, b = 0; a < n; a = b) {
+        for (b = a + 1; b < n && keyed[b].first == keyed[a].first; ++b) {}
+        if (b - a < 2) continue;
+        std::sort(keyed.begin() + static_cast<ptrdiff_t>(a), keyed.begin() + static_cast<ptrdiff_t>(b),
+                  [&](const auto &p, const auto &q) {
+                      for (size_t r = 1; r < n_obj; ++r) {
+                          const auto x = objs(r, p.second), y = objs(r, q.second);
+                          if (x != y) return x < y;
+                      }
+                      return p.second < q.second;
+                  });
+    }
+    // The values of the points in that order, one point after another, so that placing them reads
+    // memory in order.
+    lined.resize(n * n_obj);
+    for (size_t at = 0; at < n; ++at) {
+        order[at] = keyed[at].second;
+        for (size_t r = 0; r < n_obj; ++r) lined[at * n_obj + r] = objs(r, order[at]);
+    }
+    const auto point = [&](const size_t at) { return std::span<const double>(lined).subspan(at * n_obj, n_obj); };
+    // The first front k that nothing of dominates, with the fronts not to be trusted beyond n_front.
+    size_t n_front = 0;
+    const auto search = [&](const auto &dominated_by) {
+        size_t lo = 0, hi = n_front;
+        while (lo < hi) {
+            const auto mid = lo + (hi - lo) / 2;
+            if (dominated_by(mid)) lo = mid + 1;
+            else hi = mid;
+        }
+        return lo;
+    };
+    least.clear();
+    for (size_t at = 0; at < n; ++at) {
+        const auto p = point(at);
+        if (at > 0 && std::ranges::equal(p, point(at - 1))) {
+            rank[order[at]] = rank[order[at - 1]];
+            continue;
+        }
+        size_t k = 0;
+        if (n_obj == 2) {
+            // The least second objectives rise from front to front.
+            k = count_passing(std::span<const double>(least), [&](const double v) { return v <= p[1]; });
+            if (k == least.size()) least.push_back(p[1]);
+            else least[k] = p[1];
+            n_front = least.size();
+        } else if (n_obj == 3) {
+            const step s{p[1], p[2]};
+            k = search([&](const size_t f) { return dominated_3(f, s); });
+            if (k == n_front) {
+                if (stairs.size() == n_front) stairs.emplace_back();
+                stairs[n_front++].clear();
+            }
+            place_3(k, s);
+        } else {
+            // From the member placed last, the closest in the first objective and so the likeliest
+            // to dominate p.
+            k = search([&](const size_t f) {
+                return std::any_of(placed[f].rbegin(), placed[f].rend(), [&](const uint32_t q) {
+                    return std::ranges::equal(point(q).subspan(1), p.subspan(1), std::less_equal{});
+                });
+            });
+            if (k == n_front) {
+                if (placed.size() == n_front) placed.emplace_back();
+                placed[n_front++].clear();
+            }
+            placed[k].push_back(static_cast<uint32_t>(at));
+        }
+        rank[order[at]] = static_cast<uint32_t>(k);
+    }
+
+    // Members grouped by front, each front in lexicographic order. Filling moves every start to
+    // the next, which the shift puts back.
+    start.assign(n_front + 1, 0);
+    for (const auto r: rank) ++start[r + 1];
+    std::partial_sum(start.begin(), start.end(), start.begin());
+    members.resize(n);
+    for (const auto i: order) members[start[rank[i]]++] = i;
+    std::copy_backward(start.begin(), start.end() - 1, start.end());
+    start[0] = 0;
+}
+
+// Points are placed in lexicographic order, so an earlier point other than p with no more in the
+// second and third objectives dominates it. The member of the staircase with the largest second
+// objective up to p's has the least third objective of those.
+bool front_sorter::dominated_3(const size_t k, const step p) const {
+    const auto s = std::span<const step>(stairs[k]);
+    const auto c = count_passing(s, [&](const step &q) { return q.f2 <= p.f2; });
+    return c > 0 && s[c - 1].f3 <= p.f3;
+}
+
+// The staircase keeps its second objectives rising and its third falling: p replaces the members
+// it beats in both, which follow one another from the first with a second objective of p's or more.
+void front_sorter::place_3(const size_t k, const step p) {
+    auto &s = stairs[k];
+    const auto lo = std::lower_bound(s.begin(), s.end(), p.f2, [](const step &q, const double v) { return q.f2 < v; });
+    auto hi = lo;
+    while (hi != s.end() && hi->f3 >= p.f3) ++hi;
+    if (lo == hi) {
+        s.insert(lo, p);
+    } else {
+        *lo = p;
+        s.erase(lo + 1, hi);
+    }
+}
+
+void front_sorter::crowd(const matrix &objs, const size_t k, const std::span<double> dist) {
+    const auto f = front(k);
+    constexpr auto inf = std::numeric_limits<double>::infinity();
+    for (const auto i: f) dist[i] = f.size() > 2 ? 0.0 : inf;
+    if (f.size() <= 2) return;
+    for (size_t r = 0; r < objs.rows(); ++r) {
+        keyed.clear();
+        for (const auto i: f) keyed.emplace_back(sort_key(objs(r, i)), i);
+        sort_keyed();
+        dist[keyed.front().second] = inf;
+        dist[keyed.back().second] = inf;
+        const auto range = key_value(keyed.back().first) - key_value(keyed.front().first);
+        if (range <= 0.0) continue;
+        for (size_t j = 1; j + 1 < keyed.size(); ++j) {
+            dist[keyed[j].second] += (key_value(keyed[j + 1].first) - key_value(keyed[j - 1].first)) / range;
+        }
+    }
+}
+
+bool dominates(const matrix &objs, const size_t a, const size_t b) {
+    bool better = false;
+    for (size_t r = 0; r < objs.rows(); ++r) {
+        if (objs(r, a) > objs(r, b)) return false;
+        better |= objs(r, a) < objs(r, b);
+    }
+    return better;
+}
+
+void naive_front_ranks(const matrix &objs, const std::span<uint32_t> rank) {
+    const auto n = objs.cols();
+    std::vector<uint32_t> count(n), cur, next;
+    for (size_t a = 0; a < n; ++a) {
+        for (size_t b = 0; b < n; ++b) count[b] += dominates(objs, a, b);
+    }
+    for (size_t i = 0; i < n; ++i) {
+        if (count[i] == 0) {
+            rank[i] = 0;
+            cur.push_back(static_cast<uint32_t>(i));
+        }
+    }
+    for (uint32_t k = 1; !cur.empty(); ++k) {
+        next.clear();
+        for (const auto p: cur) {
+            for (size_t q = 0; q < n; ++q) {
+                if (dominates(objs, p, q) && --count[q] == 0) {
+                    rank[q] = k;
+                    next.push_back(static_cast<uint32_t>(q));
+                }
+            }
+        }
+        std::swap(cur, next);
+    }
+}
\ No newline at end of file
@@ -0,0 +1,84 @@
+#ifndef PARETO_H
+#define PARETO_H
+
+#include "common.h"
+#include "linalg.h"
+
+// Pareto fronts under minimisation of a set of points stored one objective per row, so that the
+// points are the columns. A point dominates another when it is no worse in every objective and
+// better in one; front 0 holds the points nothing dominates, front k + 1 those only points of
+// fronts 0 to k dominate. Equal points share a front.
+//
+// The sorter keeps its storage between sorts, so sorting every generation allocates nothing once
+// the population stops growing.
+class front_sorter {
+public:
+    // Sorts the points lexicographically, by a radix sort on the first objective, after which only
+    // points before a point can dominate it, then places them in that order; the fronts a point is
+    // dominated by are always 0 to some k, so its own is found by a binary search over the fronts,
+    // each asking whether any member dominates it. The question costs (Jensen 2003, Zhang et al. 2015):
+    //   - with 2 objectives, one comparison with the least second objective of the front, for
+    //     O(N log N) in all;
+    //   - with 3, a binary search of the front's staircase, the members whose second and third
+    //     objectives no other member of the front beats in both, for O(N log^2 N) plus the upkeep
+    //     of the staircases;
+    //   - with more, a scan of the front's members from the last placed, as ENS-BS does, which is
+    //     O(M N^2) at worst but stops at the first member that dominates.
+    // Over 10^5 points, uniform in the unit cube or all on one front, a sort took 5 to 8 ms with 2
+    // objectives and 27 to 40 ms with 3; the naive sort took 1.5 to 2 s over 10^4.
+    void sort(const matrix &objs);
+
+    [[nodiscard]] size_t fronts() const { return start.size() - 1; }
+
+    // Members of front k, in lexicographic order.
+    [[nodiscard]] std::span<const uint32_t> front(const size_t k) const {
+        return std::span(members).subspan(start[k], start[k + 1] - start[k]);
+    }
+
+    // Front of every point.
+    [[nodiscard]] std::span<const uint32_t> ranks() const { return rank; }
+
+    // Crowding distance (Deb et al. 2002) of every member of front k, written into dist at its
+    // index: over each objective in turn, the members sorted by it add the gap between their two
+    // neighbours, over the range of the front. The two ends of every objective, and the members
+    // of fronts of up to two, get infinity.
+    void crowd(const matrix &objs, size_t k, std::span<double> dist);
+
+private:
+    // Second and third objectives of a member of a staircase.
+    struct step {
+        double f2;
+        double f3;
+    };
+
+    [[nodiscard]] bool dominated_3(size_t k, step p) const;
+    void place_3(size_t k, step p);
+    // Sorts keyed by key, keeping the order of equal keys.
+    void sort_keyed();
+
+    std::vector<uint32_t> order;
+    std::vector<double> lined;
+    std::vector<uint32_t> rank;
+    std::vector<uint32_t> members;
+    std::vector<uint32_t> start{0};
+    // Per front: the least second objective, with 2 objectives; the staircase, with 3; the places
+    // in lexicographic order of the members so far, with more.
+    std::vector<double> least;
+    std::vector<std::vector<step>> stairs;
+    std::vector<std::vector<uint32_t>> placed;
+    // Sort keys of one objective beside their points, with the buffers of the radix sort.
+    std::vector<std::pair<uint64_t, uint32_t>> keyed;
+    std::vector<std::pair<uint64_t, uint32_t>> spare;
+    std::vector<uint32_t> count;
+};
+
+// Whether point a of objs dominates point b.
+bool dominates(const matrix &objs, size_t a, size_t b);
+
+// Front of every point by counting, for each, the points that dominate it, then peeling the fronts
+// off one at a time as Deb et al. (2002) do, but finding the points each one dominates again
+// rather than keeping them: O(M N^2) time in O(N) space. The reference the sorter is checked and
+// timed against.
+void naive_front_ranks(const matrix &objs, std::span<uint32_t> rank);
+
+#endif //PARETO_H
\ No newline at end of file
@@ -0,0 +1,79 @@
+#ifndef POPULATION_H
+#define POPULATION_H
+
+#include "common.h"
+
+// Every column starts on a cache line, which is also the widest vector register.
+constexpr size_t column_align = 64;
+
+template<typename T>
+struct aligned_allocator {
+    using value_type = T;
+
+    aligned_allocator() = default;
+
+    template<typename U>
+    explicit aligned_allocator(const aligned_allocator<U> &) {}
+
+    T *allocate(size_t n) {
+        return static_cast<T *>(::operator new(n * sizeof(T), std::align_val_t{column_align}));
+    }
+
+    void deallocate(T *p, size_t) {
+        ::operator delete(p, std::align_val_t{column_align});
+    }
+
+    bool operator==(const aligned_allocator &) const = default;
+};
+
+template<typename T>
+using aligned_vector = std::vector<T, aligned_allocator<T>>;
+
+// Structure-of-arrays population: one contiguous column per dimension plus a fitness column,
+// all in one allocation. Columns are padded to a whole number of cache lines, and the padding is
+// zeroed, so vector kernels may run whole registers up to padded_size().
+class population {
+public:
+    population() = default;
+
+    population(const size_t n, const size_t n_dim)
+        : n(n), n_dim(n_dim), stride((n + lane - 1) / lane * lane), data(stride * (n_dim + 1)) {}
+
+    [[nodiscard]] size_t size() const { return n; }
+    [[nodiscard]] size_t dim() const { return n_dim; }
+    [[nodiscard]] size_t padded_size() const { return stride; }
+
+    std::span<double> col(const size_t j) { return {data.data() + j * stride, n}; }
+    [[nodiscard]] std::span<const double> col(const size_t j) const { return {data.data() + j * stride, n}; }
+
+    std::span<double> fit() { return col(n_dim); }
+    [[nodiscard]] std::span<const double> fit() const { return col(n_dim); }
+
+    // Copy the coordinates of member i into out, which must hold dim() values.
+    void gather(const size_t i, std::span<double> out) const {
+        for (size_t j = 0; j < n_dim; ++j) out[j] = data[j * stride + i];
+    }
+
+    // Overwrite the coordinates of member i with in, which must hold dim() values.
+    void scatter(const size_t i, std::span<const double> in) {
+        for (size_t j = 0; j < n_dim; ++j) data[j * stride + i] = in[j];
+    }
+
+private:
+    static constexpr size_t lane = column_align / sizeof(double);
+    size_t n = 0;
+    size_t n_dim = 0;
+    size_t stride = 0;
+    aligned_vector<double> data;
+};
+
+// Current and next generation; advancing swaps the two instead of copying.
+template<typename T>
+struct ping_pong {
+    T cur;
+    T next;
+
+    void flip() { std::swap(cur, next); }
+};
+
+#endif //POPULATION_H
@@ -0,0 +1,167 @@
+#include "profile.h"
+
+namespace {
+    // Figures of one thread. Only the owning thread stores into it, with plain relaxed
+    // read-modify-writes, while the report may read it at any time.
+    struct alignas(64) profile_slot {
+        std::array<std::atomic<uint64_t>, n_phase> ns{};
+        std::array<std::atomic<uint64_t>, n_phase> calls{};
+        std::array<std::atomic<uint64_t>, n_profile_counter> counts{};
+        std::atomic<bool> taken{true};
+        size_t thread = 0;
+        profile_slot *next = nullptr;
+    };
+
+    // Slots live until the process exits, so that threads which have finished still show in the
+    // report. A new thread takes over the slot of one that has finished, if any, so there are only
+    // ever as many slots as threads that were profiling at the same time.
+    std::atomic<profile_slot *> slots{nullptr};
+    std::atomic<size_t> n_slot{0};
+
+    profile_slot *claim_slot() {
+        for (auto s = slots.load(std::memory_order_acquire); s; s = s->next) {
+            if (!s->taken.load(std::memory_order_relaxed) && !s->taken.exchange(true, std::memory_order_acquire)) {
+                return s;
+            }
+        }
+        const auto s = new profile_slot;
+        s->thread = n_slot.fetch_add(1, std::memory_order_relaxed);
+        s->next = slots.load(std::memory_order_relaxed);
+        while (!slots.compare_exchange_weak(s->next, s, std::memory_order_release, std::memory_order_relaxed)) {}
+        return s;
+    }
+
+    struct slot_owner {
+        profile_slot *slot = claim_slot();
+
+        ~slot_owner() { slot->taken.store(false, std::memory_order_release); }
+    };
+
+    profile_slot &own_slot() {
+        thread_local slot_owner owner;
+        return *owner.slot;
+    }
+
+    void bump(std::atomic<uint64_t> &a, const uint64_t n) {
+        a.store(a.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+    // Figures of one slot, or summed over several.
+    struct profile_figures {
+        size_t thread;
+        std::array<uint64_t, n_phase> ns{};
+        std::array<uint64_t, n_phase> calls{};
+        std::array<uint64_t, n_profile_counter> counts{};
+
+        void add(const profile_figures &o) {
+            for (size_t k = 0; k < n_phase; ++k) ns[k] += o.ns[k], calls[k] += o.calls[k];
+            for (size_t k = 0; k < n_profile_counter; ++k) counts[k] += o.counts[k];
+        }
+    };
+
+    std::vector<profile_figures> collect() {
+        std::vector<profile_figures> out;
+        for (auto s = slots.load(std::memory_order_acquire); s; s = s->next) {
+            auto &f = out.emplace_back(profile_figures{s->thread});
+            for (size_t k = 0; k < n_phase; ++k) {
+                f.ns[k] = s->ns[k].load(std::memory_order_relaxed);
+                f.calls[k] = s->calls[k].load(std::memory_order_relaxed);
+            }
+            for (size_t k = 0; k < n_profile_counter; ++k) f.counts[k] = s->counts[k].load(std::memory_order_relaxed);
+        }
+        std::ranges::sort(out, {}, &profile_figures::thread);
+        return out;
+    }
+
+    void print_figures(std::ostream &os, const profile_figures &f) {
+        const auto total = std::reduce(f.ns.begin(), f.ns.end());
+        std::array<size_t, n_phase> order{};
+        std::iota(order.begin(), order.end(), 0);
+        std::ranges::stable_sort(order, std::greater{}, [&](const size_t k) { return f.ns[k]; });
+        char line[128];
+        std::snprintf(line, sizeof line, "  %8s  %7s  %12s  %12s  %s\n", "seconds", "share", "calls", "ns/call",
+                      "phase");
+        os << line;
+        for (const auto k: order) {
+            if (f.calls[k] == 0) continue;
+            std::snprintf(line, sizeof line, "  %8.4f  %6.2f%%  %12llu  %12.0f  %s\n",
+                          1e-9 * static_cast<double>(f.ns[k]),
+                          total ? 100.0 * static_cast<double>(f.ns[k]) / static_cast<double>(total) : 0.0,
+                          static_cast<unsigned long long>(f.calls[k]),
+                          static_cast<double>(f.ns[k]) / static_cast<double>(f.calls[k]), phase_names[k].data());
+            os << line;
+        }
+        for (size_t k = 0; k < n_profile_counter; ++k) {
+            if (f.counts[k] == 0) continue;
+            std::snprintf(line, sizeof line, "  %8s  %7s  %12llu  %12s  %s\n", "", "",
+                          static_cast<unsigned long long>(f.counts[k]), "", profile_counter_names[k].data());
+            os << line;
+        }
+    }
+}
+
+void profile_detail::add_time(const phase p, const uint64_t ns) {
+    auto &s = own_slot();
+    bump(s.ns[static_cast<size_t>(p)], ns);
+    bump(s.calls[static_cast<size_t>(p)], 1);
+}
+
+void profile_detail::add_count(const profile_counter c, const uint64_t n) {
+    bump(own_slot().counts[static_cast<size_t>(c)], n);
+}
+
+void profile_summary(std::ostream &os) {
+    if constexpr (!profiling) {
+        os << "Built without GENE01_PROFILE; there is no profile." << std::endl;
+        return;
+    }
+    const auto figures = collect();
+    profile_figures all{0};
+    for (const auto &f: figures) all.add(f);
+    os << "Profile, all threads:\n";
+    print_figures(os, all);
+    if (figures.size() > 1) {
+        for (const auto &f: figures) {
+            if (std::reduce(f.calls.begin(), f.calls.end()) == 0) continue;
+            os << "Thread " << f.thread << ":\n";
+            print_figures(os, f);
+        }
+    }
+    os << std::flush;
+}
+
+bool write_profile_json(const std::string &path) {
+    std::ofstream file(path);
+    file << "{\"threads\": [";
+    const auto figures = collect();
+    for (size_t i = 0; i < figures.size(); ++i) {
+        const auto &f = figures[i];
+        file << (i ? ",\n  " : "\n  ") << "{\"thread\": " << f.thread << ", \"phases\": {";
+        bool first = true;
+        for (size_t k = 0; k < n_phase; ++k) {
+            if (f.calls[k] == 0) continue;
+            file << (first ? "" : ", ") << '"' << phase_names[k] << "\": {\"ns\": " << f.ns[k] << ", \"calls\": "
+                << f.calls[k] << '}';
+            first = false;
+        }
+        file << "}, \"counters\": {";
+        for (size_t k = 0; k < n_profile_counter; ++k) {
+            file << (k ? ", " : "") << '"' << profile_counter_names[k] << "\": " << f.counts[k];
+        }
+        file << "}}";
+    }
+    file << "\n]}\n";
+    if (!file) {
+        std::cerr << "Failed to write " << path << "." << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void profile_reset() {
+    for (auto s = slots.load(std::memory_order_acquire); s; s = s->next) {
+        for (auto &a: s->ns) a.store(0, std::memory_order_relaxed);
+        for (auto &a: s->calls) a.store(0, std::memory_order_relaxed);
+        for (auto &a: s->counts) a.store(0, std::memory_order_relaxed);
+    }
+}
@@ -0,0 +1,134 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include "common.h"
+
+// Per-phase timers and counters for the engines, built in with -DGENE01_PROFILE=ON. Without it
+// every phase_timer and profile_count() is an empty inline and compiles to nothing.
+//
+// Each thread adds into its own slot, which only it ever writes, so timing and counting never
+// contend; the report sums the slots of every thread that has run a timer or counter. Time is
+// self time: a timer opened while another is open on the same thread pauses the outer one, so the
+// phases of a thread add up to the time spent under any timer.
+#ifdef GENE01_PROFILE
+constexpr bool profiling = true;
+#else
+constexpr bool profiling = false;
+#endif
+
+enum class phase : uint32_t {
+    // Setting up a run: the first population, distance matrices, heightmaps.
+    init,
+    // Choosing parents, donors or the elite.
+    select,
+    // Crossover, mutation, particle moves or sampling a model.
+    vary,
+    // Objective calls.
+    evaluate,
+    // Replacement, bests and model fits.
+    update,
+    // Ants building tours or paths.
+    construct,
+    local_search,
+    evaporate,
+    deposit,
+    // Recording and writing trajectories.
+    log,
+    // Blocked on other threads, at barriers, queues and the end of pool jobs.
+    wait,
+};
+
+constexpr size_t n_phase = 11;
+
+constexpr std::array<std::string_view, n_phase> phase_names{
+    "init", "select", "vary", "evaluate", "update", "construct", "local_search", "evaporate", "deposit", "log", "wait",
+};
+
+enum class profile_counter : uint32_t {
+    // Objective values computed.
+    evaluations,
+    // Complete ant tours or paths.
+    tours,
+    // Trajectory records kept.
+    records,
+};
+
+constexpr size_t n_profile_counter = 3;
+
+constexpr std::array<std::string_view, n_profile_counter> profile_counter_names{"evaluations", "tours", "records"};
+
+namespace profile_detail {
+    void add_time(phase p, uint64_t ns);
+    void add_count(profile_counter c, uint64_t n);
+}
+
+// Times its scope as phase p on the calling thread, or as the phases it is switched through.
+class phase_timer {
+public:
+    explicit phase_timer(const phase p) {
+        if constexpr (profiling) {
+            this->p = p;
+            outer = open;
+            open = this;
+            start = std::chrono::steady_clock::now();
+        }
+    }
+
+    ~phase_timer() {
+        if constexpr (profiling) {
+            const auto ns = close(std::chrono::steady_clock::now());
+            if (outer) outer->inner_ns += ns;
+            open = outer;
+        }
+    }
+
+    phase_timer(const phase_timer &) = delete;
+    phase_timer &operator=(const phase_timer &) = delete;
+
+    // End the current phase and time the rest of the scope, up to the next switch, as phase next.
+    void switch_to(const phase next) {
+        if constexpr (profiling) {
+            const auto now = std::chrono::steady_clock::now();
+            const auto ns = close(now);
+            if (outer) outer->inner_ns += ns;
+            p = next;
+            inner_ns = 0;
+            start = now;
+        }
+    }
+
+private:
+    // Adds the self time of the current phase and returns its whole time.
+    uint64_t close(const std::chrono::steady_clock::time_point now) const {
+        const auto ns = static_cast<uint64_t>(std::chrono::nanoseconds(now - start).count());
+        profile_detail::add_time(p, ns - inner_ns);
+        return ns;
+    }
+
+    inline static thread_local phase_timer *open = nullptr;
+    phase p{};
+    phase_timer *outer = nullptr;
+    uint64_t inner_ns = 0;
+    std::chrono::steady_clock::time_point start;
+};
+
+inline void profile_count(const profile_counter c, const uint64_t n = 1) {
+    if constexpr (profiling) profile_detail::add_count(c, n);
+}
+
+// Perf-style table of the time, share, calls and time per call of every phase, with the counters,
+// for all threads together and then for each thread. Says so when built without GENE01_PROFILE.
+void profile_summary(std::ostream &os);
+
+// The same figures as JSON:
+//
+//   {"threads": [{"thread": 0, "phases": {"evaluate": {"ns": ..., "calls": ...}, ...},
+//                 "counters": {"evaluations": ..., ...}}, ...]}
+//
+// False, with a message, when the file cannot be written.
+bool write_profile_json(const std::string &path);
+
+// Zero every slot. Only meant for when no timer is running on any thread, e.g. between runs.
+void profile_reset();
+
+#endif //PROFILE_H
@@ -1,80 +1,483 @@
 #include "common.h"
+#include "bench.h"
+#include "checkpoint.h"
+#include "engines.h"
+#include "objective.h"
+#include "population.h"
+#include "profile.h"
+#include "rng.h"
+#include "termination.h"
+#include "trajectory.h"
 
-using value = std::array<double, 2>;
-using value_in = const value &;
+void forward(std::span<double> x, std::span<const double> v) {
+    for (size_t i = 0; i < x.size(); ++i) x[i] += v[i];
+}
 
-double criterion(value_in x) {
-    return std::pow(x[0], 2) + std::pow(x[1], 2);
+void update(
+    std::span<double> v, std::span<const double> x, std::span<const double> p_best, const double g_best,
+    const double w, const double c1, const double c2, std::span<const double> r1, std::span<const double> r2) {
+    for (size_t i = 0; i < v.size(); ++i) {
+        v[i] = w * v[i] + c1 * r1[i] * (p_best[i] - x[i]) + c2 * r2[i] * (g_best - x[i]);
+    }
 }
 
-value forward(value_in x, value_in v) {
-    return {x[0] + v[0], x[1] + v[1]};
+// Keep in p_best every member of x that improved on it.
+void remember(population &p_best, const population &x) {
+    const auto fit = x.fit();
+    const auto p_fit = p_best.fit();
+    for (size_t j = 0; j <= x.dim(); ++j) {
+        const auto src = x.col(j);
+        const auto dst = p_best.col(j);
+        for (size_t i = 0; i < x.size(); ++i) dst[i] = fit[i] < p_fit[i] ? src[i] : dst[i];
+    }
 }
 
-value update(
-    value_in v, value_in x, value_in p_best, value_in g_best,
-    const double w, const double c1, const double c2, const double r1, const double r2) {
-    return {
-        w * v[0] + c1 * r1 * (p_best[0] - x[0]) + c2 * r2 * (g_best[0] - x[0]),
-        w * v[1] + c1 * r1 * (p_best[1] - x[1]) + c2 * r2 * (g_best[1] - x[1])
+struct pso_coef {
+    double w;
+    double c1;
+    double c2;
+};
+
+// A whole swarm as a checkpoint keeps it, every particle in index order, so that a run can be
+// resumed with any number of shares.
+struct swarm_state {
+    population x;
+    population v;
+    population p_best;
+    uint64_t n_step = 0;
+
+    swarm_state(const size_t n, const size_t n_dim) : x(n, n_dim), v(n, n_dim), p_best(n, n_dim) {}
+
+    void save(snapshot &out) const {
+        out.put(x);
+        out.put(v);
+        out.put(p_best);
+        out.put(n_step);
+    }
+
+    void restore(snapshot_reader &in) {
+        in.get(x);
+        in.get(v);
+        in.get(p_best);
+        in.get(n_step);
+    }
+};
+
+// Particles first, first + 1, ... of a swarm, with their velocities and personal bests, all stored
+// as columns. Every draw is taken at the particle's index in a stream of the swarm's rng, so a
+// swarm split into shares moves exactly as it would in one piece.
+struct particle_swarm {
+    population x;
+    population v;
+    population p_best;
+    std::vector<double> r1;
+    std::vector<double> r2;
+
+    // fn must outlive the swarm.
+    particle_swarm(const counter_rng &rng, const size_t first, const size_t n, const size_t n_dim, const double bound,
+                   const objective &fn)
+        : x(n, n_dim), v(n, n_dim), r1(n), r2(n), fn(fn), rng(rng), first(first) {
+        const phase_timer timer(phase::init);
+        for (size_t j = 0; j < n_dim; ++j) {
+            rng.split(position_stream).split(j).fill_uniform_at(first, x.col(j), -bound, bound);
+            rng.split(velocity_stream).split(j).fill_uniform_at(first, v.col(j), -2 * bound, 2 * bound);
+        }
+        fn.evaluate(x);
+        p_best = x;
+    }
+
+    void step(std::span<const double> g_best, const pso_coef &coef) {
+        phase_timer timer(phase::vary);
+        const auto draws = rng.split(step_stream + n_step++);
+        draws.split(0).fill_uniform_at(first, r1);
+        draws.split(1).fill_uniform_at(first, r2);
+        for (size_t j = 0; j < x.dim(); ++j) {
+            update(v.col(j), x.col(j), p_best.col(j), g_best[j], coef.w, coef.c1, coef.c2, r1, r2);
+            forward(x.col(j), v.col(j));
+        }
+        fn.evaluate(x);
+        timer.switch_to(phase::update);
+        remember(p_best, x);
+    }
+
+    // Copy the share into the whole swarm, or take it back out.
+    void store(swarm_state &whole) const {
+        for (size_t j = 0; j <= x.dim(); ++j) {
+            std::ranges::copy(x.col(j), whole.x.col(j).begin() + first);
+            std::ranges::copy(v.col(j), whole.v.col(j).begin() + first);
+            std::ranges::copy(p_best.col(j), whole.p_best.col(j).begin() + first);
+        }
+        whole.n_step = n_step;
+    }
+
+    void load(const swarm_state &whole) {
+        const auto n = x.size();
+        for (size_t j = 0; j <= x.dim(); ++j) {
+            std::ranges::copy(whole.x.col(j).subspan(first, n), x.col(j).begin());
+            std::ranges::copy(whole.v.col(j).subspan(first, n), v.col(j).begin());
+            std::ranges::copy(whole.p_best.col(j).subspan(first, n), p_best.col(j).begin());
+        }
+        n_step = whole.n_step;
+    }
+
+    // Index of the best personal best.
+    [[nodiscard]] size_t best() const {
+        const auto fit = p_best.fit();
+        return static_cast<size_t>(std::ranges::min_element(fit) - fit.begin());
+    }
+
+private:
+    static constexpr uint64_t position_stream = 0;
+    static constexpr uint64_t velocity_stream = 1;
+    // Followed by one stream per step.
+    static constexpr uint64_t step_stream = 2;
+    const objective &fn;
+    counter_rng rng;
+    size_t first;
+    uint64_t n_step = 0;
+};
+
+enum class pso_mode { synchronous, asynchronous };
+
+constexpr std::array<std::pair<std::string_view, pso_mode>, 2> pso_mode_names{{
+    {"synchronous", pso_mode::synchronous}, {"asynchronous", pso_mode::asynchronous},
+}};
+
+struct pso_params {
+    size_t n_particle;
+    size_t n_dim;
+    size_t n_epoch;
+    double bound;
+    pso_coef coef;
+    size_t n_thread;
+    pso_mode mode;
+    uint64_t seed;
+    problem fn{landscape::sphere};
+};
+
+// Single swarm that logs every particle; threads and mode are not used.
+std::optional<run_summary> demo_pso(const pso_params &params, const std::string &log_name, const sampling policy = {},
+                                    const checkpointing &ck = {}, const stopping &crit = {}) {
+    const auto n_dim = params.n_dim;
+    const objective fn(params.fn, n_dim);
+    particle_swarm swarm(counter_rng(params.seed), 0, params.n_particle, n_dim, params.bound, fn);
+    swarm_state whole(params.n_particle, n_dim);
+    convergence watch(crit);
+    size_t first = 0;
+    if (ck.resume) {
+        auto in = ck.resume->state();
+        whole.restore(in);
+        watch.restore(in);
+        if (!ck.restored(in)) return std::nullopt;
+        swarm.load(whole);
+        first = ck.resume->epoch();
+    }
+    const auto width = static_cast<uint32_t>(n_dim + 1);
+    trajectory_writer log(log_name, {trajectory_layout::population, width, static_cast<uint32_t>(params.n_particle), width},
+                          policy, ck.resume ? ck.resume->records() : 0);
+    checkpoint_writer saver(ck, log);
+    std::vector<double> g_best(n_dim);
+    double g_best_val;
+    const auto find_g_best = [&] {
+        const auto i = swarm.best();
+        swarm.p_best.gather(i, g_best);
+        g_best_val = swarm.p_best.fit()[i];
     };
+    find_g_best();
+    const auto spread = [&] {
+        spread_sum sum(n_dim);
+        sum.add(swarm.x);
+        return sum.value();
+    };
+    auto stop = stop_reason::epochs;
+    auto n_epoch = params.n_epoch;
+    for (size_t epoch = first; epoch < params.n_epoch; ++epoch) {
+        if (saver.due(epoch)) {
+            snapshot out;
+            swarm.store(whole);
+            whole.save(out);
+            watch.save(out);
+            saver.save(epoch, std::move(out));
+        }
+        swarm.step(g_best, params.coef);
+        phase_timer timer(phase::update);
+        find_g_best();
+        const auto why = watch.check(g_best_val, params.n_particle * (epoch + 2), spread);
+        timer.switch_to(phase::log);
+        if (const auto rec = log.record(epoch); !rec.empty()) {
+            auto out = std::ranges::copy(g_best, rec.begin()).out;
+            *out++ = g_best_val;
+            for (size_t j = 0; j <= n_dim; ++j) out = std::ranges::copy(swarm.x.col(j), out).out;
+        }
+        if (why) {
+            stop = *why;
+            n_epoch = epoch + 1;
+            break;
+        }
+    }
+    return run_summary{g_best_val, params.n_particle * (n_epoch + 1), stop};
 }
 
-struct particle {
-    value x;
-    value v;
-    value p_best;
-    double p_best_val;
+// Global best shared by threads without locks. Every thread publishes into its own slot, guarded
+// by a sequence counter as only that thread writes it, then swings the versioned head to the
+// slot. Readers follow the head and only retry while the slot's owner is in the middle of a write.
+class best_board {
+public:
+    best_board(const size_t n_thread, const size_t n_dim) : n_dim(n_dim), slots(n_thread) {
+        for (auto &s: slots) s.x = std::make_unique<std::atomic<double>[]>(n_dim);
+    }
+
+    double read(std::span<double> out) const {
+        for (;;) {
+            const auto &s = slots[owner(head.load(std::memory_order_acquire))];
+            const auto seq = s.seq.load(std::memory_order_acquire);
+            if (seq % 2 == 1) continue;
+            for (size_t j = 0; j < n_dim; ++j) out[j] = s.x[j].load(std::memory_order_relaxed);
+            const auto fit = s.fit.load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (s.seq.load(std::memory_order_relaxed) == seq) return fit;
+        }
+    }
+
+    // Offer a candidate; it is only taken while it is better than the published best.
+    void publish(const size_t thread, std::span<const double> x, const double fit) {
+        auto h = head.load(std::memory_order_acquire);
+        if (fit >= slots[owner(h)].fit.load(std::memory_order_relaxed)) return;
+        auto &s = slots[thread];
+        const auto seq = s.seq.load(std::memory_order_relaxed);
+        s.seq.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        for (size_t j = 0; j < n_dim; ++j) s.x[j].store(x[j], std::memory_order_relaxed);
+        s.fit.store(fit, std::memory_order_relaxed);
+        s.seq.store(seq + 2, std::memory_order_release);
+        const auto mine = [&](const uint64_t cur) { return ((cur >> owner_bits) + 1) << owner_bits | thread; };
+        while (!head.compare_exchange_weak(h, mine(h), std::memory_order_acq_rel)) {
+            if (fit >= slots[owner(h)].fit.load(std::memory_order_relaxed)) return;
+        }
+    }
+
+    [[nodiscard]] uint64_t version() const { return head.load(std::memory_order_relaxed) >> owner_bits; }
+
+private:
+    static constexpr int owner_bits = 16;
+
+    struct alignas(64) slot {
+        std::atomic<uint64_t> seq{0};
+        std::atomic<double> fit{std::numeric_limits<double>::max()};
+        std::unique_ptr<std::atomic<double>[]> x;
+    };
+
+    static size_t owner(const uint64_t h) { return h & ((1u << owner_bits) - 1); }
+
+    size_t n_dim;
+    std::vector<slot> slots;
+    alignas(64) std::atomic<uint64_t> head{0};
+};
+
+struct pso_result {
+    std::vector<double> g_best;
+    double g_best_val;
+    // Best value known to thread 0 after each of its iterations.
+    std::vector<double> history;
+    // Epochs run, fewer than n_epoch when a stopping criterion ended the run.
+    size_t n_epoch = 0;
+    stop_reason stop = stop_reason::epochs;
 };
 
-template<size_t n_particle, size_t n_epoch, double bound, double w, double c1, double c2>
-void demo_pso(const std::string &log_name) {
-    static_assert(bound >= 0.0);
-    std::ofstream log_file;
-    log_file.open(log_name);
-    // NOLINTNEXTLINE(*-msc51-cpp) I deliberately want predictable results.
-    std::mt19937 engine;
-    std::uniform_real_distribution dx(-bound, bound);
-    std::uniform_real_distribution dv(-2 * bound, 2 * bound);
-    std::uniform_real_distribution<> dr;
-    std::vector<particle> swarm;
-    value g_best;
-    auto g_best_val = std::numeric_limits<double>::max();
-    for (size_t i = 0; i < n_particle; ++i) {
-        const auto x = value {dx(engine), dx(engine)};
-        const auto x_val = criterion(x);
-        if (x_val < g_best_val) {
-            g_best = x;
-            g_best_val = x_val;
+// Parallel PSO: each thread owns a contiguous share of the swarm. In synchronous mode the threads
+// meet at a barrier after every iteration, where the shares' bests are reduced into the global
+// best; as draws go by particle index, the result is then the same for any number of threads. In
+// asynchronous mode they never wait for each other and exchange the global best through a
+// best_board instead.
+//
+// Only synchronous runs take checkpoints and check stopping criteria, in the barrier completion,
+// where every share is at the same epoch.
+std::optional<pso_result> parallel_pso(const pso_params &params, const checkpointing &ck = {},
+                                       const stopping &crit = {}) {
+    assert(params.n_thread > 0 && params.n_thread < (1u << 16) && params.n_particle >= params.n_thread);
+    assert((!ck.enabled() && !crit.any()) || params.mode == pso_mode::synchronous);
+    const auto n_thread = params.n_thread;
+    const auto n_dim = params.n_dim;
+    pso_result result{std::vector<double>(n_dim), 0.0, std::vector<double>(params.n_epoch), params.n_epoch};
+    // Synchronous mode state: every share's best, reduced when the barrier completes.
+    std::vector<std::vector<double>> local_best(n_thread, std::vector<double>(n_dim));
+    std::vector<double> local_best_val(n_thread);
+    std::vector<double> g_best(n_dim);
+    double g_best_val = std::numeric_limits<double>::max();
+    trajectory_writer no_log("", {trajectory_layout::population, 0, 0, 0});
+    checkpoint_writer saver(ck, no_log);
+    std::optional<swarm_state> whole;
+    if (ck.enabled()) whole.emplace(params.n_particle, n_dim);
+    std::vector<particle_swarm *> shares(n_thread);
+    const objective fn(params.fn, n_dim);
+    convergence watch(crit);
+    size_t first = 0;
+    if (ck.resume) {
+        auto in = ck.resume->state();
+        whole->restore(in);
+        in.get(std::span(g_best));
+        in.get(g_best_val);
+        watch.restore(in);
+        if (!ck.restored(in)) return std::nullopt;
+        first = ck.resume->epoch();
+    }
+    const auto spread = [&] {
+        spread_sum sum(n_dim);
+        for (const auto share: shares) sum.add(share->x);
+        return sum.value();
+    };
+    // The epoch the threads go on to once the barrier completes; the first completion starts the
+    // run. Set halt ends it after the current epoch.
+    size_t next_epoch = first;
+    bool begun = false;
+    bool halt = false;
+    const auto reduce = [&]() noexcept {
+        const auto t = static_cast<size_t>(std::ranges::min_element(local_best_val) - local_best_val.begin());
+        if (local_best_val[t] < g_best_val) {
+            g_best = local_best[t];
+            g_best_val = local_best_val[t];
         }
-        const auto v = value {dv(engine), dv(engine)};
-        swarm.push_back(particle {x , v, x, x_val});
-    }
-    for (size_t epoch = 0; epoch < n_epoch; ++epoch) {
-        for (size_t i = 0; i < n_particle; ++i) {
-            const auto r1 = dr(engine);
-            const auto r2 = dr(engine);
-            swarm[i].v = update(swarm[i].v, swarm[i].x, swarm[i].p_best, g_best, w, c1, c2, r1, r2);
-            swarm[i].x = forward(swarm[i].x, swarm[i].v);
-            if (const auto val = criterion(swarm[i].x); val < swarm[i].p_best_val) {
-                swarm[i].p_best = swarm[i].x;
-                swarm[i].p_best_val = val;
-                if (val < g_best_val) {
-                    g_best = swarm[i].x;
-                    g_best_val = val;
-                }
+        if (begun) {
+            ++next_epoch;
+            if (const auto why = watch.check(g_best_val, params.n_particle * (next_epoch + 1), spread)) {
+                halt = true;
+                result.stop = *why;
+                result.n_epoch = next_epoch;
+                return;
             }
         }
-        log_file << g_best[0] << " " << g_best[1] << g_best_val;
-        for (const auto &p : swarm) {
-            log_file << " " << p.x[0] << " " << p.x[1] << " " << criterion(p.x);
+        begun = true;
+        if (next_epoch < params.n_epoch && saver.due(next_epoch)) {
+            snapshot out;
+            for (const auto share: shares) share->store(*whole);
+            whole->save(out);
+            out.put(std::span(g_best));
+            out.put(g_best_val);
+            watch.save(out);
+            saver.save(next_epoch, std::move(out));
         }
-        log_file << std::endl;
+    };
+    std::barrier sync(static_cast<ptrdiff_t>(n_thread), reduce);
+    // Asynchronous mode state.
+    best_board board(n_thread, n_dim);
+    std::latch published(static_cast<ptrdiff_t>(n_thread));
+    {
+        std::vector<std::jthread> workers;
+        for (size_t t = 0; t < n_thread; ++t) {
+            workers.emplace_back([&, t] {
+                const auto lo = params.n_particle * t / n_thread;
+                const auto hi = params.n_particle * (t + 1) / n_thread;
+                particle_swarm swarm(counter_rng(params.seed), lo, hi - lo, n_dim, params.bound, fn);
+                if (ck.resume) swarm.load(*whole);
+                shares[t] = &swarm;
+                std::vector<double> view(n_dim);
+                const auto share_best = [&] {
+                    const phase_timer timer(phase::update);
+                    const auto i = swarm.best();
+                    swarm.p_best.gather(i, local_best[t]);
+                    local_best_val[t] = swarm.p_best.fit()[i];
+                };
+                share_best();
+                if (params.mode == pso_mode::synchronous) {
+                    sync.arrive_and_wait();
+                    for (size_t epoch = first; epoch < params.n_epoch; ++epoch) {
+                        swarm.step(g_best, params.coef);
+                        share_best();
+                        {
+                            const phase_timer timer(phase::wait);
+                            sync.arrive_and_wait();
+                        }
+                        if (t == 0) result.history[epoch] = g_best_val;
+                        if (halt) break;
+                    }
+                } else {
+                    board.publish(t, local_best[t], local_best_val[t]);
+                    published.arrive_and_wait();
+                    for (size_t epoch = 0; epoch < params.n_epoch; ++epoch) {
+                        const auto known = board.read(view);
+                        swarm.step(view, params.coef);
+                        share_best();
+                        if (local_best_val[t] < known) board.publish(t, local_best[t], local_best_val[t]);
+                        if (t == 0) result.history[epoch] = std::min(known, local_best_val[t]);
+                    }
+                }
+            });
+        }
+    }
+    if (params.mode == pso_mode::synchronous) {
+        result.g_best = g_best;
+        result.g_best_val = g_best_val;
+    } else {
+        result.g_best_val = board.read(result.g_best);
+    }
+    return result;
+}
+
+// With a log, the single logged swarm of demo_pso, which warns of threads and mode going unused;
+// otherwise parallel_pso.
+std::optional<run_summary> run_pso(const config &cfg) {
+    pso_params p{50, 2, 100, 10.0, {0.5, 0.25, 0.25}, 1, pso_mode::synchronous, 0};
+    std::string log_name;
+    sampling policy;
+    if (!(cfg.read("n_particle", p.n_particle) && cfg.read("n_dim", p.n_dim) && cfg.read("n_epoch", p.n_epoch) &&
+          cfg.read("bound", p.bound) && cfg.read("w", p.coef.w) && cfg.read("c1", p.coef.c1) &&
+          cfg.read("c2", p.coef.c2) && cfg.read("threads", p.n_thread) && cfg.read("mode", p.mode, pso_mode_names) &&
+          cfg.read("seed", p.seed) && cfg.read("log", log_name) && cfg.read("log_every", policy.every))) {
+        return std::nullopt;
+    }
+    if (p.n_dim == 0 || p.bound < 0.0 || p.n_thread == 0 || p.n_particle < p.n_thread || p.n_thread >= (1u << 16)) {
+        std::cerr << "PSO needs n_dim >= 1, bound >= 0, and between 1 and 65535 threads, no more than particles."
+            << std::endl;
+        return std::nullopt;
+    }
+    const auto fn = read_problem(cfg, p.fn);
+    const auto ck = read_checkpointing(cfg);
+    const auto crit = read_stopping(cfg);
+    const auto again = read_restarts(cfg);
+    if (!(fn && ck && crit && again)) return std::nullopt;
+    p.fn = *fn;
+    if (log_name.empty() && p.mode == pso_mode::asynchronous && (ck->enabled() || crit->any())) {
+        std::cerr << "Asynchronous PSO cannot be checkpointed or stopped early." << std::endl;
+        return std::nullopt;
     }
-    log_file.close();
+    if (!log_name.empty() && (p.n_thread > 1 || p.mode == pso_mode::asynchronous)) {
+        std::cerr << "A logged PSO run uses one synchronous swarm on one thread; threads and mode are ignored."
+            << std::endl;
+    }
+    const auto one_run = [&](const size_t n, const uint64_t seed, const stopping &left,
+                             const size_t index) -> std::optional<run_summary> {
+        auto q = p;
+        q.n_particle = n;
+        q.seed = seed;
+        if (!log_name.empty()) return demo_pso(q, restart_log_name(log_name, index), policy, *ck, left);
+        const auto result = parallel_pso(q, *ck, left);
+        if (!result) return std::nullopt;
+        return run_summary{result->g_best_val, q.n_particle * (result->n_epoch + 1), result->stop};
+    };
+    return run_restarts(*again, *crit, p.n_particle, p.seed, one_run);
 }
 
 void main_pso() {
     std::cout << "--> Particle Swarm Optimization" << std::endl;
-    demo_pso<50, 100, 10.0, 0.5, 0.25, 0.25>("pso.log");
+    demo_pso({50, 2, 100, 10.0, {0.5, 0.25, 0.25}, 1, pso_mode::synchronous, 0}, "pso.trj");
+}
+
+// Throughput and convergence of the two parallel modes on a large swarm.
+void bench_pso(bench_report &report) {
+    const auto hw = std::max(1u, std::thread::hardware_concurrency());
+    for (const auto mode: {pso_mode::synchronous, pso_mode::asynchronous}) {
+        for (const size_t n_thread: {size_t{1}, static_cast<size_t>(hw)}) {
+            const pso_params params{1 << 18, 10, 50, 10.0, {0.5, 0.25, 0.25}, n_thread, mode, 0};
+            const auto begin = std::chrono::steady_clock::now();
+            const auto result = *parallel_pso(params);
+            const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - begin;
+            const auto updates = static_cast<double>(params.n_particle * params.n_epoch);
+            report.add({"pso", mode == pso_mode::synchronous ? "sync" : "async",
+                        {{"threads", n_thread}, {"particles", params.n_particle}, {"dims", params.n_dim},
+                         {"epochs", params.n_epoch}},
+                        {{"seconds", elapsed.count()}, {"particle_updates_per_s", updates / elapsed.count()},
+                         {"best", result.g_best_val}}});
+            if (n_thread == hw) break;
+        }
+    }
 }
@@ -0,0 +1,196 @@
+#include "rng.h"
+#include "lane_math.h"
+
+namespace {
+    constexpr uint64_t philox_m0 = 0xD2511F53;
+    constexpr uint64_t philox_m1 = 0xCD9E8D57;
+    constexpr uint32_t philox_w0 = 0x9E3779B9;
+    constexpr uint32_t philox_w1 = 0xBB67AE85;
+
+    // Blocks computed together by the bulk fills.
+    constexpr size_t philox_lanes = 16;
+
+    // Words of philox_lanes consecutive blocks, word r of lane l at w[r][l].
+    struct philox_batch {
+        alignas(64) uint32_t w[4][philox_lanes];
+
+        uint64_t bits64(const size_t half, const size_t l) const {
+            return w[2 * half][l] | static_cast<uint64_t>(w[2 * half + 1][l]) << 32;
+        }
+    };
+
+    void philox(philox_batch &out, const std::array<uint32_t, 2> &key, const uint64_t stream, const uint64_t first) {
+        auto &c = out.w;
+        for (size_t l = 0; l < philox_lanes; ++l) {
+            c[0][l] = static_cast<uint32_t>(first + l);
+            c[1][l] = static_cast<uint32_t>((first + l) >> 32);
+            c[2][l] = static_cast<uint32_t>(stream);
+            c[3][l] = static_cast<uint32_t>(stream >> 32);
+        }
+        auto k0 = key[0], k1 = key[1];
+        for (int r = 0; r < 10; ++r, k0 += philox_w0, k1 += philox_w1) {
+            for (size_t l = 0; l < philox_lanes; ++l) {
+                const auto p0 = philox_m0 * c[0][l];
+                const auto p1 = philox_m1 * c[2][l];
+                const auto c1 = c[1][l], c3 = c[3][l];
+                c[0][l] = static_cast<uint32_t>(p1 >> 32) ^ c1 ^ k0;
+                c[1][l] = static_cast<uint32_t>(p1);
+                c[2][l] = static_cast<uint32_t>(p0 >> 32) ^ c3 ^ k1;
+                c[3][l] = static_cast<uint32_t>(p0);
+            }
+        }
+    }
+
+    // Single block, for scalar draws and splitting.
+    std::array<uint32_t, 4> philox(const std::array<uint32_t, 2> &key, const std::array<uint32_t, 4> &ctr) {
+        auto c = ctr;
+        auto k0 = key[0], k1 = key[1];
+        for (int r = 0; r < 10; ++r, k0 += philox_w0, k1 += philox_w1) {
+            const auto p0 = philox_m0 * c[0];
+            const auto p1 = philox_m1 * c[2];
+            c = {
+                static_cast<uint32_t>(p1 >> 32) ^ c[1] ^ k0, static_cast<uint32_t>(p1),
+                static_cast<uint32_t>(p0 >> 32) ^ c[3] ^ k1, static_cast<uint32_t>(p0)
+            };
+        }
+        return c;
+    }
+
+    double unit(const uint64_t bits) {
+        return static_cast<double>(bits >> 11) * 0x1p-53;
+    }
+
+    // Box-Muller for a batch: r = sqrt(-2 log(1 - u1)) and theta = 2 pi u2 give the deviates
+    // r cos(theta) and r sin(theta). Each step loops over the lanes, so it vectorises without
+    // calls into libm.
+    //
+    // log as in log_lanes. cos and sin: u2 = q / 4 + t with |t| <= 1/8 is reduced exactly, leaving
+    // Taylor polynomials on [-pi/4, pi/4] and a quadrant swap.
+    void box_muller(const philox_batch &b, double (&z)[2 * philox_lanes]) {
+        // 1 - u1 lies in [2^-53, 1], so the logarithm stays finite.
+        alignas(64) double x[philox_lanes], log[philox_lanes], t[philox_lanes];
+        for (size_t l = 0; l < philox_lanes; ++l) x[l] = 1.0 - unit(b.bits64(0, l));
+        log_lanes(x, log);
+        alignas(64) double r[philox_lanes], q[philox_lanes], a2[philox_lanes], ps[philox_lanes], pc[philox_lanes];
+        for (size_t l = 0; l < philox_lanes; ++l) {
+            r[l] = std::sqrt(-2.0 * log[l]);
+            const auto u = unit(b.bits64(1, l));
+            q[l] = std::nearbyint(4.0 * u);
+            t[l] = 2.0 * std::numbers::pi * (u - 0.25 * q[l]);
+            a2[l] = t[l] * t[l];
+            ps[l] = 1.0;
+            pc[l] = 1.0;
+        }
+        for (int k = 8; k >= 1; --k) {
+            const auto cs = 1.0 / ((2 * k) * (2 * k + 1));
+            const auto cc = 1.0 / ((2 * k - 1) * (2 * k));
+            for (size_t l = 0; l < philox_lanes; ++l) {
+                ps[l] = 1.0 - ps[l] * a2[l] * cs;
+                pc[l] = 1.0 - pc[l] * a2[l] * cc;
+            }
+        }
+        for (size_t l = 0; l < philox_lanes; ++l) {
+            const auto sin_t = ps[l] * t[l], cos_t = pc[l];
+            const auto quadrant = static_cast<int64_t>(q[l]) & 3;
+            const auto x = quadrant & 1 ? sin_t : cos_t;
+            const auto y = quadrant & 1 ? cos_t : sin_t;
+            z[l] = r[l] * (quadrant == 1 || quadrant == 2 ? -x : x);
+            z[philox_lanes + l] = r[l] * (quadrant >= 2 ? -y : y);
+        }
+    }
+
+    // Values skip, skip + 1, ... of the bulk sequence starting at block first into out, by calls to
+    // fn(batch, o, from, n) that write values [from, from + n) of a batch of per_batch values to o.
+    // Returns the blocks spanned.
+    template<typename T, typename Fn>
+    uint64_t fill_batches(std::span<T> out, const size_t per_batch, const std::array<uint32_t, 2> &key,
+                          const uint64_t stream, const uint64_t first, const uint64_t skip, Fn &&fn) {
+        philox_batch batch;
+        auto block = first + skip / per_batch * philox_lanes;
+        auto from = static_cast<size_t>(skip % per_batch);
+        for (size_t i = 0; i < out.size(); block += philox_lanes, from = 0) {
+            philox(batch, key, stream, block);
+            const auto n = std::min(per_batch - from, out.size() - i);
+            fn(batch, out.data() + i, from, n);
+            i += n;
+        }
+        return block - first;
+    }
+
+    void uniform_batch(const philox_batch &b, double *o, const size_t from, const size_t n,
+                       const double lo, const double hi) {
+        alignas(64) double u[2 * philox_lanes];
+        for (size_t h = 0; h < 2; ++h) {
+            for (size_t l = 0; l < philox_lanes; ++l) u[h * philox_lanes + l] = lo + (hi - lo) * unit(b.bits64(h, l));
+        }
+        std::copy_n(u + from, n, o);
+    }
+}
+
+counter_rng counter_rng::split(const uint64_t id) const {
+    const auto c = philox({~key[0], ~key[1]}, {
+        static_cast<uint32_t>(id), static_cast<uint32_t>(id >> 32),
+        static_cast<uint32_t>(stream), static_cast<uint32_t>(stream >> 32)
+    });
+    counter_rng child(c[0] | static_cast<uint64_t>(c[1]) << 32);
+    child.stream = c[2] | static_cast<uint64_t>(c[3]) << 32;
+    return child;
+}
+
+counter_rng::result_type counter_rng::operator()() {
+    if (used == buffer.size()) {
+        buffer = philox(key, {
+            static_cast<uint32_t>(block), static_cast<uint32_t>(block >> 32),
+            static_cast<uint32_t>(stream), static_cast<uint32_t>(stream >> 32)
+        });
+        ++block;
+        used = 0;
+    }
+    return buffer[used++];
+}
+
+double counter_rng::uniform() {
+    const uint64_t lo = (*this)();
+    return unit(lo | static_cast<uint64_t>((*this)()) << 32);
+}
+
+uint32_t counter_rng::below(const uint32_t n) {
+    return below((*this)(), n);
+}
+
+void counter_rng::fill_bits(std::span<uint32_t> out) {
+    block += fill_batches(out, 4 * philox_lanes, key, stream, block, 0,
+                          [](const philox_batch &b, uint32_t *o, const size_t from, const size_t n) {
+                              std::copy_n(&b.w[0][0] + from, n, o);
+                          });
+}
+
+void counter_rng::fill_uniform(std::span<double> out, const double lo, const double hi) {
+    block += fill_batches(out, 2 * philox_lanes, key, stream, block, 0,
+                          [=](const philox_batch &b, double *o, const size_t from, const size_t n) {
+                              uniform_batch(b, o, from, n, lo, hi);
+                          });
+}
+
+void counter_rng::fill_uniform_at(const uint64_t offset, std::span<double> out, const double lo, const double hi) const {
+    fill_batches(out, 2 * philox_lanes, key, stream, 0, offset,
+                 [=](const philox_batch &b, double *o, const size_t from, const size_t n) {
+                     uniform_batch(b, o, from, n, lo, hi);
+                 });
+}
+
+void counter_rng::fill_normal(std::span<double> out, const double mean, const double std) {
+    block += fill_batches(out, 2 * philox_lanes, key, stream, block, 0,
+                          [=](const philox_batch &b, double *o, const size_t from, const size_t n) {
+                              alignas(64) double z[2 * philox_lanes];
+                              box_muller(b, z);
+                              for (size_t i = 0; i < n; ++i) o[i] = mean + std * z[from + i];
+                          });
+}
+
+void counter_rng::fill_below(std::span<uint32_t> out, const uint32_t n) {
+    block += fill_batches(out, 4 * philox_lanes, key, stream, block, 0,
+                          [=](const philox_batch &b, uint32_t *o, const size_t from, const size_t count) {
+                              for (size_t i = 0; i < count; ++i) o[i] = below((&b.w[0][0])[from + i], n);
+                          });
+}
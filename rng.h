@@ -0,0 +1,55 @@
+#ifndef RNG_H
+#define RNG_H
+
+#include "common.h"
+
+// Counter-based generator on Philox4x32-10 (Salmon et al., "Parallel Random Numbers: As Easy as
+// 1, 2, 3", SC 2011). A block of four 32-bit words is a pure function of the key and a 128-bit
+// counter, which here holds a 64-bit stream id and a 64-bit block index. Streams are split by id,
+// e.g. per run, then per thread or individual, so the draws an individual sees never depend on
+// which thread or how many threads produce them.
+//
+// Scalar draws take words one at a time from a buffered block. Bulk fills compute blocks a batch
+// at a time in vectorisable loops and start at the next unused block; a fill rounds its block
+// consumption up to whole batches.
+class counter_rng {
+public:
+    using result_type = uint32_t;
+
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max() { return std::numeric_limits<result_type>::max(); }
+
+    explicit counter_rng(const uint64_t seed = 0)
+        : key{static_cast<uint32_t>(seed), static_cast<uint32_t>(seed >> 32)} {}
+
+    // Independent stream derived from this one's key and stream id; the position is not inherited.
+    [[nodiscard]] counter_rng split(uint64_t id) const;
+
+    result_type operator()();
+    // Uniform in [0, 1) with 53 random bits.
+    double uniform();
+    // Uniform in [0, n) by multiply-shift; the bias is below n / 2^32.
+    uint32_t below(uint32_t n);
+
+    void fill_bits(std::span<uint32_t> out);
+    void fill_uniform(std::span<double> out, double lo = 0.0, double hi = 1.0);
+    // Values offset, offset + 1, ... of what fill_uniform would give from the start of this stream,
+    // leaving the position alone, so that threads can each fill their slice of one draw.
+    void fill_uniform_at(uint64_t offset, std::span<double> out, double lo = 0.0, double hi = 1.0) const;
+    // Box-Muller: every block yields a pair of normal deviates.
+    void fill_normal(std::span<double> out, double mean = 0.0, double std = 1.0);
+    void fill_below(std::span<uint32_t> out, uint32_t n);
+
+    static uint32_t below(const uint32_t bits, const uint32_t n) {
+        return static_cast<uint32_t>(static_cast<uint64_t>(bits) * n >> 32);
+    }
+
+private:
+    std::array<uint32_t, 2> key;
+    uint64_t stream = 0;
+    uint64_t block = 0;
+    std::array<uint32_t, 4> buffer{};
+    size_t used = 4;
+};
+
+#endif //RNG_H
@@ -0,0 +1,121 @@
+#include "selection.h"
+
+// Draws per bulk fill; a few whole batches of the generator.
+constexpr size_t selection_chunk = 256;
+
+// Calls pick(u) for every slot of out with uniforms drawn in bulk.
+template<typename Pick>
+void select_uniform(counter_rng &rng, const std::span<uint32_t> out, const Pick &pick) {
+    std::array<double, selection_chunk> u{};
+    for (size_t first = 0; first < out.size(); first += selection_chunk) {
+        const auto n = std::min(selection_chunk, out.size() - first);
+        rng.fill_uniform(std::span(u).first(n));
+        for (size_t i = 0; i < n; ++i) out[first + i] = static_cast<uint32_t>(pick(u[i]));
+    }
+}
+
+void prefix_sum_wheel::build(const std::span<const double> fit) {
+    cum.resize(fit.size());
+    double sum = 0.0;
+    for (size_t i = 0; i < fit.size(); ++i) cum[i] = sum += fit[i];
+}
+
+// Runs eight searches in lockstep, as pick does them, so that their loads overlap instead of
+// each waiting on the one before.
+void prefix_sum_wheel::select(counter_rng &rng, const std::span<uint32_t> out) const {
+    constexpr size_t lanes = 8;
+    std::array<double, selection_chunk> u{};
+    const auto n = cum.size();
+    for (size_t first = 0; first < out.size(); first += selection_chunk) {
+        const auto m = std::min(selection_chunk, out.size() - first);
+        rng.fill_uniform(std::span(u).first(m));
+        size_t i = 0;
+        for (; i + lanes <= m; i += lanes) {
+            std::array<double, lanes> r{};
+            std::array<size_t, lanes> base{};
+            for (size_t l = 0; l < lanes; ++l) r[l] = cum.back() * u[i + l];
+            for (auto len = n; len > 1; len -= len / 2) {
+                for (size_t l = 0; l < lanes; ++l) {
+                    base[l] += static_cast<size_t>(cum[base[l] + len / 2] < r[l]) * (len / 2);
+                }
+            }
+            for (size_t l = 0; l < lanes; ++l) {
+                out[first + i + l] = static_cast<uint32_t>(std::min(base[l] + (cum[base[l]] < r[l]), n - 1));
+            }
+        }
+        for (; i < m; ++i) out[first + i] = static_cast<uint32_t>(pick(u[i]));
+    }
+}
+
+void alias_table::build(const std::span<const double> fit) {
+    const auto n = fit.size();
+    prob.resize(n);
+    alias.resize(n);
+    small.clear();
+    large.clear();
+    const auto sum = std::accumulate(fit.begin(), fit.end(), 0.0);
+    const auto scale = static_cast<double>(n) / sum;
+    for (size_t i = 0; i < n; ++i) {
+        prob[i] = fit[i] * scale;
+        alias[i] = static_cast<uint32_t>(i);
+        (prob[i] < 1.0 ? small : large).push_back(static_cast<uint32_t>(i));
+    }
+    // Fill every short column up to 1 from a tall one, which may then become short itself.
+    while (!small.empty() && !large.empty()) {
+        const auto s = small.back(), l = large.back();
+        small.pop_back();
+        alias[s] = l;
+        prob[l] -= 1.0 - prob[s];
+        if (prob[l] < 1.0) {
+            large.pop_back();
+            small.push_back(l);
+        }
+    }
+    // What is left is 1 up to rounding.
+    for (const auto i: small) prob[i] = 1.0;
+    for (const auto i: large) prob[i] = 1.0;
+}
+
+void alias_table::select(counter_rng &rng, const std::span<uint32_t> out) const {
+    select_uniform(rng, out, [&](const double u) { return pick(u); });
+}
+
+void sus_select(const std::span<const double> fit, counter_rng &rng, const std::span<uint32_t> out) {
+    if (out.empty()) return;
+    const auto sum = std::accumulate(fit.begin(), fit.end(), 0.0);
+    const auto step = sum / static_cast<double>(out.size());
+    auto pointer = step * rng.uniform();
+    auto cum = 0.0;
+    size_t i = 0;
+    for (auto &pick: out) {
+        while (i + 1 < fit.size() && cum + fit[i] < pointer) cum += fit[i++];
+        pick = static_cast<uint32_t>(i);
+        pointer += step;
+    }
+}
+
+void tournament_select(const std::span<const double> fit, const size_t k, counter_rng &rng,
+                       const std::span<uint32_t> out) {
+    std::array<uint32_t, selection_chunk> drawn{};
+    const auto n = static_cast<uint32_t>(fit.size());
+    // Entrants are drawn a chunk at a time, as many as remain to be used.
+    auto remaining = out.size() * k;
+    size_t next = 0, filled = 0;
+    const auto entrant = [&] {
+        if (next == filled) {
+            filled = std::min(selection_chunk, remaining);
+            rng.fill_below(std::span(drawn).first(filled), n);
+            remaining -= filled;
+            next = 0;
+        }
+        return drawn[next++];
+    };
+    for (auto &pick: out) {
+        auto best = entrant();
+        for (size_t i = 1; i < k; ++i) {
+            const auto other = entrant();
+            if (fit[other] > fit[best]) best = other;
+        }
+        pick = best;
+    }
+}
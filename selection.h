@@ -0,0 +1,70 @@
+#ifndef SELECTION_H
+#define SELECTION_H
+
+#include "common.h"
+#include "rng.h"
+
+// Selection over a fitness column where higher is better; fitness-proportionate selection also
+// needs it non-negative with a positive sum. The tables keep their storage between builds, so
+// rebuilding them every generation allocates nothing once the population stops growing. select
+// fills every slot of out with a pick, taking its draws from bulk fills.
+
+// Roulette wheel by binary search on the prefix sums: O(n) to build, O(log n) per pick. Picks the
+// same member as a linear scan of the wheel would.
+class prefix_sum_wheel {
+public:
+    void build(std::span<const double> fit);
+
+    // Member at u in [0, 1) of the way round the wheel: the first whose prefix sum reaches it, by a
+    // binary search that steps by arithmetic rather than by a branch, which would mispredict on
+    // every other halving.
+    [[nodiscard]] size_t pick(const double u) const {
+        const auto r = cum.back() * u;
+        const double *base = cum.data();
+        for (auto len = cum.size(); len > 1; len -= len / 2) {
+            base += static_cast<size_t>(base[len / 2] < r) * (len / 2);
+        }
+        return std::min<size_t>(base - cum.data() + (*base < r), cum.size() - 1);
+    }
+
+    void select(counter_rng &rng, std::span<uint32_t> out) const;
+
+private:
+    std::vector<double> cum;
+};
+
+// Walker's alias method, built with Vose's worklists: O(n) to build, O(1) per pick. One draw
+// gives both the column, from its integer part, and the coin, from its fraction.
+class alias_table {
+public:
+    void build(std::span<const double> fit);
+
+    [[nodiscard]] size_t pick(const double u) const {
+        const auto x = u * static_cast<double>(prob.size());
+        const auto i = std::min(static_cast<size_t>(x), prob.size() - 1);
+        // The coin picks by mask rather than by branch, which would mispredict on every other
+        // pick; compilers turn a plain conditional back into a branch at -O3.
+        const size_t other = alias[i];
+        const auto keep = static_cast<size_t>(x - static_cast<double>(i) < prob[i]);
+        return other ^ ((other ^ i) & (0 - keep));
+    }
+
+    void select(counter_rng &rng, std::span<uint32_t> out) const;
+
+private:
+    std::vector<double> prob;
+    std::vector<uint32_t> alias;
+    std::vector<uint32_t> small;
+    std::vector<uint32_t> large;
+};
+
+// Stochastic universal sampling: out.size() equally spaced pointers on the wheel from one draw,
+// O(n + out.size()), with every member picked within one of its expected count. The picks come
+// out in member order.
+void sus_select(std::span<const double> fit, counter_rng &rng, std::span<uint32_t> out);
+
+// Each pick is the fittest of k members drawn uniformly with replacement: O(k) per pick, and no
+// table.
+void tournament_select(std::span<const double> fit, size_t k, counter_rng &rng, std::span<uint32_t> out);
+
+#endif //SELECTION_H
@@ -0,0 +1,63 @@
+#ifndef SPSC_QUEUE_H
+#define SPSC_QUEUE_H
+
+#include "common.h"
+
+// Bounded lock-free queue for exactly one producer thread and one consumer thread. Each side
+// caches the other's index and only reloads it when the queue looks full or empty.
+template<typename T>
+class spsc_queue {
+public:
+    explicit spsc_queue(const size_t capacity) : slots(std::bit_ceil(std::max<size_t>(capacity, 2))) {}
+
+    spsc_queue(const spsc_queue &) = delete;
+    spsc_queue &operator=(const spsc_queue &) = delete;
+
+    // Producer side. The value is only moved from when there was room for it.
+    bool try_push(T &&value) {
+        const auto t = tail.load(std::memory_order_relaxed);
+        if (t - head_cache == slots.size()) {
+            head_cache = head.load(std::memory_order_acquire);
+            if (t - head_cache == slots.size()) return false;
+        }
+        slots[t & (slots.size() - 1)] = std::move(value);
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side.
+    std::optional<T> try_pop() {
+        const auto h = head.load(std::memory_order_relaxed);
+        if (h == tail_cache) {
+            tail_cache = tail.load(std::memory_order_acquire);
+            if (h == tail_cache) return std::nullopt;
+        }
+        std::optional<T> value(std::move(slots[h & (slots.size() - 1)]));
+        head.store(h + 1, std::memory_order_release);
+        return value;
+    }
+
+    // Blocking variants for callers that must not drop items; they spin, yielding the core.
+    void push(T &&value) {
+        while (!try_push(std::move(value))) std::this_thread::yield();
+    }
+
+    T pop() {
+        for (;;) {
+            if (auto value = try_pop()) return std::move(*value);
+            std::this_thread::yield();
+        }
+    }
+
+private:
+    static constexpr size_t cache_line = 64;
+    std::vector<T> slots;
+    // Consumer-owned.
+    alignas(cache_line) std::atomic<size_t> head{0};
+    size_t tail_cache = 0;
+    // Producer-owned.
+    alignas(cache_line) std::atomic<size_t> tail{0};
+    size_t head_cache = 0;
+};
+
+#endif //SPSC_QUEUE_H
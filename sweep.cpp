@@ -0,0 +1,193 @@
+#include "sweep.h"
+#include "work_stealing_pool.h"
+
+#include <filesystem>
+#include <mutex>
+
+std::optional<std::vector<std::string>> sweep_values(const std::string &text) {
+    std::vector<std::string> values;
+    for (const auto part: text | std::views::split(',')) {
+        const auto item = config_trim(std::string(part.begin(), part.end()));
+        const auto dots = item.find("..");
+        int64_t first = 0, last = 0;
+        const auto whole = [](const std::string &text, int64_t &v) {
+            const auto [end, ec] = std::from_chars(text.data(), text.data() + text.size(), v);
+            return ec == std::errc() && end == text.data() + text.size();
+        };
+        // Anything else with "..", such as a relative path, is a value.
+        if (dots == std::string::npos || !whole(item.substr(0, dots), first) || !whole(item.substr(dots + 2), last)) {
+            values.push_back(item);
+            continue;
+        }
+        if (first > last) return std::nullopt;
+        for (auto v = first; v <= last; ++v) values.push_back(std::to_string(v));
+    }
+    if (values.empty()) return std::nullopt;
+    return values;
+}
+
+std::optional<std::vector<config>> load_sweep(const std::string &path) {
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        std::cerr << "Failed to open " << path << "." << std::endl;
+        return std::nullopt;
+    }
+    using block = std::map<std::string, std::vector<std::string>>;
+    block shared;
+    std::vector<block> blocks;
+    std::string line;
+    for (size_t n = 1; std::getline(file, line); ++n) {
+        line = config_trim(line.substr(0, line.find('#')));
+        if (line.empty()) continue;
+        if (line.front() == '[' && line.back() == ']') {
+            blocks.emplace_back();
+            continue;
+        }
+        const auto eq = line.find('=');
+        const auto values = eq == std::string::npos ? std::nullopt : sweep_values(line.substr(eq + 1));
+        if (!values) {
+            std::cerr << path << ":" << n << ": expected key = value, value, ... or key = first..last." << std::endl;
+            return std::nullopt;
+        }
+        (blocks.empty() ? shared : blocks.back())[config_trim(line.substr(0, eq))] = *values;
+    }
+    if (blocks.empty()) blocks.emplace_back();
+    std::vector<config> runs;
+    for (auto &b: blocks) {
+        b.insert(shared.begin(), shared.end());
+        // Odometer over the value lists, the last key turning fastest.
+        std::vector<size_t> pick(b.size());
+        for (;;) {
+            config cfg;
+            size_t i = 0;
+            for (const auto &[key, values]: b) cfg.set(key, values[pick[i++]]);
+            runs.push_back(std::move(cfg));
+            auto it = b.rbegin();
+            for (i = b.size(); i > 0; --i, ++it) {
+                if (++pick[i - 1] < it->second.size()) break;
+                pick[i - 1] = 0;
+            }
+            if (i == 0) break;
+        }
+    }
+    return runs;
+}
+
+std::string sweep_key(const config &cfg) {
+    std::string key;
+    for (const auto &[k, v]: cfg.all()) {
+        if (!key.empty()) key += ' ';
+        key += k + '=' + v;
+    }
+    return key;
+}
+
+std::optional<run_summary> run_in_batch(const config &cfg, std::vector<std::string> &unused) {
+    auto own = cfg;
+    const auto own_threads = cfg.all().contains("threads");
+    if (!own_threads) own.set("threads", "1");
+    const auto summary = run_engine(own);
+    for (const auto &key: own.unused()) {
+        if (key != "threads" || own_threads) unused.push_back(key);
+    }
+    return summary;
+}
+
+// Rough relative cost of a run: the product of its size settings. Only the order matters, to
+// start the longest runs first so that none is left running alone at the end.
+double sweep_cost(const config &cfg) {
+    constexpr std::array sizes{
+        "np", "n_particle", "n_flock", "n_gene", "ants", "cities", "n_dim", "n_epoch", "islands"
+    };
+    double cost = 1.0;
+    for (const auto &key: sizes) {
+        const auto it = cfg.all().find(key);
+        if (it == cfg.all().end()) continue;
+        double v = 1.0;
+        std::from_chars(it->second.data(), it->second.data() + it->second.size(), v);
+        cost *= std::max(v, 1.0);
+    }
+    return cost;
+}
+
+// Keys of the runs already in a results file. A last line cut short by a stopped sweep is not
+// counted, and a line break is added so that new lines start clean.
+std::optional<std::set<std::string>> sweep_done(const std::string &results) {
+    std::set<std::string> done;
+    std::fstream file(results, std::ios::in | std::ios::out);
+    if (!file.is_open()) return done;
+    std::string line;
+    bool ended = true;
+    while (std::getline(file, line)) {
+        ended = !file.eof();
+        if (line.empty() || line.front() == '#' || !ended) continue;
+        // Skip best, evaluations and seconds.
+        auto pos = line.find(' ');
+        for (int field = 1; field < 3 && pos != std::string::npos; ++field) pos = line.find(' ', pos + 1);
+        if (pos == std::string::npos) continue;
+        done.insert(line.substr(pos + 1));
+    }
+    if (!ended) {
+        file.clear();
+        file.seekp(0, std::ios::end);
+        file << '\n';
+    }
+    if (file.bad()) {
+        std::cerr << "Failed to read " << results << "." << std::endl;
+        return std::nullopt;
+    }
+    return done;
+}
+
+bool run_sweep(const std::string &spec, const std::string &results, const size_t n_thread) {
+    const auto runs = load_sweep(spec);
+    if (!runs) return false;
+    const auto done = sweep_done(results);
+    if (!done) return false;
+    std::vector<config> todo;
+    for (const auto &run: *runs) {
+        if (!done->contains(sweep_key(run))) todo.push_back(run);
+    }
+    std::vector<double> cost(todo.size());
+    std::vector<size_t> order(todo.size());
+    for (size_t i = 0; i < todo.size(); ++i) cost[i] = sweep_cost(todo[i]);
+    std::iota(order.begin(), order.end(), 0);
+    std::ranges::stable_sort(order, std::greater{}, [&](const size_t i) { return cost[i]; });
+
+    const auto fresh = !std::filesystem::exists(results) || std::filesystem::file_size(results) == 0;
+    std::ofstream out(results, std::ios::app);
+    if (!out.is_open()) {
+        std::cerr << "Failed to open " << results << "." << std::endl;
+        return false;
+    }
+    if (fresh) out << "# best evaluations seconds settings" << std::endl;
+    std::mutex mutex;
+    std::set<std::string> unused;
+    size_t n_failed = 0;
+    const auto begin = std::chrono::steady_clock::now();
+    work_stealing_pool pool(n_thread);
+    pool.run(order, [&](const size_t i, size_t) {
+        std::vector<std::string> run_unused;
+        const auto run_begin = std::chrono::steady_clock::now();
+        const auto summary = run_in_batch(todo[i], run_unused);
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - run_begin;
+        std::lock_guard lock(mutex);
+        unused.insert(run_unused.begin(), run_unused.end());
+        if (!summary) {
+            std::cerr << "Failed run: " << sweep_key(todo[i]) << std::endl;
+            ++n_failed;
+            return;
+        }
+        // Shortest text that reads back as the same best value.
+        std::array<char, 32> best{};
+        const auto best_end = std::to_chars(best.data(), best.data() + best.size(), summary->best).ptr;
+        out << std::string_view(best.data(), best_end) << ' ' << summary->n_eval << ' ' << elapsed.count() << ' '
+            << sweep_key(todo[i]) << std::endl;
+    });
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - begin;
+    for (const auto &key: unused) std::cerr << "Unused setting '" << key << "'." << std::endl;
+    std::cout << runs->size() << " runs: " << runs->size() - todo.size() << " already done, " << todo.size() - n_failed
+        << " done, " << n_failed << " failed in " << elapsed.count() << " seconds on " << pool.size() << " threads"
+        << std::endl;
+    return n_failed == 0;
+}
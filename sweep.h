@@ -0,0 +1,45 @@
+#ifndef SWEEP_H
+#define SWEEP_H
+
+#include "common.h"
+#include "config.h"
+#include "engines.h"
+
+// A sweep spec is a config file where a value may list several values, "a, b, c", and an integer
+// value may be a range, "0..29", inclusive; a value with ".." that is not two integers, such as
+// "../data/a280.tsp", is taken as it is. Each "[name]" header starts a block; settings above
+// the first header are shared by every block, and a block may override them. Every block expands
+// to the cartesian product of its lists, one run per combination:
+//
+//   seed = 0..29
+//   n_epoch = 200
+//   [de]
+//   algo = de
+//   strategy = rand_1, best_1
+//   [pso]
+//   algo = pso
+//   w = 0.4, 0.7
+// The values listed by one setting of a spec, with ranges expanded; nullopt when there are none or
+// a range runs backwards.
+std::optional<std::vector<std::string>> sweep_values(const std::string &text);
+
+std::optional<std::vector<config>> load_sweep(const std::string &path);
+
+// The settings of a run on one line, "key=value" pairs in key order; this identifies the run in
+// the results file.
+std::string sweep_key(const config &cfg);
+
+// Runs one engine as part of a batch that already keeps every core busy, so single-threaded
+// unless cfg sets "threads". Settings that were never read are added to unused.
+std::optional<run_summary> run_in_batch(const config &cfg, std::vector<std::string> &unused);
+
+// Runs every run of the spec not yet in the results file on n_thread workers, the costliest
+// first, and appends one line per finished run to the results file:
+//
+//   best evaluations seconds key=value ...
+//
+// Runs are appended as they finish, so a sweep that is stopped can be resumed by running it again
+// with the same results file. False when the spec or the results file cannot be read.
+bool run_sweep(const std::string &spec, const std::string &results, size_t n_thread);
+
+#endif //SWEEP_H
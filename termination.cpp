@@ -0,0 +1,126 @@
+#include "termination.h"
+#include "rng.h"
+
+std::optional<stopping> read_stopping(const config &cfg) {
+    stopping crit;
+    if (!(cfg.read("max_eval", crit.max_eval) && cfg.read("target", crit.target) && cfg.read("stall", crit.stall) &&
+          cfg.read("stall_tol", crit.stall_tol) && cfg.read("min_spread", crit.min_spread))) {
+        return std::nullopt;
+    }
+    if (crit.stall_tol < 0.0 || crit.min_spread < 0.0) {
+        std::cerr << "Stopping needs stall_tol >= 0 and min_spread >= 0." << std::endl;
+        return std::nullopt;
+    }
+    return crit;
+}
+
+void spread_sum::add(const population &pop) {
+    if (n == 0 && pop.size()) {
+        for (size_t j = 0; j < shift.size(); ++j) shift[j] = pop.col(j)[0];
+    }
+    for (size_t j = 0; j < shift.size(); ++j) {
+        for (const auto x: pop.col(j)) add(j, x);
+    }
+    n += pop.size();
+}
+
+void spread_sum::add_rows(const std::span<const double> rows) {
+    const auto n_dim = shift.size();
+    const auto m = rows.size() / n_dim;
+    if (n == 0 && m) std::ranges::copy(rows.first(n_dim), shift.begin());
+    for (size_t i = 0; i < m; ++i) {
+        for (size_t j = 0; j < n_dim; ++j) add(j, rows[i * n_dim + j]);
+    }
+    n += m;
+}
+
+double spread_sum::value() const {
+    if (n == 0 || shift.empty()) return 0.0;
+    const auto count = static_cast<double>(n);
+    double var = 0.0;
+    for (size_t j = 0; j < shift.size(); ++j) {
+        const auto mean = sum[j] / count;
+        var += std::max(0.0, sum2[j] / count - mean * mean);
+    }
+    return std::sqrt(var / static_cast<double>(shift.size()));
+}
+
+double variation_of(const std::span<const double> v) {
+    if (v.empty()) return 0.0;
+    if (!std::ranges::all_of(v, [](const double x) { return std::isfinite(x); })) {
+        return std::numeric_limits<double>::infinity();
+    }
+    spread_sum s(1);
+    s.add_rows(v);
+    const auto mean = std::reduce(v.begin(), v.end()) / static_cast<double>(v.size());
+    return mean != 0.0 ? s.value() / std::abs(mean) : s.value();
+}
+
+std::optional<restarts> read_restarts(const config &cfg) {
+    restarts r;
+    if (!(cfg.read("restart", r.rule, restart_rule_names) && cfg.read("max_restarts", r.max_restarts) &&
+          cfg.read("pop_factor", r.pop_factor))) {
+        return std::nullopt;
+    }
+    if (r.pop_factor <= 1.0) {
+        std::cerr << "Restarts need pop_factor > 1." << std::endl;
+        return std::nullopt;
+    }
+    if (r.rule != restart_rule::none && cfg.all().contains("checkpoint")) {
+        std::cerr << "Runs with restarts cannot be checkpointed." << std::endl;
+        return std::nullopt;
+    }
+    return r;
+}
+
+std::optional<run_summary> run_restarts(const restarts &r, const stopping &crit, const size_t n, const uint64_t seed,
+                                        const restart_run &run) {
+    // Seeds and small population sizes of the restarts, from a stream of the first seed that no
+    // engine draws from.
+    constexpr uint64_t restart_stream = 0x5245'5354'4152'5400;
+    run_summary total{std::numeric_limits<double>::infinity(), 0};
+    auto left = crit;
+    size_t n_large = n, evals_large = 0, evals_small = 0;
+    for (size_t index = 0;; ++index) {
+        auto size = n;
+        auto run_seed = seed;
+        auto large = true;
+        if (index > 0) {
+            auto draws = counter_rng(seed).split(restart_stream).split(index);
+            run_seed = static_cast<uint64_t>(draws()) << 32 | draws();
+            if (r.rule == restart_rule::bipop && evals_large > evals_small) {
+                large = false;
+                const auto u = draws.uniform();
+                const auto half = static_cast<double>(n_large) / (2.0 * static_cast<double>(n));
+                size = std::max(n, static_cast<size_t>(static_cast<double>(n) * std::pow(half, u * u)));
+            } else {
+                const auto grown = static_cast<size_t>(std::round(static_cast<double>(n_large) * r.pop_factor));
+                n_large = std::max(n_large + 1, grown);
+                size = n_large;
+            }
+        }
+        const auto ran = run(size, run_seed, left, index);
+        if (!ran) return std::nullopt;
+        const auto &summary = *ran;
+        total.best = std::min(total.best, summary.best);
+        total.n_eval += summary.n_eval;
+        total.stop = summary.stop;
+        total.n_restart = index;
+        (large ? evals_large : evals_small) += summary.n_eval;
+        if (r.rule == restart_rule::none || index == r.max_restarts || summary.stop == stop_reason::target ||
+            summary.stop == stop_reason::budget) {
+            break;
+        }
+        // Short of the budget, or the run would have stopped on it.
+        if (crit.max_eval) left.max_eval = crit.max_eval - total.n_eval;
+    }
+    return total;
+}
+
+std::string restart_log_name(const std::string &path, const size_t index) {
+    if (path.empty() || index == 0) return path;
+    const auto name = path.find_last_of('/') + 1;
+    const auto dot = path.find_last_of('.');
+    const auto at = dot != std::string::npos && dot > name ? dot : path.size();
+    return path.substr(0, at) + '-' + std::to_string(index) + path.substr(at);
+}
@@ -0,0 +1,141 @@
+#ifndef TERMINATION_H
+#define TERMINATION_H
+
+#include "common.h"
+#include "checkpoint.h"
+#include "config.h"
+#include "engines.h"
+#include "population.h"
+
+#include <functional>
+
+// Criteria that end a run before its n_epoch epochs, checked after every epoch; each is off until
+// it is set. A run stops once
+//   - it has made max_eval evaluations, "max_eval";
+//   - its best value is at or below target, "target";
+//   - its best value has not improved by more than stall_tol for stall epochs, "stall" and
+//     "stall_tol";
+//   - the spread of its population is below min_spread, "min_spread". Each engine measures spread
+//     its own way: DE, PSO and GA by spread_sum over the members, EDA by the spread of its model,
+//     and ACO by the variation_of its tour costs, which falls to 0 as every ant finds one tour.
+struct stopping {
+    size_t max_eval = 0;
+    double target = -std::numeric_limits<double>::infinity();
+    size_t stall = 0;
+    double stall_tol = 0.0;
+    double min_spread = 0.0;
+
+    [[nodiscard]] bool any() const {
+        return max_eval || target > -std::numeric_limits<double>::infinity() || stall || min_spread > 0.0;
+    }
+};
+
+// nullopt, with a message, when a setting is invalid.
+std::optional<stopping> read_stopping(const config &cfg);
+
+// A run's progress against its stopping criteria.
+class convergence {
+public:
+    explicit convergence(const stopping &crit) : crit(crit) {}
+
+    // Called after every epoch with the best value and the evaluations so far; spread() is only
+    // called when min_spread is set. The criterion that ends the run, if any.
+    template<typename Spread>
+    std::optional<stop_reason> check(const double best, const size_t n_eval, const Spread &spread) {
+        if (best <= crit.target) return stop_reason::target;
+        if (crit.max_eval && n_eval >= crit.max_eval) return stop_reason::budget;
+        if (best < last - crit.stall_tol) {
+            last = best;
+            flat = 0;
+        } else if (crit.stall && ++flat >= crit.stall) {
+            return stop_reason::stall;
+        }
+        if (crit.min_spread > 0.0 && spread() < crit.min_spread) return stop_reason::diversity;
+        return std::nullopt;
+    }
+
+    void save(snapshot &out) const {
+        out.put(last);
+        out.put(flat);
+    }
+
+    void restore(snapshot_reader &in) {
+        in.get(last);
+        in.get(flat);
+    }
+
+private:
+    stopping crit;
+    // The best value when it last improved, and the epochs since.
+    double last = std::numeric_limits<double>::infinity();
+    size_t flat = 0;
+};
+
+// Spread of a set of members: the root mean square over the axes of their standard deviation.
+// Sums are taken about the first member added, which keeps them small.
+class spread_sum {
+public:
+    explicit spread_sum(const size_t n_dim) : shift(n_dim), sum(n_dim), sum2(n_dim) {}
+
+    void add(const population &pop);
+    // Members one after another, n_dim values each.
+    void add_rows(std::span<const double> rows);
+
+    [[nodiscard]] double value() const;
+
+private:
+    void add(size_t j, double x) {
+        const auto d = x - shift[j];
+        sum[j] += d;
+        sum2[j] += d * d;
+    }
+
+    size_t n = 0;
+    std::vector<double> shift;
+    std::vector<double> sum;
+    std::vector<double> sum2;
+};
+
+// Standard deviation of the values over their mean; infinite when any value is.
+double variation_of(std::span<const double> v);
+
+// How a run that ends short of its target is started again ("restart"):
+//   - none: it is not;
+//   - ipop: with the population grown by pop_factor every time (IPOP-CMA-ES, Auger and Hansen
+//     2005);
+//   - bipop: alternating between that growing population and a small one, drawn between the first
+//     size and half the large one, so that each regime gets about the same evaluations (BIPOP-CMA-ES,
+//     Hansen 2009).
+// Every restart gets a fresh seed drawn from the first, and there are at most max_restarts of them.
+enum class restart_rule { none, ipop, bipop };
+
+constexpr std::array<std::pair<std::string_view, restart_rule>, 3> restart_rule_names{{
+    {"none", restart_rule::none}, {"ipop", restart_rule::ipop}, {"bipop", restart_rule::bipop},
+}};
+
+struct restarts {
+    restart_rule rule = restart_rule::none;
+    size_t max_restarts = 9;
+    double pop_factor = 2.0;
+};
+
+// From "restart", "max_restarts" and "pop_factor"; nullopt, with a message, when a setting is
+// invalid.
+std::optional<restarts> read_restarts(const config &cfg);
+
+// One run of an engine with n members, seed, and stopping criteria; index counts the runs from 0.
+// nullopt, with a message, when the run could not start, as from a checkpoint of another engine.
+using restart_run = std::function<std::optional<run_summary>(size_t n, uint64_t seed, const stopping &crit,
+                                                             size_t index)>;
+
+// Runs first with n members and seed, then restarts as r says until one run reaches the target or
+// the runs together have used max_eval evaluations. The summary holds the best value of all runs
+// and their evaluations together; nullopt when a run failed.
+std::optional<run_summary> run_restarts(const restarts &r, const stopping &crit, size_t n, uint64_t seed,
+                                        const restart_run &run);
+
+// Log path of run index: path itself for the first, and path with "-index" before its extension
+// for the restarts.
+std::string restart_log_name(const std::string &path, size_t index);
+
+#endif //TERMINATION_H
@@ -0,0 +1,176 @@
+#include "trajectory.h"
+#include "profile.h"
+
+#include <filesystem>
+
+constexpr std::array<char, 8> trajectory_magic{'G', 'E', 'N', 'E', '0', '1', 'T', '1'};
+
+namespace {
+    constexpr size_t header_bytes = trajectory_magic.size() + 4 * sizeof(uint32_t);
+
+    std::array<uint32_t, 4> header_of(const trajectory_shape &shape) {
+        return {static_cast<uint32_t>(shape.layout), shape.prefix, shape.members, shape.width};
+    }
+}
+
+trajectory_writer::trajectory_writer(const std::string &path, const trajectory_shape shape, const sampling policy,
+                                     const uint64_t keep)
+    : shape(shape), policy(policy) {
+    if (path.empty()) return;
+    if (keep > 0) {
+        if (!open_kept(path, keep)) return;
+    } else {
+        file.open(path, std::ios::binary);
+        if (!file.is_open()) {
+            std::cerr << "Failed to open " << path << " for writing; the run goes on without a log." << std::endl;
+            return;
+        }
+        file.write(trajectory_magic.data(), trajectory_magic.size());
+        const auto header = header_of(shape);
+        file.write(reinterpret_cast<const char *>(header.data()), sizeof(header));
+    }
+    writer = std::jthread([this] { serve(); });
+}
+
+bool trajectory_writer::open_kept(const std::string &path, const uint64_t keep) {
+    const auto size = header_bytes + keep * (1 + shape.record_size()) * sizeof(double);
+    std::ifstream in(path, std::ios::binary);
+    std::array<char, 8> magic{};
+    std::array<uint32_t, 4> header{};
+    in.read(magic.data(), magic.size());
+    in.read(reinterpret_cast<char *>(header.data()), sizeof(header));
+    std::error_code ec;
+    const auto have = std::filesystem::file_size(path, ec);
+    if (!in || ec || magic != trajectory_magic || header != header_of(shape) || have < size) {
+        std::cerr << "Cannot continue " << path << ": it does not hold the " << keep << " records of the checkpoint; "
+            "the run goes on without a log." << std::endl;
+        return false;
+    }
+    in.close();
+    std::filesystem::resize_file(path, size, ec);
+    file.open(path, std::ios::binary | std::ios::in | std::ios::out);
+    file.seekp(0, std::ios::end);
+    if (ec || !file) {
+        std::cerr << "Failed to open " << path << " for writing." << std::endl;
+        return false;
+    }
+    n_record = keep;
+    written.store(keep, std::memory_order_relaxed);
+    return true;
+}
+
+trajectory_writer::~trajectory_writer() {
+    close();
+}
+
+std::span<double> trajectory_writer::record(const uint64_t epoch) {
+    if (!writer.joinable() || (policy.every > 1 && epoch % policy.every != 0)) return {};
+    if (front.size() >= flush_values && !busy.load(std::memory_order_acquire)) hand_off();
+    const auto at = front.size();
+    front.resize(at + 1 + shape.record_size());
+    front[at] = static_cast<double>(epoch);
+    ++n_record;
+    profile_count(profile_counter::records);
+    return {front.data() + at + 1, shape.record_size()};
+}
+
+// Only called while the writer is idle, so the back buffer is free to take.
+void trajectory_writer::hand_off() {
+    std::swap(front, back);
+    front.clear();
+    back_records = n_record - written.load(std::memory_order_relaxed);
+    busy.store(true, std::memory_order_release);
+    busy.notify_one();
+}
+
+void trajectory_writer::close() {
+    if (!writer.joinable()) return;
+    busy.wait(true, std::memory_order_acquire);
+    stopping = true;
+    hand_off();
+    writer.join();
+    file.close();
+}
+
+uint64_t trajectory_writer::flush() {
+    if (!writer.joinable()) return n_record;
+    busy.wait(true, std::memory_order_acquire);
+    if (!front.empty()) hand_off();
+    return n_record;
+}
+
+void trajectory_writer::wait_written(const uint64_t n) const {
+    auto seen = written.load(std::memory_order_acquire);
+    while (seen < n) {
+        written.wait(seen, std::memory_order_acquire);
+        seen = written.load(std::memory_order_acquire);
+    }
+}
+
+void trajectory_writer::serve() {
+    for (;;) {
+        busy.wait(false, std::memory_order_acquire);
+        const phase_timer timer(phase::log);
+        file.write(reinterpret_cast<const char *>(back.data()), static_cast<std::streamsize>(back.size() * sizeof(double)));
+        file.flush();
+        written.fetch_add(back_records, std::memory_order_release);
+        written.notify_all();
+        const auto last = stopping;
+        busy.store(false, std::memory_order_release);
+        busy.notify_one();
+        if (last) return;
+    }
+}
+
+std::optional<trajectory_reader> trajectory_reader::open(const std::string &path) {
+    trajectory_reader reader;
+    reader.file.open(path, std::ios::binary);
+    if (!reader.file.is_open()) {
+        std::cerr << "Failed to open " << path << "." << std::endl;
+        return std::nullopt;
+    }
+    std::array<char, 8> magic{};
+    std::array<uint32_t, 4> header{};
+    reader.file.read(magic.data(), magic.size());
+    reader.file.read(reinterpret_cast<char *>(header.data()), sizeof(header));
+    if (!reader.file || magic != trajectory_magic || header[0] > static_cast<uint32_t>(trajectory_layout::population)) {
+        std::cerr << path << " is not a trajectory file." << std::endl;
+        return std::nullopt;
+    }
+    reader.shape_ = {static_cast<trajectory_layout>(header[0]), header[1], header[2], header[3]};
+    return reader;
+}
+
+std::optional<uint64_t> trajectory_reader::next(std::span<double> values) {
+    double epoch;
+    file.read(reinterpret_cast<char *>(&epoch), sizeof(epoch));
+    file.read(reinterpret_cast<char *>(values.data()), static_cast<std::streamsize>(shape_.record_size() * sizeof(double)));
+    if (!file) return std::nullopt;
+    return static_cast<uint64_t>(epoch);
+}
+
+void print_record(std::ostream &os, const trajectory_shape &shape, std::span<const double> values) {
+    switch (shape.layout) {
+        case trajectory_layout::flat:
+            for (size_t i = 0; i < values.size(); ++i) {
+                if (i > 0) os << " ";
+                os << values[i];
+            }
+            break;
+        case trajectory_layout::trailing:
+            for (const auto val: values) os << val << " ";
+            break;
+        case trajectory_layout::population:
+            for (size_t i = 0; i < shape.prefix; ++i) {
+                if (i > 0) os << " ";
+                os << values[i];
+            }
+            for (size_t m = 0; m < shape.members; ++m) {
+                for (size_t w = 0; w < shape.width; ++w) {
+                    os << " " << values[shape.prefix + w * shape.members + m];
+                }
+            }
+            break;
+    }
+    os << "\n";
+}
@@ -0,0 +1,103 @@
+#ifndef TRAJECTORY_H
+#define TRAJECTORY_H
+
+#include "common.h"
+
+// How the values of a record are laid out, and how log2txt prints them back as a text line.
+enum class trajectory_layout : uint32_t {
+    // Values separated by spaces.
+    flat,
+    // Every value followed by a space.
+    trailing,
+    // A prefix separated by spaces, then every member's values, each preceded by a space. Members
+    // are stored column by column: the first value of every member, then the second, and so on.
+    population,
+};
+
+struct trajectory_shape {
+    trajectory_layout layout;
+    uint32_t prefix;
+    uint32_t members;
+    uint32_t width;
+
+    [[nodiscard]] size_t record_size() const { return prefix + static_cast<size_t>(members) * width; }
+};
+
+// Keep the epochs that are multiples of every.
+struct sampling {
+    uint64_t every = 1;
+};
+
+// Binary per-epoch log. A file holds a header with the shape, then one record per kept epoch:
+// the epoch number followed by record_size() values, all as native doubles.
+//
+// Records are appended to a front buffer; once it holds enough, it is swapped with the back
+// buffer, which a background thread writes out. The producer never waits on the writer: while
+// the writer is still busy, the front buffer just keeps growing.
+//
+// An empty path disables the log: record() then always returns an empty span.
+//
+// A run resumed from a checkpoint continues its log: with keep > 0, the existing file is cut back
+// to its first keep records and appended to. When the file does not hold that many records of
+// this shape, the log is disabled, with a message.
+class trajectory_writer {
+public:
+    trajectory_writer(const std::string &path, trajectory_shape shape, sampling policy = {}, uint64_t keep = 0);
+    ~trajectory_writer();
+
+    trajectory_writer(const trajectory_writer &) = delete;
+    trajectory_writer &operator=(const trajectory_writer &) = delete;
+
+    // Space to fill with the snapshot of epoch, valid until the next call, or an empty span when
+    // the policy skips the epoch.
+    std::span<double> record(uint64_t epoch);
+
+    // Write out everything and stop the background thread; the destructor does so too.
+    void close();
+
+    // Hand every record so far to the background thread, first waiting for it to finish the last
+    // hand-off if it is still busy, and return how many records the log holds, kept ones included.
+    uint64_t flush();
+
+    // Block until the first n records are on file.
+    void wait_written(uint64_t n) const;
+
+private:
+    bool open_kept(const std::string &path, uint64_t keep);
+    void hand_off();
+    void serve();
+
+    static constexpr size_t flush_values = 1 << 17;
+    std::ofstream file;
+    trajectory_shape shape;
+    sampling policy;
+    std::vector<double> front;
+    std::vector<double> back;
+    // Records in the log so far, in the back buffer, and on file.
+    uint64_t n_record = 0;
+    uint64_t back_records = 0;
+    std::atomic<uint64_t> written{0};
+    std::atomic<bool> busy{false};
+    bool stopping = false;
+    std::jthread writer;
+};
+
+// Sequential reader for trajectory files.
+class trajectory_reader {
+public:
+    static std::optional<trajectory_reader> open(const std::string &path);
+
+    [[nodiscard]] const trajectory_shape &shape() const { return shape_; }
+
+    // The next record into values, which must hold shape().record_size() values.
+    std::optional<uint64_t> next(std::span<double> values);
+
+private:
+    std::ifstream file;
+    trajectory_shape shape_{};
+};
+
+// Text line of a record, as the demos used to log it.
+void print_record(std::ostream &os, const trajectory_shape &shape, std::span<const double> values);
+
+#endif //TRAJECTORY_H
@@ -0,0 +1,329 @@
+#include "tsp.h"
+#include "rng.h"
+
+#include <charconv>
+
+std::string tsplib_trim(const std::string &s) {
+    const auto begin = s.find_first_not_of(" \t\r");
+    if (begin == std::string::npos) return {};
+    return s.substr(begin, s.find_last_not_of(" \t\r") - begin + 1);
+}
+
+// TSPLIB GEO coordinates are DDD.MM, degrees and minutes.
+double tsplib_geo_radians(const double v) {
+    constexpr double pi = 3.141592;
+    const auto deg = std::trunc(v);
+    return pi * (deg + 5.0 * (v - deg) / 3.0) / 180.0;
+}
+
+bool tsplib_read_matrix(std::istream &in, TspInstance &inst, const std::string &format) {
+    const auto n = inst.n;
+    inst.matrix.assign(n * n, 0.0f);
+    const auto put = [&](const size_t i, const size_t j) {
+        float w;
+        if (!(in >> w)) return false;
+        inst.matrix[i * n + j] = w;
+        inst.matrix[j * n + i] = w;
+        return true;
+    };
+    for (size_t i = 0; i < n; ++i) {
+        size_t lo = 0, hi = n;
+        if (format == "FULL_MATRIX") lo = 0, hi = n;
+        else if (format == "UPPER_ROW") lo = i + 1, hi = n;
+        else if (format == "UPPER_DIAG_ROW") lo = i, hi = n;
+        else if (format == "LOWER_ROW") lo = 0, hi = i;
+        else if (format == "LOWER_DIAG_ROW") lo = 0, hi = i + 1;
+        else {
+            std::cerr << "Unsupported EDGE_WEIGHT_FORMAT " << format << "." << std::endl;
+            return false;
+        }
+        for (size_t j = lo; j < hi; ++j) {
+            if (!put(i, j)) {
+                std::cerr << "Truncated EDGE_WEIGHT_SECTION." << std::endl;
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+std::optional<TspInstance> load_tsplib(std::istream &in) {
+    TspInstance inst;
+    std::string weight_type, weight_format = "FULL_MATRIX", line;
+    bool has_coords = false, has_matrix = false;
+    while (std::getline(in, line)) {
+        line = tsplib_trim(line);
+        if (line.empty()) continue;
+        if (line == "EOF") break;
+        if (line == "NODE_COORD_SECTION") {
+            inst.x.resize(inst.n);
+            inst.y.resize(inst.n);
+            for (size_t k = 0; k < inst.n; ++k) {
+                size_t id;
+                double x, y;
+                if (!(in >> id >> x >> y) || id < 1 || id > inst.n) {
+                    std::cerr << "Malformed NODE_COORD_SECTION." << std::endl;
+                    return std::nullopt;
+                }
+                inst.x[id - 1] = x;
+                inst.y[id - 1] = y;
+            }
+            has_coords = true;
+            continue;
+        }
+        if (line == "EDGE_WEIGHT_SECTION") {
+            if (!tsplib_read_matrix(in, inst, weight_format)) return std::nullopt;
+            has_matrix = true;
+            continue;
+        }
+        if (line == "DISPLAY_DATA_SECTION") {
+            for (size_t k = 0; k < inst.n; ++k) std::getline(in >> std::ws, line);
+            continue;
+        }
+        const auto colon = line.find(':');
+        if (colon == std::string::npos) {
+            std::cerr << "Unexpected line in TSPLIB header: " << line << std::endl;
+            return std::nullopt;
+        }
+        const auto key = tsplib_trim(line.substr(0, colon));
+        const auto value = tsplib_trim(line.substr(colon + 1));
+        if (key == "NAME") inst.name = value;
+        else if (key == "TYPE" && value != "TSP") {
+            std::cerr << "Only symmetric TSP instances are supported, not " << value << "." << std::endl;
+            return std::nullopt;
+        } else if (key == "DIMENSION") {
+            const auto [end, ec] = std::from_chars(value.data(), value.data() + value.size(), inst.n);
+            if (ec != std::errc() || end != value.data() + value.size()) {
+                std::cerr << "Invalid DIMENSION '" << value << "'." << std::endl;
+                return std::nullopt;
+            }
+        } else if (key == "EDGE_WEIGHT_TYPE") weight_type = value;
+        else if (key == "EDGE_WEIGHT_FORMAT") weight_format = value;
+    }
+    if (inst.n < 3) {
+        std::cerr << "A TSP instance needs at least 3 cities." << std::endl;
+        return std::nullopt;
+    }
+    using Metric = TspInstance::Metric;
+    if (weight_type == "EXPLICIT" && has_matrix) inst.metric = Metric::explicit_matrix;
+    else if (weight_type == "EUC_2D" && has_coords) inst.metric = Metric::euc_2d;
+    else if (weight_type == "CEIL_2D" && has_coords) inst.metric = Metric::ceil_2d;
+    else if (weight_type == "ATT" && has_coords) inst.metric = Metric::att;
+    else if (weight_type == "GEO" && has_coords) {
+        inst.metric = Metric::geo;
+        for (auto &v: inst.x) v = tsplib_geo_radians(v);
+        for (auto &v: inst.y) v = tsplib_geo_radians(v);
+    } else {
+        std::cerr << "Unsupported EDGE_WEIGHT_TYPE " << weight_type << " or missing data section." << std::endl;
+        return std::nullopt;
+    }
+    return inst;
+}
+
+std::optional<TspInstance> load_tsplib(const std::string &path) {
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        std::cerr << "Failed to open " << path << "." << std::endl;
+        return std::nullopt;
+    }
+    return load_tsplib(file);
+}
+
+TspInstance random_instance(const size_t n, const uint32_t seed, const double side) {
+    TspInstance inst;
+    inst.name = "random" + std::to_string(n);
+    inst.n = n;
+    inst.metric = TspInstance::Metric::euc_2d;
+    counter_rng rng(seed);
+    inst.x.resize(n);
+    inst.y.resize(n);
+    rng.fill_uniform(inst.x, 0.0, side);
+    rng.fill_uniform(inst.y, 0.0, side);
+    return inst;
+}
+
+CandidateLists nearest_neighbours(const TspInstance &inst, size_t k) {
+    k = std::min(k, inst.n - 1);
+    CandidateLists cand{k, std::vector<uint32_t>(inst.n * k)};
+    std::vector<std::pair<float, uint32_t>> row(inst.n - 1);
+    for (size_t i = 0; i < inst.n; ++i) {
+        size_t m = 0;
+        for (size_t j = 0; j < inst.n; ++j) {
+            if (j != i) row[m++] = {inst.dist(i, j), static_cast<uint32_t>(j)};
+        }
+        std::ranges::partial_sort(row, row.begin() + static_cast<ptrdiff_t>(k));
+        for (size_t c = 0; c < k; ++c) cand.city[i * k + c] = row[c].second;
+    }
+    return cand;
+}
+
+double cost_of(const TspInstance &inst, const Path &path) {
+    double cost = inst.dist(path.back(), path.front());
+    for (size_t i = 1; i < path.size(); ++i) {
+        cost += inst.dist(path[i - 1], path[i]);
+    }
+    return cost;
+}
+
+Path tsp_greedy(const TspInstance &inst, const CandidateLists &cand, const size_t start) {
+    std::vector<uint8_t> visited(inst.n);
+    Path path{static_cast<uint32_t>(start)};
+    visited[start] = true;
+    while (path.size() < inst.n) {
+        const auto cur = path.back();
+        auto next = std::numeric_limits<uint32_t>::max();
+        for (const auto c: cand.of(cur)) {
+            if (!visited[c]) {
+                next = c;
+                break;
+            }
+        }
+        if (next == std::numeric_limits<uint32_t>::max()) {
+            // Every candidate is taken: fall back to a scan over all cities.
+            auto best = std::numeric_limits<float>::max();
+            for (uint32_t j = 0; j < inst.n; ++j) {
+                if (!visited[j] && inst.dist(cur, j) < best) {
+                    best = inst.dist(cur, j);
+                    next = j;
+                }
+            }
+        }
+        visited[next] = true;
+        path.push_back(next);
+    }
+    return path;
+}
+
+LocalSearch::LocalSearch(const TspInstance &inst, const CandidateLists &cand)
+    : inst(inst), cand(cand), pos(inst.n), queued(inst.n) {}
+
+uint32_t LocalSearch::succ(const uint32_t c) const {
+    const auto i = pos[c] + 1;
+    return tour[i == tour.size() ? 0 : i];
+}
+
+uint32_t LocalSearch::pred(const uint32_t c) const {
+    const auto i = pos[c];
+    return tour[i == 0 ? tour.size() - 1 : i - 1];
+}
+
+// Reverse the tour from city from forward to city to. When that path is the longer side, the
+// rest of the tour is reversed instead, which leaves the same cycle.
+void LocalSearch::reverse_path(const uint32_t from, const uint32_t to) {
+    const auto n = tour.size();
+    auto i = pos[from];
+    auto j = pos[to];
+    auto len = (j + n - i) % n + 1;
+    if (2 * len > n) {
+        i = (j + 1) % n;
+        j = (pos[from] + n - 1) % n;
+        len = n - len;
+    }
+    for (size_t k = 0; k < len / 2; ++k) {
+        std::swap(tour[i], tour[j]);
+        pos[tour[i]] = static_cast<uint32_t>(i);
+        pos[tour[j]] = static_cast<uint32_t>(j);
+        i = i + 1 == n ? 0 : i + 1;
+        j = j == 0 ? n - 1 : j - 1;
+    }
+}
+
+// Replace the tour edges (a, b) and (c, e), traversed in the same direction, by (a, c) and (b, e).
+void LocalSearch::two_opt_move(const uint32_t a, const uint32_t b, const uint32_t c, const uint32_t e) {
+    if (succ(a) == b) reverse_path(b, c);
+    else reverse_path(a, e);
+}
+
+void LocalSearch::wake(const uint32_t c) {
+    if (queued[c]) return;
+    queued[c] = true;
+    queue.push_back(c);
+}
+
+double LocalSearch::try_two_opt(const uint32_t a) {
+    for (const auto forward: {true, false}) {
+        const auto b = forward ? succ(a) : pred(a);
+        const auto d_ab = d(a, b);
+        for (const auto c: cand.of(a)) {
+            const auto d_ac = d(a, c);
+            if (d_ac >= d_ab) break;
+            const auto e = forward ? succ(c) : pred(c);
+            if (c == b || e == a) continue;
+            const auto gain = d_ab + d(c, e) - d_ac - d(b, e);
+            if (gain <= 1e-9) continue;
+            if (forward) two_opt_move(a, b, c, e);
+            else two_opt_move(b, a, e, c);
+            for (const auto x: {a, b, c, e}) wake(x);
+            return gain;
+        }
+    }
+    return 0.0;
+}
+
+// Move a segment of up to three cities starting or ending at a between two adjacent cities
+// near it, in either orientation. Done as two or three 2-opt moves.
+double LocalSearch::try_or_opt(const uint32_t a) {
+    for (size_t len = 1; len <= 3 && len + 2 < tour.size(); ++len) {
+        for (const auto forward: {true, false}) {
+            // Segment s1..s2 in tour order, with p before and q after it.
+            auto s1 = a, s2 = a;
+            for (size_t k = 1; k < len; ++k) {
+                if (forward) s2 = succ(s2);
+                else s1 = pred(s1);
+            }
+            const auto p = pred(s1), q = succ(s2);
+            const auto in_segment = [&](const uint32_t c) {
+                return (pos[c] + tour.size() - pos[s1]) % tour.size() < len;
+            };
+            const auto removal = d(p, s1) + d(s2, q) - d(p, q);
+            for (const auto end: {s1, s2}) {
+                for (const auto c: cand.of(end)) {
+                    if (d(end, c) >= removal) break;
+                    if (in_segment(c)) continue;
+                    // Insert between x and y = succ(x), for both tour edges at c.
+                    for (const auto x: {c, pred(c)}) {
+                        const auto y = succ(x);
+                        if (in_segment(x) || in_segment(y) || y == p) continue;
+                        const auto d_xy = d(x, y);
+                        const auto add_reversed = d(x, s2) + d(s1, y) - d_xy;
+                        const auto add_forward = d(x, s1) + d(s2, y) - d_xy;
+                        const auto add = std::min(add_reversed, add_forward);
+                        if (removal - add <= 1e-9) continue;
+                        // p s1..s2 q .. x y  ->  p x .. q s2..s1 y  ->  p q .. x s2..s1 y
+                        two_opt_move(p, s1, x, y);
+                        if (x != q) two_opt_move(p, x, q, s2);
+                        if (add_forward < add_reversed) two_opt_move(x, s2, s1, y);
+                        for (const auto z: {p, q, x, y, s1, s2}) wake(z);
+                        return removal - add;
+                    }
+                }
+            }
+        }
+    }
+    return 0.0;
+}
+
+double LocalSearch::improve(Path &path) {
+    tour = std::move(path);
+    for (size_t i = 0; i < tour.size(); ++i) pos[tour[i]] = static_cast<uint32_t>(i);
+    queue.assign(tour.begin(), tour.end());
+    std::ranges::fill(queued, 1);
+    double saved = 0.0;
+    for (size_t head = 0; head < queue.size(); ++head) {
+        const auto a = queue[head];
+        queued[a] = false;
+        for (;;) {
+            auto gain = try_two_opt(a);
+            if (gain == 0.0) gain = try_or_opt(a);
+            if (gain == 0.0) break;
+            saved += gain;
+        }
+        // Drop the processed prefix now and then, so the queue does not grow without bound.
+        if (head > tour.size() && 2 * head > queue.size()) {
+            queue.erase(queue.begin(), queue.begin() + static_cast<ptrdiff_t>(head + 1));
+            head = static_cast<size_t>(-1);
+        }
+    }
+    path = std::move(tour);
+    return saved;
+}
@@ -0,0 +1,114 @@
+#ifndef TSP_H
+#define TSP_H
+
+#include "common.h"
+
+// Symmetric TSP instance with one of the TSPLIB edge weight types. Coordinate instances compute
+// distances on demand, explicit ones keep the full matrix.
+struct TspInstance {
+    enum class Metric { explicit_matrix, euc_2d, ceil_2d, att, geo };
+
+    std::string name;
+    size_t n = 0;
+    Metric metric = Metric::explicit_matrix;
+    // Coordinates; latitude and longitude in radians for GEO.
+    std::vector<double> x;
+    std::vector<double> y;
+    std::vector<float> matrix;
+
+    [[nodiscard]] float dist(const size_t i, const size_t j) const {
+        if (metric == Metric::explicit_matrix) return matrix[i * n + j];
+        const auto dx = x[i] - x[j];
+        const auto dy = y[i] - y[j];
+        switch (metric) {
+            case Metric::euc_2d:
+                return static_cast<float>(std::lround(std::sqrt(dx * dx + dy * dy)));
+            case Metric::ceil_2d:
+                return static_cast<float>(std::ceil(std::sqrt(dx * dx + dy * dy)));
+            case Metric::att: {
+                const auto r = std::sqrt((dx * dx + dy * dy) / 10.0);
+                const auto t = std::round(r);
+                return static_cast<float>(t < r ? t + 1.0 : t);
+            }
+            case Metric::geo: {
+                constexpr double radius = 6378.388;
+                const auto q1 = std::cos(y[i] - y[j]);
+                const auto q2 = std::cos(x[i] - x[j]);
+                const auto q3 = std::cos(x[i] + x[j]);
+                return static_cast<float>(std::floor(
+                    radius * std::acos(0.5 * ((1.0 + q1) * q2 - (1.0 - q1) * q3)) + 1.0));
+            }
+            default:
+                return 0.0f;
+        }
+    }
+
+    // Distances from city i to every city, with the metric dispatched once for the whole row.
+    void dist_row(const size_t i, std::span<float> out) const {
+        if (metric == Metric::euc_2d) {
+            for (size_t j = 0; j < n; ++j) {
+                const auto dx = x[i] - x[j];
+                const auto dy = y[i] - y[j];
+                out[j] = static_cast<float>(std::floor(std::sqrt(dx * dx + dy * dy) + 0.5));
+            }
+        } else {
+            for (size_t j = 0; j < n; ++j) out[j] = dist(i, j);
+        }
+    }
+};
+
+// Read a TSPLIB file of TYPE TSP. Problems are reported on std::cerr.
+std::optional<TspInstance> load_tsplib(std::istream &in);
+std::optional<TspInstance> load_tsplib(const std::string &path);
+
+// Cities uniformly scattered over a square, with EUC_2D distances.
+TspInstance random_instance(size_t n, uint32_t seed, double side = 1e6);
+
+// The k nearest neighbours of every city, nearest first.
+struct CandidateLists {
+    size_t k = 0;
+    std::vector<uint32_t> city;
+
+    [[nodiscard]] std::span<const uint32_t> of(const size_t i) const { return {city.data() + i * k, k}; }
+};
+
+CandidateLists nearest_neighbours(const TspInstance &inst, size_t k);
+
+using Path = std::vector<uint32_t>;
+
+double cost_of(const TspInstance &inst, const Path &path);
+
+// Nearest-neighbour tour, looking through the candidate lists first.
+Path tsp_greedy(const TspInstance &inst, const CandidateLists &cand, size_t start = 0);
+
+// 2-opt and Or-opt improvement of a tour. Moves are only tried towards the k nearest neighbours
+// of a city and within the fixed radius given by the edge they would remove; cities whose
+// neighbourhood yielded nothing are skipped until one of their tour neighbours changes
+// (don't-look bits). The tour is kept as an array with a position index, so every delta costs
+// O(1) and a 2-opt reversal walks the shorter side of the tour.
+class LocalSearch {
+public:
+    LocalSearch(const TspInstance &inst, const CandidateLists &cand);
+
+    // Improve path in place until neither move finds a gain; returns the cost saved.
+    double improve(Path &path);
+
+private:
+    [[nodiscard]] uint32_t succ(uint32_t c) const;
+    [[nodiscard]] uint32_t pred(uint32_t c) const;
+    [[nodiscard]] double d(uint32_t a, uint32_t b) const { return inst.dist(a, b); }
+    void reverse_path(uint32_t from, uint32_t to);
+    void two_opt_move(uint32_t a, uint32_t b, uint32_t c, uint32_t e);
+    void wake(uint32_t c);
+    double try_two_opt(uint32_t a);
+    double try_or_opt(uint32_t a);
+
+    const TspInstance &inst;
+    const CandidateLists &cand;
+    Path tour;
+    std::vector<uint32_t> pos;
+    std::vector<uint8_t> queued;
+    std::vector<uint32_t> queue;
+};
+
+#endif //TSP_H
@@ -0,0 +1,476 @@
+#include "tune.h"
+#include "rng.h"
+#include "sweep.h"
+#include "work_stealing_pool.h"
+
+#include <mutex>
+
+enum class race_test { friedman, t };
+
+constexpr std::array<std::pair<std::string_view, race_test>, 2> race_test_names{{
+    {"friedman", race_test::friedman}, {"t", race_test::t},
+}};
+
+struct race_settings {
+    size_t budget = 1000;
+    size_t first_test = 5;
+    size_t each_test = 1;
+    race_test test = race_test::friedman;
+    double confidence = 0.95;
+    uint64_t seed = 0;
+};
+
+// A tuned setting: a real or integer range, or a list of categories.
+struct tuned_param {
+    enum class kind { real, integer, categorical };
+
+    std::string key;
+    kind type;
+    double lo = 0.0;
+    double hi = 0.0;
+    std::vector<std::string> values;
+};
+
+// A configuration in the race. Its sampling model holds, for a range, the standard deviation of
+// the values sampled around it, and for a list the probability of each category.
+struct race_candidate {
+    // Value of every tuned setting; the index of the category for a list.
+    std::vector<double> x;
+    std::vector<std::vector<double>> model;
+    // Value of every tuned setting as text.
+    std::vector<std::string> text;
+    // All tuned settings as text, which identifies the candidate.
+    std::string key;
+};
+
+// Regularised upper incomplete gamma function Q(a, x), by its series below a + 1 and by its
+// continued fraction above.
+double gamma_q(const double a, const double x) {
+    if (x <= 0.0) return 1.0;
+    const auto front = std::exp(-x + a * std::log(x) - std::lgamma(a));
+    if (x < a + 1.0) {
+        auto term = 1.0 / a, sum = term;
+        for (auto ap = a; std::abs(term) > std::abs(sum) * 1e-15;) sum += term *= x / ++ap;
+        return 1.0 - sum * front;
+    }
+    constexpr auto tiny = 1e-300;
+    auto b = x + 1.0 - a, c = 1.0 / tiny, d = 1.0 / b, h = d;
+    for (int i = 1; i < 1000; ++i) {
+        const auto an = -i * (i - a);
+        b += 2.0;
+        d = an * d + b;
+        if (std::abs(d) < tiny) d = tiny;
+        c = b + an / c;
+        if (std::abs(c) < tiny) c = tiny;
+        d = 1.0 / d;
+        h *= d * c;
+        if (std::abs(d * c - 1.0) < 1e-15) break;
+    }
+    return front * h;
+}
+
+// Continued fraction of the incomplete beta function, converging for x < (a + 1) / (a + b + 2).
+double beta_fraction(const double a, const double b, const double x) {
+    constexpr auto tiny = 1e-300;
+    const auto clamp = [](const double v) { return std::abs(v) < tiny ? tiny : v; };
+    auto c = 1.0, d = 1.0 / clamp(1.0 - (a + b) * x / (a + 1.0)), h = d;
+    for (int m = 1; m < 1000; ++m) {
+        const auto even = m * (b - m) * x / ((a + 2 * m - 1.0) * (a + 2 * m));
+        d = 1.0 / clamp(1.0 + even * d);
+        c = clamp(1.0 + even / c);
+        h *= d * c;
+        const auto odd = -(a + m) * (a + b + m) * x / ((a + 2 * m) * (a + 2 * m + 1.0));
+        d = 1.0 / clamp(1.0 + odd * d);
+        c = clamp(1.0 + odd / c);
+        h *= d * c;
+        if (std::abs(d * c - 1.0) < 1e-15) break;
+    }
+    return h;
+}
+
+// Regularised incomplete beta function I_x(a, b).
+double beta_i(const double a, const double b, const double x) {
+    if (x <= 0.0) return 0.0;
+    if (x >= 1.0) return 1.0;
+    const auto front = std::exp(std::lgamma(a + b) - std::lgamma(a) - std::lgamma(b) + a * std::log(x) +
+                                b * std::log1p(-x));
+    if (x < (a + 1.0) / (a + b + 2.0)) return front * beta_fraction(a, b, x) / a;
+    return 1.0 - front * beta_fraction(b, a, 1.0 - x) / b;
+}
+
+// Two-sided p-value of Student's t with df degrees of freedom.
+double student_p(const double t, const double df) {
+    return beta_i(df / 2.0, 0.5, df / (df + t * t));
+}
+
+// The candidates of alive that a test over blocks [0, n_block) finds worse than the best, where
+// results[i][b] is the best value candidate alive[i] reached on block b, +inf for a failed run.
+// The Friedman test ranks the candidates within each block and, when it rejects that all are
+// alike, compares each rank sum with the best one (Conover's post-hoc test).
+std::vector<bool> race_losers(const std::vector<std::span<const double>> &results, const size_t n_block,
+                              const race_test test, const double alpha) {
+    const auto k = results.size();
+    std::vector<bool> lose(k);
+    if (k < 2 || n_block < 2) return lose;
+    const auto n = static_cast<double>(n_block);
+    if (test == race_test::friedman) {
+        std::vector<double> rank_sum(k), rank(k);
+        std::vector<size_t> order(k);
+        auto sum_sq = 0.0;
+        for (size_t b = 0; b < n_block; ++b) {
+            std::iota(order.begin(), order.end(), 0);
+            std::ranges::sort(order, {}, [&](const size_t i) { return results[i][b]; });
+            // Tied values share the mean of their ranks.
+            for (size_t first = 0; first < k;) {
+                auto last = first + 1;
+                while (last < k && results[order[last]][b] == results[order[first]][b]) ++last;
+                for (auto i = first; i < last; ++i) rank[order[i]] = static_cast<double>(first + last + 1) / 2.0;
+                first = last;
+            }
+            for (size_t i = 0; i < k; ++i) {
+                rank_sum[i] += rank[i];
+                sum_sq += rank[i] * rank[i];
+            }
+        }
+        const auto kd = static_cast<double>(k);
+        const auto ties = sum_sq - n * kd * (kd + 1.0) * (kd + 1.0) / 4.0;
+        if (ties <= 0.0) return lose;
+        auto spread = 0.0, rank_sum_sq = 0.0;
+        for (const auto r: rank_sum) {
+            spread += (r - n * (kd + 1.0) / 2.0) * (r - n * (kd + 1.0) / 2.0);
+            rank_sum_sq += r * r;
+        }
+        if (gamma_q((kd - 1.0) / 2.0, (kd - 1.0) * spread / ties / 2.0) >= alpha) return lose;
+        const auto best = std::ranges::min(rank_sum);
+        const auto df = (n - 1.0) * (kd - 1.0);
+        const auto scale = std::sqrt(std::max(2.0 * (n * sum_sq - rank_sum_sq) / df, 0.0));
+        for (size_t i = 0; i < k; ++i) {
+            const auto diff = rank_sum[i] - best;
+            lose[i] = diff > 0.0 && (scale == 0.0 || student_p(diff / scale, df) < alpha);
+        }
+        return lose;
+    }
+    std::vector<double> mean(k);
+    for (size_t i = 0; i < k; ++i) {
+        for (size_t b = 0; b < n_block; ++b) mean[i] += results[i][b] / n;
+    }
+    const auto best = static_cast<size_t>(std::ranges::min_element(mean) - mean.begin());
+    for (size_t i = 0; i < k; ++i) {
+        if (i == best) continue;
+        // Paired differences; a run that failed where the best did not loses outright.
+        std::vector<double> d(n_block);
+        for (size_t b = 0; b < n_block; ++b) {
+            const auto v = results[i][b], w = results[best][b];
+            d[b] = v == w ? 0.0 : v - w;
+            if (std::isnan(d[b]) || d[b] == -std::numeric_limits<double>::infinity()) d[b] = 0.0;
+        }
+        if (std::ranges::find(d, std::numeric_limits<double>::infinity()) != d.end()) {
+            lose[i] = true;
+            continue;
+        }
+        const auto d_mean = std::accumulate(d.begin(), d.end(), 0.0) / n;
+        auto var = 0.0;
+        for (const auto v: d) var += (v - d_mean) * (v - d_mean) / (n - 1.0);
+        lose[i] = d_mean > 0.0 && (var == 0.0 || student_p(d_mean / std::sqrt(var / n), n - 1.0) < alpha);
+    }
+    return lose;
+}
+
+// Reads the tuned settings, the instances, the race settings and the fixed settings of a spec.
+bool load_tune(const std::string &path, std::vector<tuned_param> &params, std::vector<config> &instances,
+               race_settings &race, config &fixed) {
+    config spec;
+    if (!spec.load(path)) return false;
+    config race_cfg, instance_cfg;
+    for (const auto &[key, value]: spec.all()) {
+        if (key.starts_with("race.")) {
+            race_cfg.set(key.substr(5), value);
+        } else if (key.starts_with("instance.")) {
+            instance_cfg.set(key.substr(9), value);
+        } else if (key.starts_with("tune.")) {
+            tuned_param p;
+            p.key = key.substr(5);
+            p.type = tuned_param::kind::categorical;
+            const auto dots = value.find("..");
+            const auto lo = config_trim(value.substr(0, dots));
+            const auto hi = dots == std::string::npos ? std::string() : config_trim(value.substr(dots + 2));
+            const auto whole = [](const std::string &text, double &v) {
+                const auto [end, ec] = std::from_chars(text.data(), text.data() + text.size(), v);
+                return ec == std::errc() && end == text.data() + text.size();
+            };
+            // Anything else with "..", such as a list of relative paths, is a list.
+            if (dots != std::string::npos && whole(lo, p.lo) && whole(hi, p.hi)) {
+                p.type = lo.contains('.') || hi.contains('.') ? tuned_param::kind::real : tuned_param::kind::integer;
+                if (p.lo > p.hi) {
+                    std::cerr << "Invalid range '" << value << "' for " << key << "." << std::endl;
+                    return false;
+                }
+            } else {
+                for (const auto part: value | std::views::split(',')) {
+                    p.values.push_back(config_trim(std::string(part.begin(), part.end())));
+                }
+                if (p.values.empty()) {
+                    std::cerr << "Invalid categories '" << value << "' for " << key << "." << std::endl;
+                    return false;
+                }
+            }
+            params.push_back(std::move(p));
+        } else {
+            fixed.set(key, value);
+        }
+    }
+    if (!(race_cfg.read("budget", race.budget) && race_cfg.read("first_test", race.first_test) &&
+          race_cfg.read("each_test", race.each_test) && race_cfg.read("test", race.test, race_test_names) &&
+          race_cfg.read("confidence", race.confidence) && race_cfg.read("seed", race.seed))) {
+        return false;
+    }
+    for (const auto &key: race_cfg.unused()) std::cerr << "Unknown race setting '" << key << "'." << std::endl;
+    if (params.empty() || race.first_test < 2 || race.each_test == 0 || race.confidence <= 0.0 ||
+        race.confidence >= 1.0) {
+        std::cerr << "Tuning needs a tune. setting, race.first_test >= 2, race.each_test >= 1 and "
+            "race.confidence in (0, 1)." << std::endl;
+        return false;
+    }
+    // Instances are the cartesian product of the instance settings, as the runs of a sweep block.
+    std::vector<std::pair<std::string, std::vector<std::string>>> lists;
+    for (const auto &[key, value]: instance_cfg.all()) {
+        const auto values = sweep_values(value);
+        if (!values) {
+            std::cerr << "Invalid instance values '" << value << "' for " << key << "." << std::endl;
+            return false;
+        }
+        lists.emplace_back(key, *values);
+    }
+    std::vector<size_t> pick(lists.size());
+    for (;;) {
+        config inst;
+        for (size_t i = 0; i < lists.size(); ++i) inst.set(lists[i].first, lists[i].second[pick[i]]);
+        instances.push_back(std::move(inst));
+        size_t i = lists.size();
+        for (; i > 0; --i) {
+            if (++pick[i - 1] < lists[i - 1].second.size()) break;
+            pick[i - 1] = 0;
+        }
+        if (i == 0) break;
+    }
+    return true;
+}
+
+// Fills in the text of the candidate's settings. Real values are kept to four decimals, so that
+// close samples share their runs.
+void name_candidate(const std::vector<tuned_param> &params, race_candidate &c) {
+    c.text.clear();
+    c.key.clear();
+    for (size_t p = 0; p < params.size(); ++p) {
+        if (params[p].type == tuned_param::kind::categorical) {
+            c.text.push_back(params[p].values[static_cast<size_t>(c.x[p])]);
+        } else {
+            const auto real = params[p].type == tuned_param::kind::real;
+            c.x[p] = real ? std::round(c.x[p] * 1e4) / 1e4 : std::round(c.x[p]);
+            // Fixed notation, as integer settings do not read "1e+05"; with room for any double.
+            std::array<char, 330> text{};
+            const auto end = std::to_chars(text.data(), text.data() + text.size(), c.x[p], std::chars_format::fixed,
+                                           real ? 4 : 0).ptr;
+            c.text.emplace_back(text.data(), end);
+        }
+        if (!c.key.empty()) c.key += ' ';
+        c.key += params[p].key + '=' + c.text.back();
+    }
+}
+
+// A candidate drawn uniformly from the ranges and lists.
+race_candidate sample_uniform(const std::vector<tuned_param> &params, counter_rng &rng) {
+    race_candidate c;
+    for (const auto &p: params) {
+        if (p.type == tuned_param::kind::categorical) {
+            c.x.push_back(rng.below(static_cast<uint32_t>(p.values.size())));
+            c.model.emplace_back(p.values.size(), 1.0 / static_cast<double>(p.values.size()));
+        } else {
+            c.x.push_back(p.type == tuned_param::kind::real
+                              ? p.lo + rng.uniform() * (p.hi - p.lo)
+                              : p.lo + rng.below(static_cast<uint32_t>(p.hi - p.lo) + 1));
+            c.model.push_back({(p.hi - p.lo) / 2.0});
+        }
+    }
+    name_candidate(params, c);
+    return c;
+}
+
+// A candidate drawn around parent: a range from a normal distribution truncated to the range, and
+// a list from the parent's probabilities. The candidate inherits the parent's model.
+race_candidate sample_around(const std::vector<tuned_param> &params, const race_candidate &parent,
+                             counter_rng &rng) {
+    race_candidate c;
+    c.x = parent.x;
+    c.model = parent.model;
+    for (size_t p = 0; p < params.size(); ++p) {
+        if (params[p].type == tuned_param::kind::categorical) {
+            const auto &prob = parent.model[p];
+            auto u = rng.uniform();
+            size_t i = 0;
+            while (i + 1 < prob.size() && (u -= prob[i]) >= 0.0) ++i;
+            c.x[p] = static_cast<double>(i);
+            continue;
+        }
+        std::array<double, 1> v{};
+        for (int tries = 0; tries < 16; ++tries) {
+            rng.fill_normal(v, parent.x[p], parent.model[p][0]);
+            if (v[0] >= params[p].lo && v[0] <= params[p].hi) break;
+        }
+        c.x[p] = std::clamp(v[0], params[p].lo, params[p].hi);
+    }
+    name_candidate(params, c);
+    return c;
+}
+
+// Mean rank of every candidate over blocks [0, n_block), and its mean best value.
+std::vector<std::pair<double, double>> race_scores(const std::vector<std::span<const double>> &results,
+                                                   const size_t n_block) {
+    const auto k = results.size();
+    std::vector<std::pair<double, double>> score(k);
+    for (size_t b = 0; b < n_block; ++b) {
+        for (size_t i = 0; i < k; ++i) {
+            auto rank = 1.0;
+            for (size_t j = 0; j < k; ++j) {
+                if (results[j][b] < results[i][b]) rank += 1.0;
+                else if (j != i && results[j][b] == results[i][b]) rank += 0.5;
+            }
+            score[i].first += rank / static_cast<double>(n_block);
+            score[i].second += results[i][b] / static_cast<double>(n_block);
+        }
+    }
+    return score;
+}
+
+bool run_tune(const std::string &spec, const size_t n_thread) {
+    std::vector<tuned_param> params;
+    std::vector<config> instances;
+    race_settings race;
+    config fixed;
+    if (!load_tune(spec, params, instances, race, fixed)) return false;
+    const auto alpha = 1.0 - race.confidence;
+    // irace's schedule: 2 + log2(parameters) iterations, each racing down to as many survivors
+    // and spending its share of what is left of the budget.
+    const auto n_iter = 2 + static_cast<size_t>(std::log2(static_cast<double>(params.size())));
+    const auto n_survivor = n_iter;
+
+    counter_rng rng(race.seed);
+    work_stealing_pool pool(n_thread);
+    // Best value of every candidate on every block it ran, NaN for blocks it did not run.
+    std::map<std::string, std::vector<double>> results;
+    std::set<std::string> unused;
+    std::mutex mutex;
+    std::vector<race_candidate> elites;
+    size_t used = 0;
+    const auto begin = std::chrono::steady_clock::now();
+    for (size_t iter = 1; iter <= n_iter && used < race.budget; ++iter) {
+        const auto iter_budget = (race.budget - used) / (n_iter - iter + 1);
+        const auto n_candidate = iter_budget / (race.first_test + std::min<size_t>(5, iter));
+        if (n_candidate <= elites.size()) break;
+
+        // The elites' models narrow: the deviations shrink with the number of candidates, and the
+        // categories drift towards the elite's own as the iterations go by.
+        const auto shrink = std::pow(1.0 / static_cast<double>(n_candidate), 1.0 / static_cast<double>(params.size()));
+        const auto pull = static_cast<double>(iter - 1) / static_cast<double>(n_iter);
+        for (auto &e: elites) {
+            for (size_t p = 0; p < params.size(); ++p) {
+                if (params[p].type != tuned_param::kind::categorical) {
+                    e.model[p][0] *= shrink;
+                    continue;
+                }
+                for (auto &prob: e.model[p]) prob *= 1.0 - pull;
+                e.model[p][static_cast<size_t>(e.x[p])] += pull;
+            }
+        }
+        auto alive = elites;
+        std::set<std::string> keys;
+        for (const auto &e: elites) keys.insert(e.key);
+        for (size_t tries = 0; alive.size() < n_candidate && tries < 16 * n_candidate; ++tries) {
+            race_candidate c;
+            if (elites.empty()) {
+                c = sample_uniform(params, rng);
+            } else {
+                // Parents by rank: the r-th best of n elites with weight n - r.
+                const auto n = elites.size();
+                auto u = rng.below(static_cast<uint32_t>(n * (n + 1) / 2));
+                size_t r = 0;
+                while (u >= n - r) u -= static_cast<uint32_t>(n - r++);
+                c = sample_around(params, elites[r], rng);
+            }
+            if (keys.insert(c.key).second) alive.push_back(std::move(c));
+        }
+
+        // Run the alive candidates block by block, dropping the losers at every test, until few
+        // enough survive or the iteration's budget is spent. Elites keep the runs of earlier races.
+        size_t n_block = 0, iter_used = 0;
+        const auto table = [&] {
+            std::vector<std::span<const double>> t;
+            for (const auto &c: alive) t.emplace_back(results[c.key]);
+            return t;
+        };
+        while (alive.size() > n_survivor || n_block < race.first_test) {
+            auto step = n_block < race.first_test ? race.first_test - n_block : race.each_test;
+            std::vector<std::pair<size_t, size_t>> runs;
+            for (; step > 0; --step) {
+                runs.clear();
+                for (size_t i = 0; i < alive.size(); ++i) {
+                    auto &r = results[alive[i].key];
+                    r.resize(std::max(r.size(), n_block + step), std::numeric_limits<double>::quiet_NaN());
+                    for (auto b = n_block; b < n_block + step; ++b) {
+                        if (std::isnan(r[b])) runs.emplace_back(i, b);
+                    }
+                }
+                if (iter_used + runs.size() <= iter_budget) break;
+            }
+            if (step == 0) break;
+            std::vector<size_t> order(runs.size());
+            std::iota(order.begin(), order.end(), 0);
+            pool.run(order, [&](const size_t t, size_t) {
+                const auto [i, b] = runs[t];
+                auto cfg = fixed;
+                for (const auto &[key, value]: instances[b % instances.size()].all()) cfg.set(key, value);
+                for (size_t p = 0; p < params.size(); ++p) cfg.set(params[p].key, alive[i].text[p]);
+                cfg.set("seed", std::to_string(b));
+                std::vector<std::string> run_unused;
+                const auto summary = run_in_batch(cfg, run_unused);
+                std::lock_guard lock(mutex);
+                unused.insert(run_unused.begin(), run_unused.end());
+                results[alive[i].key][b] = summary ? summary->best : std::numeric_limits<double>::infinity();
+            });
+            iter_used += runs.size();
+            n_block += step;
+            if (n_block < race.first_test) continue;
+            const auto lose = race_losers(table(), n_block, race.test, alpha);
+            std::vector<race_candidate> kept;
+            for (size_t i = 0; i < alive.size(); ++i) {
+                if (!lose[i]) kept.push_back(std::move(alive[i]));
+            }
+            alive = std::move(kept);
+        }
+        used += iter_used;
+
+        // The survivors, best mean rank first, are the next elites.
+        const auto score = race_scores(table(), n_block);
+        std::vector<size_t> order(alive.size());
+        std::iota(order.begin(), order.end(), 0);
+        std::ranges::stable_sort(order, {}, [&](const size_t i) { return score[i]; });
+        elites.clear();
+        std::cout << "Iteration " << iter << ": " << alive.size() << " of " << n_candidate << " candidates left after "
+            << n_block << " blocks and " << iter_used << " runs, " << used << " of " << race.budget << " in all"
+            << std::endl;
+        for (const auto i: order | std::views::take(n_survivor)) {
+            std::cout << "  mean rank " << score[i].first << " mean best " << score[i].second << ": " << alive[i].key
+                << std::endl;
+            elites.push_back(alive[i]);
+        }
+    }
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - begin;
+    for (const auto &key: unused) std::cerr << "Unused setting '" << key << "'." << std::endl;
+    if (elites.empty()) {
+        std::cerr << "The budget of " << race.budget << " runs is too small for a race." << std::endl;
+        return false;
+    }
+    std::cout << "Best: " << elites.front().key << " (" << used << " runs in " << elapsed.count() << " seconds)"
+        << std::endl;
+    return true;
+}
@@ -0,0 +1,33 @@
+#ifndef TUNE_H
+#define TUNE_H
+
+#include "common.h"
+
+// Iterated racing, after irace: every iteration samples candidate configurations around the elites
+// of the last, races them block by block, and drops those that a Friedman or paired t-test finds
+// worse than the best. The spec is a config file:
+//
+//   algo = de
+//   n_epoch = 200
+//   tune.cr = 0.0..1.0
+//   tune.f = 0.1..1.0
+//   tune.strategy = rand_1, best_1
+//   instance.n_dim = 10, 30
+//   race.budget = 2000
+//
+// Settings under "tune." are tuned: "lo..hi", with two numbers, is a real range when a bound has a
+// decimal point and an integer range otherwise, and anything else, "a, b, c", is a list of
+// categories. Settings under "instance." list values whose cartesian product makes the instances. Block k of a race runs instance k mod
+// the number of instances with seed k. Other settings pass to every run, except the race's own:
+//
+//   race.budget      runs in total, 1000
+//   race.first_test  blocks before the first test, 5
+//   race.each_test   blocks between tests, 1
+//   race.test        friedman or t, friedman
+//   race.confidence  of the tests, 0.95
+//   race.seed        of the sampling of candidates, 0
+//
+// Prints the elites of every iteration, best first. False when the spec is invalid.
+bool run_tune(const std::string &spec, size_t n_thread);
+
+#endif //TUNE_H
@@ -0,0 +1,65 @@
+#include "variation.h"
+#include "lane_math.h"
+
+// Loci per chunk; a few whole batches of the generator.
+constexpr size_t variation_chunk = 256;
+// Doubles in the widest vector, to which the lane functions' lengths are rounded up.
+constexpr size_t variation_lanes = 8;
+
+void cross_uniform(const std::span<double> a, const std::span<double> b, counter_rng &rng) {
+    std::array<uint32_t, variation_chunk / 32> bits{};
+    for (size_t first = 0; first < a.size(); first += variation_chunk) {
+        const auto n = std::min(variation_chunk, a.size() - first);
+        rng.fill_bits(std::span(bits).first((n + 31) / 32));
+        for (size_t i = 0; i < n; ++i) {
+            const auto swap = (bits[i / 32] >> (i % 32) & 1) != 0;
+            const auto x = a[first + i], y = b[first + i];
+            a[first + i] = swap ? y : x;
+            b[first + i] = swap ? x : y;
+        }
+    }
+}
+
+void cross_blend(const std::span<double> a, const std::span<double> b, const double alpha, const double lo,
+                 const double hi, counter_rng &rng) {
+    std::array<double, 2 * variation_chunk> u{};
+    for (size_t first = 0; first < a.size(); first += variation_chunk) {
+        const auto n = std::min(variation_chunk, a.size() - first);
+        rng.fill_uniform(std::span(u).first(2 * n), -alpha, 1.0 + alpha);
+        for (size_t i = 0; i < n; ++i) {
+            const auto x = a[first + i], y = b[first + i];
+            const auto low = std::min(x, y), d = std::max(x, y) - low;
+            a[first + i] = std::clamp(low + u[i] * d, lo, hi);
+            b[first + i] = std::clamp(low + u[n + i] * d, lo, hi);
+        }
+    }
+}
+
+void cross_sbx(const std::span<double> a, const std::span<double> b, const double eta, const double lo,
+               const double hi, counter_rng &rng) {
+    alignas(64) double u[variation_chunk]{}, y[variation_chunk], beta[variation_chunk];
+    const auto inv = 1.0 / (eta + 1.0);
+    for (size_t first = 0; first < a.size(); first += variation_chunk) {
+        const auto n = std::min(variation_chunk, a.size() - first);
+        rng.fill_uniform(std::span(u).first(n));
+        // beta = (2u)^(1 / (eta + 1)) below u = 1/2 and (2 (1 - u))^(-1 / (eta + 1)) above, as
+        // exp(log(y) / (eta + 1)) with y the base raised to +1 or -1. A zero base gives beta ~ 0.
+        // Lanes past n up to the vector width hold the zeroed or last chunk's u, valid either way.
+        const auto n_lane = (n + variation_lanes - 1) / variation_lanes * variation_lanes;
+        for (size_t i = 0; i < n_lane; ++i) {
+            const auto low = u[i] <= 0.5;
+            const auto base = std::max(low ? 2.0 * u[i] : 2.0 * (1.0 - u[i]), 0x1p-1022);
+            y[i] = base;
+            beta[i] = low ? inv : -inv;
+        }
+        log_lanes(y, y, n_lane);
+        for (size_t i = 0; i < n_lane; ++i) y[i] *= beta[i];
+        exp_lanes(y, beta, n_lane);
+        for (size_t i = 0; i < n; ++i) {
+            const auto x0 = a[first + i], x1 = b[first + i];
+            const auto mid = 0.5 * (x0 + x1), half = 0.5 * beta[i] * (x1 - x0);
+            a[first + i] = std::clamp(mid - half, lo, hi);
+            b[first + i] = std::clamp(mid + half, lo, hi);
+        }
+    }
+}
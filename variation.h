@@ -0,0 +1,74 @@
+#ifndef VARIATION_H
+#define VARIATION_H
+
+#include "common.h"
+#include "rng.h"
+
+// Variation operators for real-coded chromosomes of any length, each stored contiguously. The
+// crossovers work on whole chromosomes a chunk of loci at a time, with the chunk's draws from one
+// bulk fill and the arithmetic in loops over the loci that vectorise.
+
+// Calls visit(i) for every i below size, independently with probability p, jumping from one to the
+// next by geometric skips, so that the cost follows the number of calls, about p * size, rather
+// than size. Returns the number of calls.
+template<typename Visit>
+size_t visit_sparse(const size_t size, const double p, counter_rng &rng, Visit &&visit) {
+    if (p <= 0.0) return 0;
+    // The gap before the next call is geometric: floor(log u / log(1 - p)) for u in (0, 1].
+    const auto scale = p < 1.0 ? 1.0 / std::log1p(-p) : 0.0;
+    size_t n = 0;
+    for (size_t i = 0;; ++i) {
+        // Gaps beyond the end stop the loop, including those too large for size_t.
+        const auto gap = std::log(1.0 - rng.uniform()) * scale;
+        if (gap >= static_cast<double>(size - i)) break;
+        i += static_cast<size_t>(gap);
+        visit(i);
+        ++n;
+    }
+    return n;
+}
+
+// Resets every locus of genes, independently with probability p, to a uniform value in [lo, hi),
+// calling changed(locus, old_value) after each reset. The loci are picked by visit_sparse. Returns
+// the number of resets.
+template<typename Changed>
+size_t mutate_reset(const std::span<double> genes, const double p, const double lo, const double hi,
+                    counter_rng &rng, Changed &&changed) {
+    return visit_sparse(genes.size(), p, rng, [&](const size_t i) {
+        const auto old = genes[i];
+        genes[i] = lo + (hi - lo) * rng.uniform();
+        changed(i, old);
+    });
+}
+
+// Polynomial mutation (Deb and Goyal, 1996) of every locus of genes, independently with probability
+// p: the locus moves by d (hi - lo), then is clamped to [lo, hi], with d in (-1, 1) drawn with
+// density proportional to (1 - |d|)^eta, so that larger eta keeps it closer. The loci are picked by
+// visit_sparse, and changed(locus, old_value) is called after each move. Returns the number of
+// loci moved.
+template<typename Changed>
+size_t mutate_polynomial(const std::span<double> genes, const double p, const double eta, const double lo,
+                         const double hi, counter_rng &rng, Changed &&changed) {
+    const auto power = 1.0 / (eta + 1.0);
+    return visit_sparse(genes.size(), p, rng, [&](const size_t i) {
+        const auto old = genes[i];
+        const auto u = rng.uniform();
+        const auto d = u < 0.5 ? std::pow(2.0 * u, power) - 1.0 : 1.0 - std::pow(2.0 * (1.0 - u), power);
+        genes[i] = std::clamp(old + d * (hi - lo), lo, hi);
+        changed(i, old);
+    });
+}
+
+// Uniform crossover: swaps every locus of a and b with probability 1/2.
+void cross_uniform(std::span<double> a, std::span<double> b, counter_rng &rng);
+
+// Blend crossover, BLX-alpha: every locus of each child is uniform on [min - alpha d, max + alpha d]
+// where min, max and d = max - min come from the parents' values, then clamped to [lo, hi].
+void cross_blend(std::span<double> a, std::span<double> b, double alpha, double lo, double hi, counter_rng &rng);
+
+// Simulated binary crossover (Deb and Agrawal, 1995) with distribution index eta: the children of
+// x and y are ((1 + beta) x + (1 - beta) y) / 2 and ((1 - beta) x + (1 + beta) y) / 2 with a spread
+// beta drawn per locus, then clamped to [lo, hi]. Larger eta keeps children closer to the parents.
+void cross_sbx(std::span<double> a, std::span<double> b, double eta, double lo, double hi, counter_rng &rng);
+
+#endif //VARIATION_H
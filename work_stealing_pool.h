@@ -0,0 +1,64 @@
+#ifndef WORK_STEALING_POOL_H
+#define WORK_STEALING_POOL_H
+
+#include "common.h"
+
+#include <deque>
+#include <functional>
+#include <mutex>
+
+// Runs a batch of independent tasks on n workers, the calling thread acting as worker 0. The
+// tasks are dealt round-robin in the given order, so that every worker starts on the front of the
+// order; a worker takes its own tasks from the front of its queue and, once that is empty, steals
+// from the back of the others'. Tasks must not add tasks; run returns when all have finished.
+class work_stealing_pool {
+public:
+    explicit work_stealing_pool(const size_t n_worker) : queues(std::max<size_t>(n_worker, 1)) {}
+
+    [[nodiscard]] size_t size() const { return queues.size(); }
+
+    void run(const std::span<const size_t> order, const std::function<void(size_t task, size_t worker)> &task) {
+        for (size_t i = 0; i < order.size(); ++i) queues[i % queues.size()].tasks.push_back(order[i]);
+        {
+            std::vector<std::jthread> threads;
+            for (size_t w = 1; w < queues.size(); ++w) threads.emplace_back([&, w] { serve(task, w); });
+            serve(task, 0);
+        }
+    }
+
+private:
+    struct alignas(64) queue {
+        std::mutex mutex;
+        std::deque<size_t> tasks;
+    };
+
+    void serve(const std::function<void(size_t, size_t)> &task, const size_t w) {
+        while (const auto next = take(w)) task(*next, w);
+    }
+
+    std::optional<size_t> take(const size_t w) {
+        {
+            auto &own = queues[w];
+            std::lock_guard lock(own.mutex);
+            if (!own.tasks.empty()) {
+                const auto t = own.tasks.front();
+                own.tasks.pop_front();
+                return t;
+            }
+        }
+        for (size_t i = 1; i < queues.size(); ++i) {
+            auto &victim = queues[(w + i) % queues.size()];
+            std::lock_guard lock(victim.mutex);
+            if (!victim.tasks.empty()) {
+                const auto t = victim.tasks.back();
+                victim.tasks.pop_back();
+                return t;
+            }
+        }
+        return std::nullopt;
+    }
+
+    std::vector<queue> queues;
+};
+
+#endif //WORK_STEALING_POOL_H
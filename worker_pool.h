@@ -0,0 +1,77 @@
+#ifndef WORKER_POOL_H
+#define WORKER_POOL_H
+
+#include "common.h"
+#include "profile.h"
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+
+// Fixed set of threads that run one job at a time: run(job) calls job(worker) once for every
+// worker index, the calling thread acting as worker 0, and returns when all calls have finished.
+class worker_pool {
+public:
+    explicit worker_pool(const size_t n_worker) : n_worker(std::max<size_t>(n_worker, 1)) {
+        for (size_t w = 1; w < this->n_worker; ++w) {
+            threads.emplace_back([this, w](const std::stop_token &stop) { serve(stop, w); });
+        }
+    }
+
+    worker_pool(const worker_pool &) = delete;
+    worker_pool &operator=(const worker_pool &) = delete;
+
+    ~worker_pool() {
+        {
+            std::lock_guard lock(mutex);
+            for (auto &t: threads) t.request_stop();
+        }
+        wake.notify_all();
+    }
+
+    [[nodiscard]] size_t size() const { return n_worker; }
+
+    void run(const std::function<void(size_t)> &job) {
+        {
+            std::lock_guard lock(mutex);
+            current = &job;
+            pending = n_worker - 1;
+            ++generation;
+        }
+        wake.notify_all();
+        job(0);
+        const phase_timer timer(phase::wait);
+        std::unique_lock lock(mutex);
+        done.wait(lock, [&] { return pending == 0; });
+        current = nullptr;
+    }
+
+private:
+    void serve(const std::stop_token &stop, const size_t w) {
+        uint64_t seen = 0;
+        for (;;) {
+            const std::function<void(size_t)> *job;
+            {
+                std::unique_lock lock(mutex);
+                wake.wait(lock, [&] { return stop.stop_requested() || generation != seen; });
+                if (stop.stop_requested()) return;
+                seen = generation;
+                job = current;
+            }
+            (*job)(w);
+            std::lock_guard lock(mutex);
+            if (--pending == 0) done.notify_one();
+        }
+    }
+
+    size_t n_worker;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+    const std::function<void(size_t)> *current = nullptr;
+    size_t pending = 0;
+    uint64_t generation = 0;
+    std::vector<std::jthread> threads;
+};
+
+#endif //WORKER_POOL_H